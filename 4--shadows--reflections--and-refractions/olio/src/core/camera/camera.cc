@@ -15,6 +15,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 
@@ -97,5 +98,6 @@ Camera::UpdateViewport()
   lower_left_corner_ = eye_ - w - 0.5 * (horizontal_ + vertical_);
 }
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -18,6 +18,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 //! \class Camera
 //! \brief Camera node
@@ -127,5 +128,6 @@ protected:
 private:
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -0,0 +1,82 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       aabb.cc
+//! \brief      AABB class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/aabb.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+AABB::AABB(const Vec3r &min_corner, const Vec3r &max_corner) :
+  min_{min_corner},
+  max_{max_corner}
+{
+}
+
+
+uint
+AABB::GetMaxExtentAxis() const
+{
+  Vec3r diagonal = GetDiagonal();
+  if (diagonal[0] > diagonal[1] && diagonal[0] > diagonal[2])
+    return 0;
+  return diagonal[1] > diagonal[2] ? 1 : 2;
+}
+
+
+Real
+AABB::GetSurfaceArea() const
+{
+  if (IsEmpty())
+    return 0;
+  Vec3r d = GetDiagonal();
+  return 2 * (d[0] * d[1] + d[0] * d[2] + d[1] * d[2]);
+}
+
+
+Vec3r
+AABB::GetOffset(const Vec3r &point) const
+{
+  Vec3r offset = point - min_;
+  for (int axis = 0; axis < 3; ++axis) {
+    if (max_[axis] > min_[axis])
+      offset[axis] /= max_[axis] - min_[axis];
+  }
+  return offset;
+}
+
+
+bool
+AABB::Hit(const Ray &ray, Real tmin, Real tmax) const
+{
+  const Vec3r &origin = ray.GetOrigin();
+  const Vec3r &dir = ray.GetDirection();
+  for (int axis = 0; axis < 3; ++axis) {
+    Real inv_dir = 1 / dir[axis];
+    Real t0 = (min_[axis] - origin[axis]) * inv_dir;
+    Real t1 = (max_[axis] - origin[axis]) * inv_dir;
+    if (inv_dir < 0)
+      std::swap(t0, t1);
+
+    // written so that NaNs (0 * inf) leave the interval unchanged
+    tmin = t0 > tmin ? t0 : tmin;
+    tmax = t1 < tmax ? t1 : tmax;
+    if (tmax < tmin)
+      return false;
+  }
+  return true;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,139 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       aabb.h
+//! \brief      AABB class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "core/types.h"
+#include "core/ray.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \class AABB
+//! \brief Axis-aligned bounding box. A default constructed box is
+//! empty (min > max) and can be grown with Extend().
+class AABB {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  //! \brief Default constructor; creates an empty box
+  AABB() = default;
+
+  //! \brief Constructor
+  //! \param[in] min_corner Minimum corner of the box
+  //! \param[in] max_corner Maximum corner of the box
+  AABB(const Vec3r &min_corner, const Vec3r &max_corner);
+
+  //! \brief Grow box to include input point
+  //! \param[in] point Point to include
+  inline void Extend(const Vec3r &point) {
+    min_ = min_.cwiseMin(point);
+    max_ = max_.cwiseMax(point);
+  }
+
+  //! \brief Grow box to include input box
+  //! \param[in] other Box to include
+  inline void Extend(const AABB &other) {
+    min_ = min_.cwiseMin(other.min_);
+    max_ = max_.cwiseMax(other.max_);
+  }
+
+  //! \brief Shrink box to its overlap with the input box
+  //! \param[in] other Box to intersect with
+  inline void Intersect(const AABB &other) {
+    min_ = min_.cwiseMax(other.min_);
+    max_ = max_.cwiseMin(other.max_);
+  }
+
+  //! \brief Check whether the box is empty
+  //! \return True if the box does not contain any point
+  inline bool IsEmpty() const {
+    return min_[0] > max_[0] || min_[1] > max_[1] || min_[2] > max_[2];
+  }
+
+  //! \brief Get minimum corner
+  //! \return Minimum corner
+  inline const Vec3r& GetMin() const {return min_;}
+
+  //! \brief Get maximum corner
+  //! \return Maximum corner
+  inline const Vec3r& GetMax() const {return max_;}
+
+  //! \brief Get box center
+  //! \return Box center
+  inline Vec3r GetCentroid() const {return (min_ + max_) * Real(0.5);}
+
+  //! \brief Get box diagonal (max - min)
+  //! \return Box diagonal
+  inline Vec3r GetDiagonal() const {return max_ - min_;}
+
+  //! \brief Get index of the axis along which the box is longest
+  //! \return 0, 1, or 2 for x, y, or z
+  uint GetMaxExtentAxis() const;
+
+  //! \brief Get box surface area; 0 for empty boxes
+  //! \return Surface area
+  Real GetSurfaceArea() const;
+
+  //! \brief Compute relative position of input point inside the
+  //! box: 0 at min corner and 1 at max corner along each axis
+  //! \param[in] point Input point
+  //! \return Relative position of point
+  Vec3r GetOffset(const Vec3r &point) const;
+
+  //! \brief Slab test against input ray
+  //! \param[in] ray Input ray
+  //! \param[in] tmin Minimum value for acceptable t
+  //! \param[in] tmax Maximum value for acceptable t
+  //! \return True if the ray overlaps the box inside [tmin, tmax]
+  bool Hit(const Ray &ray, Real tmin, Real tmax) const;
+protected:
+  Vec3r min_{kInfinity, kInfinity, kInfinity};     //!< minimum corner
+  Vec3r max_{-kInfinity, -kInfinity, -kInfinity};  //!< maximum corner
+};
+
+
+//! \brief Round to single precision without increasing the value
+//! \param[in] value Value to round
+//! \return Largest float that is <= value
+inline float RoundDownToFloat(Real value) {
+  if (value > std::numeric_limits<float>::max())
+    return std::numeric_limits<float>::max();
+  if (value < -std::numeric_limits<float>::max())
+    return -std::numeric_limits<float>::infinity();
+  auto rounded = static_cast<float>(value);
+  if (static_cast<Real>(rounded) > value)
+    rounded = std::nextafter(rounded, -std::numeric_limits<float>::infinity());
+  return rounded;
+}
+
+
+//! \brief Round to single precision without decreasing the value
+//! \param[in] value Value to round
+//! \return Smallest float that is >= value
+inline float RoundUpToFloat(Real value) {
+  if (value > std::numeric_limits<float>::max())
+    return std::numeric_limits<float>::infinity();
+  if (value < -std::numeric_limits<float>::max())
+    return -std::numeric_limits<float>::max();
+  auto rounded = static_cast<float>(value);
+  if (static_cast<Real>(rounded) < value)
+    rounded = std::nextafter(rounded, std::numeric_limits<float>::infinity());
+  return rounded;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
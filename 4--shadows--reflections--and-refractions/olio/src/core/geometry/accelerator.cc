@@ -0,0 +1,187 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       accelerator.cc
+//! \brief      Acceleration structure selection
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/accelerator.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <random>
+#include <spdlog/spdlog.h>
+#include "core/ray.h"
+#include "core/geometry/aabb.h"
+#include "core/geometry/surface_list.h"
+#include "core/geometry/bvh.h"
+#include "core/geometry/accelerator_cache.h"
+#include "core/geometry/wide_bvh.h"
+#include "core/geometry/compressed_bvh.h"
+#include "core/geometry/grid_accelerator.h"
+#include "core/geometry/kd_tree.h"
+#include "core/utils/cache_counters.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+namespace {
+
+// log the data cache misses of tracing a fixed batch of random rays
+// through the hierarchy's bounds on the calling thread
+void
+ReportCacheMisses(BVH &bvh, const string &label)
+{
+  constexpr uint kRayCount = 65536;
+  utils::CacheMissCounter counter;
+  if (!counter.IsAvailable()) {
+    spdlog::info("{}: cache miss counters are unavailable", bvh.GetName());
+    return;
+  }
+  AABB bbox;
+  if (!bvh.GetBoundingBox(bbox))
+    return;
+
+  // rays from points around the box towards points inside it
+  mt19937 generator(1);
+  uniform_real_distribution<Real> uniform(0, 1);
+  auto random_point = [&](Real scale) -> Vec3r {
+    Vec3r point;
+    for (int axis = 0; axis < 3; ++axis)
+      point[axis] = (uniform(generator) - static_cast<Real>(0.5)) * scale;
+    return bbox.GetCentroid() + point.cwiseProduct(bbox.GetMax() - bbox.GetMin());
+  };
+  vector<Ray> rays;
+  rays.reserve(kRayCount);
+  for (uint i = 0; i < kRayCount; ++i) {
+    Vec3r origin = random_point(3);
+    rays.push_back(Ray(origin, random_point(1) - origin));
+  }
+
+  utils::CacheMisses misses;
+  uint hit_count = 0;
+  counter.Start();
+  for (const auto &ray : rays) {
+    HitRecord hit_record;
+    if (bvh.Hit(ray, 0, kInfinity, hit_record))
+      ++hit_count;
+  }
+  counter.Stop(misses);
+  spdlog::info("{} ({}): {} L1D and {} last-level cache misses for {} rays "
+               "({} hits)", bvh.GetName(), label, misses.l1, misses.last_level,
+               kRayCount, hit_count);
+}
+
+}  // namespace
+
+
+bool
+ParseAcceleratorType(const string &name, AcceleratorType &type)
+{
+  string lower = name;
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) {
+      return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));});
+  if (lower == "list")
+    type = AcceleratorType::kSurfaceList;
+  else if (lower == "bvh")
+    type = AcceleratorType::kBVH;
+  else if (lower == "lbvh")
+    type = AcceleratorType::kLBVH;
+  else if (lower == "sbvh")
+    type = AcceleratorType::kSBVH;
+  else if (lower == "bvh4")
+    type = AcceleratorType::kBVH4;
+  else if (lower == "bvh8")
+    type = AcceleratorType::kBVH8;
+  else if (lower == "cbvh")
+    type = AcceleratorType::kCBVH;
+  else if (lower == "grid")
+    type = AcceleratorType::kGrid;
+  else if (lower == "grid2")
+    type = AcceleratorType::kGrid2;
+  else if (lower == "kdtree")
+    type = AcceleratorType::kKdTree;
+  else
+    return false;
+  return true;
+}
+
+
+Surface::Ptr
+CreateAccelerator(const vector<Surface::Ptr> &surfaces, AcceleratorType type,
+                  const AcceleratorOptions &options)
+{
+  auto start_time = chrono::system_clock::now();
+  // wide and compressed BVHs collapse the binary BVH into their own
+  // depth-first layout, so its nodes are only reordered when it is
+  // traced itself; the surfaces they copy are reordered either way
+  auto create_bvh = [&](BVH::BuildMethod method,
+                        bool collapsed) -> BVH::Ptr {
+    BVH::Ptr bvh = options.cache ? options.cache->GetBVH(surfaces, method) :
+      BVH::Create(surfaces, method);
+    if (options.report_cache_misses)
+      ReportCacheMisses(*bvh, "build order");
+    if (!collapsed)
+      bvh->ReorderNodes();
+    if (options.reorder_primitives)
+      bvh->ReorderPrimitives();
+    if (options.report_cache_misses && !collapsed)
+      ReportCacheMisses(*bvh, "reordered");
+    return bvh;
+  };
+  Surface::Ptr accelerator;
+  switch (type) {
+  case AcceleratorType::kBVH:
+    accelerator = create_bvh(BVH::BuildMethod::kBinnedSAH, false);
+    break;
+  case AcceleratorType::kLBVH:
+    accelerator = create_bvh(BVH::BuildMethod::kLinear, false);
+    break;
+  case AcceleratorType::kSBVH:
+    accelerator = create_bvh(BVH::BuildMethod::kSpatialSplit, false);
+    break;
+  case AcceleratorType::kBVH4:
+    accelerator = BVH4::Create(
+      *create_bvh(BVH::BuildMethod::kBinnedSAH, true));
+    break;
+  case AcceleratorType::kBVH8:
+    accelerator = BVH8::Create(
+      *create_bvh(BVH::BuildMethod::kBinnedSAH, true));
+    break;
+  case AcceleratorType::kCBVH:
+    accelerator = CompressedBVH::Create(
+      *create_bvh(BVH::BuildMethod::kBinnedSAH, true));
+    break;
+  case AcceleratorType::kGrid:
+    accelerator = GridAccelerator::Create(surfaces, false);
+    break;
+  case AcceleratorType::kGrid2:
+    accelerator = GridAccelerator::Create(surfaces, true);
+    break;
+  case AcceleratorType::kKdTree:
+    accelerator = KdTree::Create(surfaces);
+    break;
+  case AcceleratorType::kSurfaceList:
+  default:
+    accelerator = SurfaceList::Create(surfaces);
+    break;
+  }
+
+  auto end_time = chrono::system_clock::now();
+  auto build_time = chrono::duration_cast<chrono::duration<double>>
+    (end_time - start_time).count();
+  spdlog::info("Built {} over {} surface(s) in {} s", accelerator->GetName(),
+               surfaces.size(), build_time);
+  return accelerator;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,74 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       accelerator.h
+//! \brief      Acceleration structure selection
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "core/geometry/surface.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class AcceleratorCache;
+
+//! \brief Structure used to group the scene's surfaces for ray queries
+enum class AcceleratorType {
+  kSurfaceList,  //!< brute-force list: every ray tests every surface
+  kBVH,          //!< binned SAH bounding volume hierarchy
+  kLBVH,         //!< BVH built in parallel from sorted Morton codes
+  kSBVH,         //!< SAH BVH that also splits surfaces at spatial planes
+  kBVH4,         //!< 4-wide BVH collapsed from the binary BVH (SSE)
+  kBVH8,         //!< 8-wide BVH collapsed from the binary BVH (AVX)
+  kCBVH,         //!< 8-wide BVH with 8-bit quantized child bounds
+  kGrid,         //!< uniform grid traversed with a 3D-DDA
+  kGrid2,        //!< uniform grid whose dense cells hold sub-grids
+  kKdTree        //!< SAH kd-tree
+};
+
+//! \brief Parse an accelerator name as given on the command line
+//! \details Accepted names are "list", "bvh", "lbvh", "sbvh", "bvh4",
+//!          "bvh8", "cbvh", "grid", "grid2", and "kdtree"
+//!          (case-insensitive)
+//! \param[in] name Accelerator name
+//! \param[out] type Parsed accelerator type
+//! \return True if the name is known
+bool ParseAcceleratorType(const std::string &name, AcceleratorType &type);
+
+//! \brief Options for CreateAccelerator()
+struct AcceleratorOptions {
+  AcceleratorCache *cache{nullptr};  //!< optional cache of previously built BVHs
+  bool reorder_primitives{false};    //!< copy spheres and triangles into leaf order
+  bool report_cache_misses{false};   //!< log data cache misses of a ray batch before and after reordering
+};
+
+//! \brief Create the acceleration structure of the requested type
+//!        over the input surfaces
+//! \details BVH-based structures (including the wide BVHs collapsed
+//!          from a binary BVH) are restored from, or recorded in, the
+//!          cache when one is given. Their nodes are laid out in
+//!          treelets (BVH::ReorderNodes) and, if requested, their
+//!          surfaces replaced with copies in leaf order
+//!          (BVH::ReorderPrimitives); only request that if the caller
+//!          no longer needs the surfaces' identities.
+//! \param[in] surfaces Scene surfaces
+//! \param[in] type Type of acceleration structure to build
+//! \param[in] options Cache and memory layout options
+//! \return Surface grouping all input surfaces
+Surface::Ptr CreateAccelerator(const std::vector<Surface::Ptr> &surfaces,
+                               AcceleratorType type,
+                               const AcceleratorOptions &options=AcceleratorOptions());
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,354 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       accelerator_cache.cc
+//! \brief      AcceleratorCache class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/accelerator_cache.h"
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+#include <spdlog/spdlog.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+constexpr uint64_t AcceleratorCache::kHashSeed;
+constexpr uint32_t AcceleratorCache::kVersion;
+
+namespace {
+
+// file layout: header, entry table, then one 64-byte aligned node
+// section and one primitive index section per BVH; all positions are
+// byte offsets from the start of the file
+struct CacheHeader {
+  char magic[8];         // kCacheMagic
+  uint32_t version;      // AcceleratorCache::kVersion
+  uint32_t node_size;    // sizeof(LinearBVHNode)
+  uint64_t key;          // cache key
+  uint64_t entry_count;  // number of BVHs
+};
+
+
+struct CacheEntry {
+  uint64_t node_offset;    // position of the node section
+  uint64_t node_count;     // number of nodes
+  uint64_t index_offset;   // position of the primitive index section
+  uint64_t index_count;    // number of primitive indices
+  uint64_t surface_count;  // surfaces the BVH was built over
+  uint32_t method;         // BVH::BuildMethod
+  uint32_t pad;            // unused
+  double bbox_min[3];      // bounding box of all surfaces
+  double bbox_max[3];
+};
+
+
+constexpr char kCacheMagic[8] = {'O', 'L', 'I', 'O', 'A', 'C', 'C', 'L'};
+constexpr uint64_t kSectionAlignment = 64;
+
+
+inline uint64_t
+AlignSection(uint64_t offset)
+{
+  return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+}  // namespace
+
+
+AcceleratorCache::AcceleratorCache(const string &directory, uint64_t key) :
+  key_{key}
+{
+  ostringstream name;
+  name << hex << setw(16) << setfill('0') << key << ".olioaccel";
+  filename_ = (fs::path(directory) / name.str()).string();
+
+  // map the file
+#ifndef WIN32
+  int fd = open(filename_.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    auto size = static_cast<size_t>(file_stat.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      data_ = static_cast<const char*>(mapped);
+      size_ = size;
+    }
+  }
+  close(fd);
+#else
+  ifstream in(filename_, ios::binary);
+  if (!in)
+    return;
+  buffer_.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#endif
+  if (!data_)
+    return;
+
+  // only files written for this key and node layout are usable
+  const auto *header = reinterpret_cast<const CacheHeader*>(data_);
+  if (size_ < sizeof(CacheHeader) ||
+      memcmp(header->magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+      header->version != kVersion ||
+      header->node_size != sizeof(LinearBVHNode) || header->key != key_ ||
+      header->entry_count > (size_ - sizeof(CacheHeader)) / sizeof(CacheEntry)) {
+    spdlog::warn("AcceleratorCache: ignoring invalid cache file {}", filename_);
+    Unmap();
+    return;
+  }
+  spdlog::info("AcceleratorCache: mapped {} with {} BVH(s)", filename_,
+               header->entry_count);
+}
+
+
+AcceleratorCache::~AcceleratorCache()
+{
+  Unmap();
+}
+
+
+void
+AcceleratorCache::Unmap()
+{
+#ifndef WIN32
+  if (data_)
+    munmap(const_cast<char*>(data_), size_);
+#else
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+
+BVH::Ptr
+AcceleratorCache::GetBVH(const vector<Surface::Ptr> &surfaces,
+                         BVH::BuildMethod method)
+{
+  // surface indices are recorded now, as callers may replace the
+  // hierarchy's surfaces (see BVH::ReorderPrimitives)
+  Record record{surfaces.size(), {}, nullptr};
+  record.bvh = Restore(records_.size(), surfaces, method, record.indices);
+  if (record.bvh) {
+    ++restored_count_;
+  } else {
+    record.bvh = BVH::Create(surfaces, method);
+    unordered_map<const Surface*, uint32_t> surface_indices;
+    surface_indices.reserve(surfaces.size());
+    for (size_t i = 0; i < surfaces.size(); ++i)
+      surface_indices.emplace(surfaces[i].get(), static_cast<uint32_t>(i));
+    const auto &primitives = record.bvh->GetPrimitives();
+    record.indices.reserve(primitives.size());
+    for (const auto &primitive : primitives)
+      record.indices.push_back(surface_indices[primitive.get()]);
+  }
+  records_.push_back(std::move(record));
+  return records_.back().bvh;
+}
+
+
+BVH::Ptr
+AcceleratorCache::Restore(size_t index, const vector<Surface::Ptr> &surfaces,
+                          BVH::BuildMethod method,
+                          vector<uint32_t> &primitive_indices) const
+{
+  if (!data_)
+    return nullptr;
+  const auto *header = reinterpret_cast<const CacheHeader*>(data_);
+  if (index >= header->entry_count)
+    return nullptr;
+  const auto &entry = reinterpret_cast<const CacheEntry*>(
+    data_ + sizeof(CacheHeader))[index];
+  if (entry.method != static_cast<uint32_t>(method) ||
+      entry.surface_count != surfaces.size())
+    return nullptr;
+
+  // sections must be aligned and lie inside the file
+  auto in_file = [&](uint64_t offset, uint64_t count, size_t element_size) -> bool {
+    return offset % kSectionAlignment == 0 && offset <= size_ &&
+      count <= (size_ - offset) / element_size;
+  };
+  if (!in_file(entry.node_offset, entry.node_count, sizeof(LinearBVHNode)) ||
+      !in_file(entry.index_offset, entry.index_count, sizeof(uint32_t))) {
+    spdlog::warn("AcceleratorCache: BVH {} in {} is truncated", index, filename_);
+    return nullptr;
+  }
+  const auto *nodes = reinterpret_cast<const LinearBVHNode*>(
+    data_ + entry.node_offset);
+  const auto *indices = reinterpret_cast<const uint32_t*>(
+    data_ + entry.index_offset);
+  auto node_count = static_cast<size_t>(entry.node_count);
+  auto index_count = static_cast<size_t>(entry.index_count);
+
+  // nodes must form a tree of sibling pairs that fits the traversal
+  // stack, with every node reached once and leaves indexing valid
+  // surfaces
+  bool valid = (node_count > 0) == (index_count > 0);
+  for (size_t i = 0; valid && i < index_count; ++i)
+    valid = indices[i] < surfaces.size();
+  struct PendingNode {
+    size_t index;
+    uint depth;
+  };
+  vector<bool> visited(node_count, false);
+  vector<PendingNode> stack;
+  if (node_count)
+    stack.push_back(PendingNode{0, 1});
+  while (valid && stack.size()) {
+    PendingNode pending = stack.back();
+    stack.pop_back();
+    valid = !visited[pending.index];
+    visited[pending.index] = true;
+    const LinearBVHNode &node = nodes[pending.index];
+    if (node.IsLeaf()) {
+      valid = valid &&
+        node.offset + static_cast<size_t>(node.primitive_count) <= index_count;
+    } else {
+      // the bound is computed in size_t, so that offsets near
+      // UINT32_MAX cannot wrap around
+      auto children = static_cast<size_t>(node.offset);
+      valid = valid && children > 0 && children + 1 < node_count &&
+        pending.depth < BVH::kMaxDepth;
+      if (valid) {
+        stack.push_back(PendingNode{children + 1, pending.depth + 1});
+        stack.push_back(PendingNode{children, pending.depth + 1});
+      }
+    }
+  }
+  if (!valid) {
+    spdlog::warn("AcceleratorCache: BVH {} in {} is invalid", index, filename_);
+    return nullptr;
+  }
+
+  AABB bbox{Vec3r{static_cast<Real>(entry.bbox_min[0]),
+                  static_cast<Real>(entry.bbox_min[1]),
+                  static_cast<Real>(entry.bbox_min[2])},
+            Vec3r{static_cast<Real>(entry.bbox_max[0]),
+                  static_cast<Real>(entry.bbox_max[1]),
+                  static_cast<Real>(entry.bbox_max[2])}};
+  primitive_indices.assign(indices, indices + index_count);
+  return BVH::Create(surfaces, method, nodes, node_count, indices, index_count,
+                     bbox);
+}
+
+
+bool
+AcceleratorCache::Save() const
+{
+  if (restored_count_ == records_.size())
+    return true;
+
+  // lay out the file
+  CacheHeader header;
+  memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+  header.version = kVersion;
+  header.node_size = sizeof(LinearBVHNode);
+  header.key = key_;
+  header.entry_count = records_.size();
+  vector<CacheEntry> entries(records_.size());
+  uint64_t offset = AlignSection(sizeof(CacheHeader) +
+                                 entries.size() * sizeof(CacheEntry));
+  for (size_t i = 0; i < records_.size(); ++i) {
+    const Record &record = records_[i];
+    CacheEntry &entry = entries[i];
+    memset(&entry, 0, sizeof(CacheEntry));
+    entry.node_offset = offset;
+    entry.node_count = record.bvh->GetNodes().size();
+    offset = AlignSection(offset + entry.node_count * sizeof(LinearBVHNode));
+    entry.index_offset = offset;
+    entry.index_count = record.indices.size();
+    offset = AlignSection(offset + entry.index_count * sizeof(uint32_t));
+    entry.surface_count = record.surface_count;
+    entry.method = static_cast<uint32_t>(record.bvh->GetBuildMethod());
+    AABB bbox;
+    record.bvh->GetBoundingBox(bbox);
+    for (uint axis = 0; axis < 3; ++axis) {
+      entry.bbox_min[axis] = static_cast<double>(bbox.GetMin()[axis]);
+      entry.bbox_max[axis] = static_cast<double>(bbox.GetMax()[axis]);
+    }
+  }
+
+  // write to a temporary file first so readers never see partial files
+  boost::system::error_code error;
+  fs::create_directories(fs::path(filename_).parent_path(), error);
+  string temp_filename = filename_ + ".tmp";
+  ofstream out(temp_filename, ios::binary);
+  if (!out) {
+    spdlog::error("AcceleratorCache: could not open file {} for writing",
+                  temp_filename);
+    return false;
+  }
+  uint64_t position = 0;
+  auto write = [&](const void *data, uint64_t size) {
+    out.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+    position += size;
+  };
+  auto pad = [&](uint64_t target) {
+    const char zeros[kSectionAlignment] = {0};
+    write(zeros, target - position);
+  };
+  write(&header, sizeof(CacheHeader));
+  write(entries.data(), entries.size() * sizeof(CacheEntry));
+  for (size_t i = 0; i < records_.size(); ++i) {
+    pad(entries[i].node_offset);
+    write(records_[i].bvh->GetNodes().data(),
+          entries[i].node_count * sizeof(LinearBVHNode));
+    pad(entries[i].index_offset);
+    write(records_[i].indices.data(), entries[i].index_count * sizeof(uint32_t));
+  }
+  out.close();
+  if (!out) {
+    spdlog::error("AcceleratorCache: could not write file {}", temp_filename);
+    fs::remove(temp_filename, error);
+    return false;
+  }
+  fs::rename(temp_filename, filename_, error);
+  if (error) {
+    spdlog::error("AcceleratorCache: could not rename {} to {}: {}",
+                  temp_filename, filename_, error.message());
+    return false;
+  }
+  spdlog::info("AcceleratorCache: wrote {} BVH(s) to {}", records_.size(),
+               filename_);
+  return true;
+}
+
+
+uint64_t
+AcceleratorCache::Hash(const void *data, size_t size, uint64_t hash)
+{
+  const auto *bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
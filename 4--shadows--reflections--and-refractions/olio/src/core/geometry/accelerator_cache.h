@@ -0,0 +1,116 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       accelerator_cache.h
+//! \brief      AcceleratorCache class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tbb/cache_aligned_allocator.h>
+#include "core/geometry/surface.h"
+#include "core/geometry/bvh.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \class AcceleratorCache
+//! \brief On-disk cache of the BVHs built while loading a scene
+//! \details A cache file holds, in build order, the nodes of every
+//! binary BVH built for a scene and the leaf-order indices of their
+//! surfaces in the list each BVH was built over. The file only contains
+//! offsets and indices, so it is loaded by mapping it into memory,
+//! without pointer fixups. Files are named after a key that hashes
+//! whatever the cached structures depend on (see Hash()). A cached BVH
+//! is only restored if its build method and surface count match the
+//! request and its nodes pass validation; otherwise it is rebuilt and
+//! the file rewritten by Save().
+class AcceleratorCache {
+public:
+  //! \brief Constructor; maps the cache file for the key, if it exists
+  //!        and was written for the same key and node layout
+  //! \param[in] directory Directory holding cache files
+  //! \param[in] key Hash of the scene content the cache depends on
+  AcceleratorCache(const std::string &directory, uint64_t key);
+
+  //! \brief Destructor; unmaps the cache file
+  ~AcceleratorCache();
+
+  AcceleratorCache(const AcceleratorCache&) = delete;
+  AcceleratorCache& operator=(const AcceleratorCache&) = delete;
+
+  //! \brief Get the next BVH of the scene: restored from the cache
+  //!        file if it holds a matching one, built otherwise
+  //! \param[in] surfaces Surfaces to build the hierarchy over
+  //! \param[in] method Build algorithm
+  //! \return Restored or newly built hierarchy
+  BVH::Ptr GetBVH(const std::vector<Surface::Ptr> &surfaces,
+                  BVH::BuildMethod method);
+
+  //! \brief Write all BVHs requested so far to the cache file, unless
+  //!        every one of them was restored from it
+  //! \return True if the file is up to date
+  bool Save() const;
+
+  //! \brief Get the number of BVHs restored from the cache file
+  //! \return Number of restored hierarchies
+  size_t GetRestoredCount() const {return restored_count_;}
+
+  //! \brief Get the cache file's path
+  //! \return Cache file path
+  const std::string& GetFileName() const {return filename_;}
+
+  //! \brief Hash bytes with 64-bit FNV-1a, e.g., to compute cache keys
+  //! \param[in] data Bytes to hash
+  //! \param[in] size Number of bytes
+  //! \param[in] hash Hash to continue from
+  //! \return Updated hash
+  static uint64_t Hash(const void *data, size_t size,
+                       uint64_t hash=kHashSeed);
+
+  static constexpr uint64_t kHashSeed = 14695981039346656037ull;  //!< FNV-1a offset basis
+  static constexpr uint32_t kVersion = 2;  //!< file format version
+protected:
+  //! \brief BVH requested from the cache, kept for Save()
+  struct Record {
+    size_t surface_count;           //!< surfaces the BVH was built over
+    std::vector<uint32_t> indices;  //!< leaf-order surface indices
+    BVH::Ptr bvh;                   //!< hierarchy
+  };
+
+  //! \brief Restore a cached BVH if it matches the request
+  //! \param[in] index Index of the BVH in the file
+  //! \param[in] surfaces Surfaces to build the hierarchy over
+  //! \param[in] method Build algorithm
+  //! \param[out] primitive_indices Leaf-order surface indices of the
+  //!             restored hierarchy
+  //! \return Restored hierarchy; null if missing, stale, or invalid
+  BVH::Ptr Restore(size_t index, const std::vector<Surface::Ptr> &surfaces,
+                   BVH::BuildMethod method,
+                   std::vector<uint32_t> &primitive_indices) const;
+
+  //! \brief Release the cache file's content
+  void Unmap();
+
+  std::string filename_;           //!< cache file path
+  uint64_t key_;                   //!< cache key
+  const char *data_{nullptr};      //!< mapped file content
+  size_t size_{0};                 //!< mapped file size
+  std::vector<char, tbb::cache_aligned_allocator<char>> buffer_;  //!< file content where mapping is unavailable
+  std::vector<Record> records_;    //!< BVHs requested so far
+  size_t restored_count_{0};       //!< BVHs restored from the file
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,1376 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       bvh.cc
+//! \brief      BVH class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/bvh.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <queue>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#include <tbb/parallel_reduce.h>
+#include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/packet_traversal.h"
+#include "core/geometry/sphere.h"
+#include "core/geometry/triangle.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+constexpr uint BVH::kBinCount;
+constexpr size_t BVH::kMaxLeafSize;
+constexpr uint BVH::kMaxDepth;
+constexpr uint BVH::kPacketDivergence;
+constexpr Real BVH::kTraversalCost;
+constexpr size_t BVH::kParallelBuildSize;
+constexpr Real BVH::kMaxRefitCostRatio;
+constexpr uint BVH::kSpatialBinCount;
+constexpr Real BVH::kSpatialSplitAlpha;
+constexpr Real BVH::kMaxDuplicationRatio;
+
+namespace {
+
+// one block of memory holding the leaf-ordered copies made by
+// BVH::ReorderPrimitives(). The copies' deleters share ownership of
+// the arena, so it is freed with the last copy
+class PrimitiveArena : public std::enable_shared_from_this<PrimitiveArena> {
+public:
+  // at least the alignment Eigen's operator new gives
+  static constexpr size_t kAlignment =
+    EIGEN_MAX_ALIGN_BYTES > 16 ? EIGEN_MAX_ALIGN_BYTES : 16;
+  static constexpr size_t kCacheLineSize = 64;
+
+  static size_t RoundUp(size_t size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+  explicit PrimitiveArena(size_t size) :
+    buffer_{new char[size + kCacheLineSize]}
+  {
+    auto address = reinterpret_cast<uintptr_t>(buffer_.get());
+    base_ = buffer_.get() + (kCacheLineSize - address % kCacheLineSize) %
+      kCacheLineSize;
+  }
+
+  // copy a surface into the next free slot; the caller sized the
+  // arena for all copies
+  template<typename T>
+  Surface::Ptr Copy(const T &surface) {
+    void *slot = base_ + used_;
+    used_ += RoundUp(sizeof(T));
+    return Surface::Ptr(::new (slot) T(surface), Deleter{shared_from_this()});
+  }
+private:
+  // destroys a copy in place and releases its share of the arena
+  struct Deleter {
+    std::shared_ptr<PrimitiveArena> arena;
+    void operator()(Surface *surface) const {surface->~Surface();}
+  };
+
+  std::unique_ptr<char[]> buffer_;
+  char *base_{nullptr};
+  size_t used_{0};
+};
+
+// node with the input bounds rounded outwards to single precision
+inline LinearBVHNode
+MakeNode(const AABB &bbox)
+{
+  LinearBVHNode node;
+  for (int axis = 0; axis < 3; ++axis) {
+    node.bbox_min[axis] = RoundDownToFloat(bbox.GetMin()[axis]);
+    node.bbox_max[axis] = RoundUpToFloat(bbox.GetMax()[axis]);
+  }
+  node.offset = 0;
+  node.primitive_count = 0;
+  node.axis = 0;
+  node.pad = 0;
+  return node;
+}
+
+
+// unused node with empty bounds that aligns sibling pairs
+inline LinearBVHNode
+MakePaddingNode()
+{
+  return MakeNode(AABB{Vec3r::Zero(), Vec3r::Zero()});
+}
+
+
+inline Real
+NodeSurfaceArea(const LinearBVHNode &node)
+{
+  AABB bbox{Vec3r{node.bbox_min[0], node.bbox_min[1], node.bbox_min[2]},
+            Vec3r{node.bbox_max[0], node.bbox_max[1], node.bbox_max[2]}};
+  return bbox.GetSurfaceArea();
+}
+
+
+// 30-bit Morton code of a surface centroid and the surface's index
+struct MortonPrimitive {
+  uint32_t code;
+  uint32_t index;
+};
+
+
+// spread the lower 10 bits of x so that two zero bits follow each bit
+inline uint32_t
+LeftShift3(uint32_t x)
+{
+  x = std::min(x, 1023u);
+  x = (x | (x << 16)) & 0x030000ff;
+  x = (x | (x << 8)) & 0x0300f00f;
+  x = (x | (x << 4)) & 0x030c30c3;
+  x = (x | (x << 2)) & 0x09249249;
+  return x;
+}
+
+
+// Morton code of a point given relative to the centroid bounds
+// (each coordinate in [0, 1]); bit 3k + 2 is x, 3k + 1 is y, 3k is z
+inline uint32_t
+MortonCode(const Vec3r &offset)
+{
+  uint32_t xyz[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    Real scaled = std::min(std::max(offset[axis] * 1024, Real(0)), Real(1023));
+    xyz[axis] = static_cast<uint32_t>(scaled);
+  }
+  return (LeftShift3(xyz[0]) << 2) | (LeftShift3(xyz[1]) << 1) |
+    LeftShift3(xyz[2]);
+}
+
+
+// stable parallel LSD radix sort by Morton code, 8 bits per pass:
+// blocks histogram their digits, a prefix sum over (digit, block)
+// gives each block its output slots, and blocks scatter in order
+void
+RadixSort(vector<MortonPrimitive> &values)
+{
+  constexpr uint kDigitBits = 8;
+  constexpr uint kDigitCount = 1 << kDigitBits;
+  constexpr size_t kBlockSize = 16384;
+  const size_t count = values.size();
+  const size_t block_count = (count + kBlockSize - 1) / kBlockSize;
+  vector<MortonPrimitive> scratch(count);
+  vector<array<size_t, kDigitCount>> offsets(block_count);
+  vector<MortonPrimitive> *in = &values, *out = &scratch;
+  for (uint shift = 0; shift < 32; shift += kDigitBits) {
+    auto digit = [shift](const MortonPrimitive &value) -> uint32_t {
+      return (value.code >> shift) & (kDigitCount - 1);
+    };
+    tbb::parallel_for(size_t(0), block_count, [&](size_t block) {
+        auto &histogram = offsets[block];
+        histogram.fill(0);
+        size_t end = std::min(count, (block + 1) * kBlockSize);
+        for (size_t i = block * kBlockSize; i < end; ++i)
+          ++histogram[digit((*in)[i])];
+      });
+    size_t total = 0;
+    for (uint d = 0; d < kDigitCount; ++d) {
+      for (size_t block = 0; block < block_count; ++block) {
+        size_t block_digit_count = offsets[block][d];
+        offsets[block][d] = total;
+        total += block_digit_count;
+      }
+    }
+    tbb::parallel_for(size_t(0), block_count, [&](size_t block) {
+        auto &slots = offsets[block];
+        size_t end = std::min(count, (block + 1) * kBlockSize);
+        for (size_t i = block * kBlockSize; i < end; ++i)
+          (*out)[slots[digit((*in)[i])]++] = (*in)[i];
+      });
+    std::swap(in, out);
+  }
+  // an even number of passes leaves the result in 'values'
+}
+
+
+// temporary LBVH node; children are indices into the build node array
+// and bounds are already rounded outwards to single precision
+struct LinearBuildNode {
+  float bbox_min[3], bbox_max[3];
+  uint32_t start, end;    // primitive range
+  uint32_t children[2];   // inner node children; unused for leaves
+  uint32_t node_count;    // number of nodes in the subtree
+  uint8_t axis;           // axis of the split bit
+  bool leaf;
+};
+
+
+// shared state of the LBVH build tasks
+template <typename PrimitiveArray>
+struct LinearBuildContext {
+  const vector<MortonPrimitive> &morton;
+  const PrimitiveArray &primitives;
+  vector<LinearBuildNode> &build_nodes;
+  atomic<uint32_t> next_node;
+};
+
+
+// build the subtree over the primitives of sorted codes [start, end)
+// and return its build node index
+template <typename PrimitiveArray>
+uint32_t
+BuildLinearSubtree(LinearBuildContext<PrimitiveArray> &context, uint32_t start, uint32_t end)
+{
+  uint32_t node_index = context.next_node++;
+  LinearBuildNode &node = context.build_nodes[node_index];
+  node.start = start;
+  node.end = end;
+  node.axis = 0;
+  uint32_t count = end - start;
+  uint32_t first_code = context.morton[start].code;
+  uint32_t last_code = context.morton[end - 1].code;
+  node.leaf = count == 1 || (first_code == last_code &&
+                             count <= BVH::kMaxLeafSize);
+  if (node.leaf) {
+    AABB bbox;
+    for (uint32_t i = start; i < end; ++i)
+      bbox.Extend(context.primitives[context.morton[i].index].bbox);
+    for (int axis = 0; axis < 3; ++axis) {
+      node.bbox_min[axis] = RoundDownToFloat(bbox.GetMin()[axis]);
+      node.bbox_max[axis] = RoundUpToFloat(bbox.GetMax()[axis]);
+    }
+    node.node_count = 1;
+    return node_index;
+  }
+
+  // split where the highest differing code bit flips; codes that are
+  // all equal are split in the middle
+  uint32_t mid = start + count / 2;
+  if (first_code != last_code) {
+    uint bit = 29;
+    while (!(((first_code ^ last_code) >> bit) & 1))
+      --bit;
+    uint32_t mask = 1u << bit;
+    auto first_set = std::partition_point(
+      context.morton.begin() + start, context.morton.begin() + end,
+      [mask](const MortonPrimitive &value) {return !(value.code & mask);});
+    mid = static_cast<uint32_t>(first_set - context.morton.begin());
+    node.axis = static_cast<uint8_t>(2 - bit % 3);
+  }
+
+  if (count > BVH::kParallelBuildSize) {
+    tbb::parallel_invoke(
+      [&]() {node.children[0] = BuildLinearSubtree(context, start, mid);},
+      [&]() {node.children[1] = BuildLinearSubtree(context, mid, end);});
+  } else {
+    node.children[0] = BuildLinearSubtree(context, start, mid);
+    node.children[1] = BuildLinearSubtree(context, mid, end);
+  }
+  const LinearBuildNode &left = context.build_nodes[node.children[0]];
+  const LinearBuildNode &right = context.build_nodes[node.children[1]];
+  for (int axis = 0; axis < 3; ++axis) {
+    node.bbox_min[axis] = std::min(left.bbox_min[axis], right.bbox_min[axis]);
+    node.bbox_max[axis] = std::max(left.bbox_max[axis], right.bbox_max[axis]);
+  }
+  node.node_count = 1 + left.node_count + right.node_count;
+  return node_index;
+}
+
+
+// write a build node to 'node_index' and its descendants, as sibling
+// pairs in depth-first order, to 'nodes' from 'next' on; subtree sizes
+// give each pair its slots
+void
+EmitLinearSubtree(const vector<LinearBuildNode> &build_nodes,
+                  uint32_t build_index, LinearBVHNode *nodes,
+                  uint32_t node_index, uint32_t next)
+{
+  const LinearBuildNode &build_node = build_nodes[build_index];
+  LinearBVHNode &node = nodes[node_index];
+  std::copy(build_node.bbox_min, build_node.bbox_min + 3, node.bbox_min);
+  std::copy(build_node.bbox_max, build_node.bbox_max + 3, node.bbox_max);
+  node.offset = 0;
+  node.primitive_count = 0;
+  node.axis = 0;
+  node.pad = 0;
+  if (build_node.leaf) {
+    node.offset = build_node.start;
+    node.primitive_count = static_cast<uint16_t>(build_node.end -
+                                                 build_node.start);
+    return;
+  }
+
+  // the children's pair comes first, then the first child's descendants
+  uint32_t first_child = next;
+  uint32_t first_next = next + 2;
+  uint32_t second_next = first_next +
+    build_nodes[build_node.children[0]].node_count - 1;
+  node.offset = first_child;
+  node.axis = build_node.axis;
+  if (build_node.end - build_node.start > BVH::kParallelBuildSize) {
+    tbb::parallel_invoke(
+      [&]() {EmitLinearSubtree(build_nodes, build_node.children[0], nodes,
+                               first_child, first_next);},
+      [&]() {EmitLinearSubtree(build_nodes, build_node.children[1], nodes,
+                               first_child + 1, second_next);});
+  } else {
+    EmitLinearSubtree(build_nodes, build_node.children[0], nodes,
+                      first_child, first_next);
+    EmitLinearSubtree(build_nodes, build_node.children[1], nodes,
+                      first_child + 1, second_next);
+  }
+}
+
+
+// stable parallel partition of values[begin, end): blocks count their
+// matches, a prefix sum gives each block its output slots, and blocks
+// scatter in order; returns the index of the first non-matching value
+template <typename Value, typename Predicate>
+size_t
+ParallelPartition(vector<Value> &values, size_t begin, size_t end,
+                  Predicate predicate)
+{
+  constexpr size_t kBlockSize = 16384;
+  const size_t count = end - begin;
+  const size_t block_count = (count + kBlockSize - 1) / kBlockSize;
+  vector<char> matches(count);
+  vector<size_t> match_counts(block_count);
+  tbb::parallel_for(size_t(0), block_count, [&](size_t block) {
+      size_t block_end = std::min(count, (block + 1) * kBlockSize);
+      size_t match_count = 0;
+      for (size_t i = block * kBlockSize; i < block_end; ++i) {
+        matches[i] = predicate(values[begin + i]) ? 1 : 0;
+        match_count += static_cast<size_t>(matches[i]);
+      }
+      match_counts[block] = match_count;
+    });
+  vector<size_t> match_offsets(block_count), other_offsets(block_count);
+  size_t match_total = 0;
+  for (size_t block = 0; block < block_count; ++block) {
+    match_offsets[block] = match_total;
+    match_total += match_counts[block];
+  }
+  size_t other_total = match_total;
+  for (size_t block = 0; block < block_count; ++block) {
+    size_t block_end = std::min(count, (block + 1) * kBlockSize);
+    other_offsets[block] = other_total;
+    other_total += block_end - block * kBlockSize - match_counts[block];
+  }
+  vector<Value> scratch(count);
+  tbb::parallel_for(size_t(0), block_count, [&](size_t block) {
+      size_t match_slot = match_offsets[block];
+      size_t other_slot = other_offsets[block];
+      size_t block_end = std::min(count, (block + 1) * kBlockSize);
+      for (size_t i = block * kBlockSize; i < block_end; ++i)
+        scratch[matches[i] ? match_slot++ : other_slot++] =
+          std::move(values[begin + i]);
+    });
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, count),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i)
+        values[begin + i] = std::move(scratch[i]);
+    });
+  return begin + match_total;
+}
+
+
+// move a subtree built into its own node array, with its root at index
+// 0, to 'nodes': the root goes to 'slot' and the other nodes are
+// appended, with inner nodes' child offsets shifted to match
+void
+AppendSubtree(BVH::NodeArray &nodes, const BVH::NodeArray &subtree,
+              uint32_t slot)
+{
+  // subtree node i > 0 goes to base + i
+  auto base = static_cast<uint32_t>(nodes.size() - 1);
+  auto relocate = [base](LinearBVHNode node) -> LinearBVHNode {
+    if (!node.IsLeaf())
+      node.offset += base;
+    return node;
+  };
+  nodes[slot] = relocate(subtree[0]);
+  nodes.resize(nodes.size() + subtree.size() - 1);
+  tbb::parallel_for(tbb::blocked_range<size_t>(1, subtree.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i)
+        nodes[base + i] = relocate(subtree[i]);
+    });
+}
+
+
+}  // namespace
+
+
+BVH::BVH(const vector<Surface::Ptr> &surfaces, const std::string &name) :
+  BVH{surfaces, BuildMethod::kBinnedSAH, name}
+{
+}
+
+
+BVH::BVH(const vector<Surface::Ptr> &surfaces, BuildMethod method,
+         const std::string &name) :
+  Surface{},
+  method_{method}
+{
+  if (name.size())
+    name_ = name;
+  else if (method == BuildMethod::kLinear)
+    name_ = "LBVH";
+  else if (method == BuildMethod::kSpatialSplit)
+    name_ = "SBVH";
+  else
+    name_ = "BVH";
+  Init(surfaces);
+}
+
+
+BVH::BVH(const vector<Surface::Ptr> &surfaces, BuildMethod method,
+         const LinearBVHNode *nodes, size_t node_count,
+         const uint32_t *primitive_indices, size_t primitive_count,
+         const AABB &bbox, const std::string &name) :
+  BVH{vector<Surface::Ptr>{}, method, name}
+{
+  nodes_.assign(nodes, nodes + node_count);
+  primitives_.resize(primitive_count);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, primitive_count),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i)
+        primitives_[i] = surfaces[primitive_indices[i]];
+    });
+  bbox_ = bbox;
+  build_cost_ = GetSAHCost();
+}
+
+
+void
+BVH::Init(const vector<Surface::Ptr> &surfaces)
+{
+  nodes_.clear();
+  primitives_.clear();
+  bbox_ = AABB();
+  build_cost_ = 0;
+
+  // gather bounds of all surfaces
+  vector<PrimitiveInfo> primitives(surfaces.size());
+  vector<char> bounded(surfaces.size(), 0);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, surfaces.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i) {
+        PrimitiveInfo &info = primitives[i];
+        if (!surfaces[i] || !surfaces[i]->GetBoundingBox(info.bbox))
+          continue;
+        info.surface = surfaces[i];
+        info.index = static_cast<uint32_t>(i);
+        info.centroid = info.bbox.GetCentroid();
+        bounded[i] = 1;
+      }
+    });
+  size_t primitive_count = 0;
+  for (size_t i = 0; i < primitives.size(); ++i) {
+    if (!bounded[i]) {
+      spdlog::warn("BVH: skipping unbounded surface");
+      continue;
+    }
+    bbox_.Extend(primitives[i].bbox);
+    if (primitive_count != i)
+      primitives[primitive_count] = std::move(primitives[i]);
+    ++primitive_count;
+  }
+  primitives.resize(primitive_count);
+  if (!primitives.size())
+    return;
+
+  if (method_ == BuildMethod::kLinear) {
+    BuildLinear(primitives);
+  } else if (method_ == BuildMethod::kSpatialSplit) {
+    // each reference adds at most two nodes
+    auto budget = static_cast<size_t>(kMaxDuplicationRatio *
+                                      static_cast<Real>(primitives.size()));
+    nodes_.reserve(2 * (primitives.size() + budget));
+    primitives_.reserve(primitives.size() + budget);
+    Real min_overlap_area = kSpatialSplitAlpha * bbox_.GetSurfaceArea();
+    nodes_.emplace_back();
+    BuildSpatial(primitives, 0, min_overlap_area, budget, 0);
+    nodes_.shrink_to_fit();
+    primitives_.shrink_to_fit();
+  } else {
+    // build nodes in depth-first order; a binary tree has fewer than
+    // 2n nodes
+    nodes_.reserve(2 * primitives.size());
+    nodes_.emplace_back();
+    Build(primitives, 0, primitives.size(), 0, nodes_, 0);
+    nodes_.shrink_to_fit();
+
+    // store surfaces in leaf order
+    primitives_.resize(primitives.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, primitives.size()),
+                      [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++i)
+          primitives_[i] = std::move(primitives[i].surface);
+      });
+  }
+  build_cost_ = GetSAHCost();
+}
+
+
+uint32_t
+BVH::AddPair(NodeArray &nodes, uint depth)
+{
+  if (!depth)
+    nodes.push_back(MakePaddingNode());
+  auto first = static_cast<uint32_t>(nodes.size());
+  nodes.resize(nodes.size() + 2);
+  return first;
+}
+
+
+void
+BVH::Build(vector<PrimitiveInfo> &primitives, size_t start, size_t end,
+           uint depth, NodeArray &nodes, uint32_t node_index)
+{
+  // large ranges are reduced, binned, and partitioned in parallel
+  size_t count = end - start;
+  bool parallel = count > kParallelBuildSize;
+  tbb::blocked_range<size_t> range(start, end, kParallelBuildSize / 4);
+
+  // bounds of the primitives and of their centroids
+  using Bounds = pair<AABB, AABB>;
+  auto gather_bounds = [&](const tbb::blocked_range<size_t> &r, Bounds bounds) -> Bounds {
+    for (size_t i = r.begin(); i < r.end(); ++i) {
+      bounds.first.Extend(primitives[i].bbox);
+      bounds.second.Extend(primitives[i].centroid);
+    }
+    return bounds;
+  };
+  Bounds bounds = parallel ?
+    tbb::parallel_reduce(range, Bounds(), gather_bounds,
+                         [](Bounds a, const Bounds &b) -> Bounds {
+                           a.first.Extend(b.first);
+                           a.second.Extend(b.second);
+                           return a;}) :
+    gather_bounds(range, Bounds());
+  const AABB &bbox = bounds.first;
+  const AABB &centroid_bbox = bounds.second;
+  nodes[node_index] = MakeNode(bbox);
+
+  uint axis = centroid_bbox.GetMaxExtentAxis();
+  Real axis_min = centroid_bbox.GetMin()[axis];
+  Real axis_extent = centroid_bbox.GetMax()[axis] - axis_min;
+  bool make_leaf = count == 1 || (axis_extent <= 0 && count <= kMaxLeafSize);
+  size_t mid = start + count / 2;
+  if (!make_leaf && axis_extent > 0 && depth >= kMaxDepth / 2) {
+    // deep, unbalanced subtree: fall back to median splits so the
+    // depth stays within the traversal stack
+    nth_element(primitives.begin() + static_cast<long>(start),
+                primitives.begin() + static_cast<long>(mid),
+                primitives.begin() + static_cast<long>(end),
+                [axis](const PrimitiveInfo &a, const PrimitiveInfo &b) {
+                  return a.centroid[axis] < b.centroid[axis];});
+  } else if (!make_leaf && axis_extent > 0) {
+    // bin primitives by centroid along the split axis
+    struct Bins {
+      AABB bboxes[kBinCount];
+      size_t counts[kBinCount];
+    };
+    auto bin_index = [&](const PrimitiveInfo &info) -> uint {
+      auto b = static_cast<uint>(kBinCount * (info.centroid[axis] - axis_min) /
+                                 axis_extent);
+      return std::min(b, kBinCount - 1);
+    };
+    auto fill_bins = [&](const tbb::blocked_range<size_t> &r, Bins bins) -> Bins {
+      for (size_t i = r.begin(); i < r.end(); ++i) {
+        uint b = bin_index(primitives[i]);
+        ++bins.counts[b];
+        bins.bboxes[b].Extend(primitives[i].bbox);
+      }
+      return bins;
+    };
+    Bins bins = parallel ?
+      tbb::parallel_reduce(range, Bins(), fill_bins,
+                           [](Bins a, const Bins &b) -> Bins {
+                             for (uint i = 0; i < kBinCount; ++i) {
+                               a.bboxes[i].Extend(b.bboxes[i]);
+                               a.counts[i] += b.counts[i];
+                             }
+                             return a;}) :
+      fill_bins(range, Bins());
+
+    // sweep from the right to get the area and count above each split
+    Real right_areas[kBinCount];
+    size_t right_counts[kBinCount];
+    AABB right_bbox;
+    size_t right_count = 0;
+    for (uint b = kBinCount - 1; b > 0; --b) {
+      right_bbox.Extend(bins.bboxes[b]);
+      right_count += bins.counts[b];
+      right_areas[b] = right_bbox.GetSurfaceArea();
+      right_counts[b] = right_count;
+    }
+
+    // sweep from the left and pick the split with the lowest cost
+    Real parent_area = bbox.GetSurfaceArea();
+    Real best_cost = kInfinity;
+    uint best_split = 1;
+    AABB left_bbox;
+    size_t left_count = 0;
+    for (uint b = 1; b < kBinCount; ++b) {
+      left_bbox.Extend(bins.bboxes[b - 1]);
+      left_count += bins.counts[b - 1];
+      Real cost = left_bbox.GetSurfaceArea() * static_cast<Real>(left_count) +
+        right_areas[b] * static_cast<Real>(right_counts[b]);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_split = b;
+      }
+    }
+    if (parent_area > 0)
+      best_cost = kTraversalCost + best_cost / parent_area;
+
+    // a leaf is cheaper than any split
+    auto goes_left = [&](const PrimitiveInfo &info) -> bool {
+      return bin_index(info) < best_split;
+    };
+    if (count <= kMaxLeafSize && static_cast<Real>(count) <= best_cost) {
+      make_leaf = true;
+    } else if (parallel) {
+      mid = ParallelPartition(primitives, start, end, goes_left);
+    } else {
+      auto first_right = std::partition(
+        primitives.begin() + static_cast<long>(start),
+        primitives.begin() + static_cast<long>(end), goes_left);
+      mid = static_cast<size_t>(first_right - primitives.begin());
+    }
+  }
+
+  if (make_leaf) {
+    nodes[node_index].offset = static_cast<uint32_t>(start);
+    nodes[node_index].primitive_count = static_cast<uint16_t>(count);
+    return;
+  }
+
+  // children form a sibling pair; large subtrees are built concurrently
+  // into their own arrays, then appended
+  uint32_t first_child = AddPair(nodes, depth);
+  if (parallel) {
+    NodeArray first_nodes(1), second_nodes(1);
+    first_nodes.reserve(2 * (mid - start));
+    second_nodes.reserve(2 * (end - mid));
+    tbb::parallel_invoke(
+      [&]() {Build(primitives, start, mid, depth + 1, first_nodes, 0);},
+      [&]() {Build(primitives, mid, end, depth + 1, second_nodes, 0);});
+    AppendSubtree(nodes, first_nodes, first_child);
+    NodeArray().swap(first_nodes);
+    AppendSubtree(nodes, second_nodes, first_child + 1);
+  } else {
+    Build(primitives, start, mid, depth + 1, nodes, first_child);
+    Build(primitives, mid, end, depth + 1, nodes, first_child + 1);
+  }
+  nodes[node_index].offset = first_child;
+  nodes[node_index].axis = static_cast<uint8_t>(axis);
+}
+
+
+void
+BVH::BuildSpatial(vector<PrimitiveInfo> &references, uint depth,
+                  Real min_overlap_area, size_t &budget, uint32_t node_index)
+{
+  // bounds of the references and of their centroids
+  AABB bbox, centroid_bbox;
+  for (const auto &reference : references) {
+    bbox.Extend(reference.bbox);
+    centroid_bbox.Extend(reference.centroid);
+  }
+  nodes_[node_index] = MakeNode(bbox);
+  size_t count = references.size();
+  Real parent_area = bbox.GetSurfaceArea();
+
+  // object split: bin references by centroid, as in Build()
+  uint object_axis = centroid_bbox.GetMaxExtentAxis();
+  Real axis_min = centroid_bbox.GetMin()[object_axis];
+  Real axis_extent = centroid_bbox.GetMax()[object_axis] - axis_min;
+  auto bin_index = [&](const PrimitiveInfo &info) -> uint {
+    auto b = static_cast<uint>(kBinCount * (info.centroid[object_axis] - axis_min) /
+                               axis_extent);
+    return std::min(b, kBinCount - 1);
+  };
+  bool deep = depth >= kMaxDepth / 2;
+  Real object_cost = kInfinity;
+  uint object_split = 1;
+  AABB object_left_bbox, object_right_bbox;
+  if (count > 1 && axis_extent > 0 && !deep) {
+    AABB bin_bboxes[kBinCount];
+    size_t bin_counts[kBinCount] = {0};
+    for (const auto &reference : references) {
+      uint b = bin_index(reference);
+      ++bin_counts[b];
+      bin_bboxes[b].Extend(reference.bbox);
+    }
+    AABB right_bboxes[kBinCount];
+    size_t right_counts[kBinCount];
+    AABB right_bbox;
+    size_t right_count = 0;
+    for (uint b = kBinCount - 1; b > 0; --b) {
+      right_bbox.Extend(bin_bboxes[b]);
+      right_count += bin_counts[b];
+      right_bboxes[b] = right_bbox;
+      right_counts[b] = right_count;
+    }
+    AABB left_bbox;
+    size_t left_count = 0;
+    for (uint b = 1; b < kBinCount; ++b) {
+      left_bbox.Extend(bin_bboxes[b - 1]);
+      left_count += bin_counts[b - 1];
+      Real cost = left_bbox.GetSurfaceArea() * static_cast<Real>(left_count) +
+        right_bboxes[b].GetSurfaceArea() * static_cast<Real>(right_counts[b]);
+      if (cost < object_cost) {
+        object_cost = cost;
+        object_split = b;
+        object_left_bbox = left_bbox;
+        object_right_bbox = right_bboxes[b];
+      }
+    }
+  }
+
+  // spatial split: only worth trying where the object split's children
+  // overlap noticeably (or the centroids coincide)
+  AABB overlap = object_left_bbox;
+  overlap.Intersect(object_right_bbox);
+  bool try_spatial = count > 1 && budget > 0 && !deep &&
+    (axis_extent <= 0 ||
+     (!overlap.IsEmpty() && overlap.GetSurfaceArea() > min_overlap_area));
+  Real spatial_cost = kInfinity;
+  uint spatial_axis = 0;
+  uint spatial_split = 1;
+  AABB spatial_left_bbox, spatial_right_bbox;
+  size_t spatial_left_count = 0, spatial_right_count = 0;
+  auto spatial_bin = [&](Real x, uint axis) -> uint {
+    Real bin_width = (bbox.GetMax()[axis] - bbox.GetMin()[axis]) / kSpatialBinCount;
+    Real b = std::max((x - bbox.GetMin()[axis]) / bin_width, Real(0));
+    return std::min(static_cast<uint>(b), kSpatialBinCount - 1);
+  };
+  auto spatial_plane = [&](uint b, uint axis) -> Real {
+    Real bin_width = (bbox.GetMax()[axis] - bbox.GetMin()[axis]) / kSpatialBinCount;
+    return bbox.GetMin()[axis] + static_cast<Real>(b) * bin_width;
+  };
+  for (uint axis = 0; try_spatial && axis < 3; ++axis) {
+    if (!(bbox.GetMax()[axis] > bbox.GetMin()[axis]))
+      continue;
+
+    // chop every reference into the bins it overlaps; count where each
+    // reference enters and exits
+    AABB bin_bboxes[kSpatialBinCount];
+    size_t entries[kSpatialBinCount] = {0};
+    size_t exits[kSpatialBinCount] = {0};
+    for (const auto &reference : references) {
+      uint first = spatial_bin(reference.bbox.GetMin()[axis], axis);
+      uint last = spatial_bin(reference.bbox.GetMax()[axis], axis);
+      ++entries[first];
+      ++exits[last];
+      if (first == last) {
+        bin_bboxes[first].Extend(reference.bbox);
+        continue;
+      }
+      for (uint b = first; b <= last; ++b) {
+        Vec3r clip_min = reference.bbox.GetMin();
+        Vec3r clip_max = reference.bbox.GetMax();
+        if (b > first)
+          clip_min[axis] = spatial_plane(b, axis);
+        if (b < last)
+          clip_max[axis] = spatial_plane(b + 1, axis);
+        AABB clipped;
+        if (reference.surface->GetClippedBoundingBox(AABB{clip_min, clip_max},
+                                                     clipped))
+          bin_bboxes[b].Extend(clipped);
+      }
+    }
+
+    // sweep the planes between bins as for object splits
+    AABB right_bboxes[kSpatialBinCount];
+    size_t right_counts[kSpatialBinCount];
+    AABB right_bbox;
+    size_t right_count = 0;
+    for (uint b = kSpatialBinCount - 1; b > 0; --b) {
+      right_bbox.Extend(bin_bboxes[b]);
+      right_count += exits[b];
+      right_bboxes[b] = right_bbox;
+      right_counts[b] = right_count;
+    }
+    AABB left_bbox;
+    size_t left_count = 0;
+    for (uint b = 1; b < kSpatialBinCount; ++b) {
+      left_bbox.Extend(bin_bboxes[b - 1]);
+      left_count += entries[b - 1];
+      if (left_count + right_counts[b] - count > budget)
+        continue;
+      Real cost = left_bbox.GetSurfaceArea() * static_cast<Real>(left_count) +
+        right_bboxes[b].GetSurfaceArea() * static_cast<Real>(right_counts[b]);
+      if (cost < spatial_cost) {
+        spatial_cost = cost;
+        spatial_axis = axis;
+        spatial_split = b;
+        spatial_left_bbox = left_bbox;
+        spatial_right_bbox = right_bboxes[b];
+        spatial_left_count = left_count;
+        spatial_right_count = right_counts[b];
+      }
+    }
+  }
+
+  // a leaf is cheaper than any split
+  Real best_cost = std::min(object_cost, spatial_cost);
+  if (parent_area > 0)
+    best_cost = kTraversalCost + best_cost / parent_area;
+  if (count == 1 || (count <= kMaxLeafSize && static_cast<Real>(count) <= best_cost)) {
+    nodes_[node_index].offset = static_cast<uint32_t>(primitives_.size());
+    nodes_[node_index].primitive_count = static_cast<uint16_t>(count);
+    for (auto &reference : references)
+      primitives_.push_back(std::move(reference.surface));
+    return;
+  }
+
+  vector<PrimitiveInfo> left, right;
+  uint axis = object_axis;
+  if (spatial_cost < object_cost) {
+    axis = spatial_axis;
+    Real plane = spatial_plane(spatial_split, axis);
+    AABB &left_bbox = spatial_left_bbox;
+    AABB &right_bbox = spatial_right_bbox;
+    Real left_count = static_cast<Real>(spatial_left_count);
+    Real right_count = static_cast<Real>(spatial_right_count);
+    for (auto &reference : references) {
+      uint first = spatial_bin(reference.bbox.GetMin()[axis], axis);
+      uint last = spatial_bin(reference.bbox.GetMax()[axis], axis);
+      if (last < spatial_split) {
+        left.push_back(std::move(reference));
+        continue;
+      }
+      if (first >= spatial_split) {
+        right.push_back(std::move(reference));
+        continue;
+      }
+
+      // keep the reference whole on one side if that is cheaper than
+      // duplicating it
+      AABB left_union = left_bbox;
+      left_union.Extend(reference.bbox);
+      AABB right_union = right_bbox;
+      right_union.Extend(reference.bbox);
+      Real left_area = left_bbox.GetSurfaceArea();
+      Real right_area = right_bbox.GetSurfaceArea();
+      Real split_cost = left_area * left_count + right_area * right_count;
+      Real left_cost = left_union.GetSurfaceArea() * left_count +
+        right_area * (right_count - 1);
+      Real right_cost = left_area * (left_count - 1) +
+        right_union.GetSurfaceArea() * right_count;
+      if (left_cost < split_cost && left_cost <= right_cost) {
+        left_bbox = left_union;
+        right_count -= 1;
+        left.push_back(std::move(reference));
+        continue;
+      }
+      if (right_cost < split_cost) {
+        right_bbox = right_union;
+        left_count -= 1;
+        right.push_back(std::move(reference));
+        continue;
+      }
+
+      // clip the reference to both sides of the plane
+      Vec3r left_max = reference.bbox.GetMax();
+      left_max[axis] = plane;
+      Vec3r right_min = reference.bbox.GetMin();
+      right_min[axis] = plane;
+      PrimitiveInfo left_reference{reference.surface, AABB{}, Vec3r{},
+                                   reference.index};
+      PrimitiveInfo right_reference{reference.surface, AABB{}, Vec3r{},
+                                    reference.index};
+      bool in_left = reference.surface->GetClippedBoundingBox(
+        AABB{reference.bbox.GetMin(), left_max}, left_reference.bbox);
+      bool in_right = reference.surface->GetClippedBoundingBox(
+        AABB{right_min, reference.bbox.GetMax()}, right_reference.bbox);
+      if (in_left && in_right) {
+        left_reference.centroid = left_reference.bbox.GetCentroid();
+        right_reference.centroid = right_reference.bbox.GetCentroid();
+        left.push_back(std::move(left_reference));
+        right.push_back(std::move(right_reference));
+      } else if (in_right) {
+        right.push_back(std::move(reference));
+      } else {
+        left.push_back(std::move(reference));
+      }
+    }
+
+    // clipping can move a side's last references to the other side;
+    // fall back to splitting the references in half below
+    if (!left.size() || !right.size()) {
+      references = std::move(left.size() ? left : right);
+      left.clear();
+      right.clear();
+    } else {
+      size_t added = left.size() + right.size() - count;
+      budget -= std::min(added, budget);
+    }
+  } else if (object_cost < kInfinity) {
+    for (auto &reference : references) {
+      if (bin_index(reference) < object_split)
+        left.push_back(std::move(reference));
+      else
+        right.push_back(std::move(reference));
+    }
+  }
+
+  if (!left.size() || !right.size()) {
+    // no useful split or deep, unbalanced subtree: median split so the
+    // depth stays within the traversal stack
+    axis = object_axis;
+    auto mid = references.begin() + static_cast<long>(references.size() / 2);
+    if (axis_extent > 0)
+      nth_element(references.begin(), mid, references.end(),
+                  [object_axis](const PrimitiveInfo &a, const PrimitiveInfo &b) {
+                    return a.centroid[object_axis] < b.centroid[object_axis];});
+    left.assign(std::make_move_iterator(references.begin()),
+                std::make_move_iterator(mid));
+    right.assign(std::make_move_iterator(mid),
+                 std::make_move_iterator(references.end()));
+  }
+  vector<PrimitiveInfo>().swap(references);
+
+  // children form a sibling pair
+  uint32_t first_child = AddPair(nodes_, depth);
+  BuildSpatial(left, depth + 1, min_overlap_area, budget, first_child);
+  BuildSpatial(right, depth + 1, min_overlap_area, budget, first_child + 1);
+  nodes_[node_index].offset = first_child;
+  nodes_[node_index].axis = static_cast<uint8_t>(axis);
+}
+
+
+void
+BVH::BuildLinear(vector<PrimitiveInfo> &primitives)
+{
+  // Morton codes of centroids relative to the centroid bounds
+  AABB centroid_bbox = tbb::parallel_reduce(
+    tbb::blocked_range<size_t>(0, primitives.size()), AABB(),
+    [&](const tbb::blocked_range<size_t> &range, AABB bbox) -> AABB {
+      for (size_t i = range.begin(); i < range.end(); ++i)
+        bbox.Extend(primitives[i].centroid);
+      return bbox;
+    },
+    [](AABB a, const AABB &b) -> AABB {a.Extend(b); return a;});
+  vector<MortonPrimitive> morton(primitives.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, primitives.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i) {
+        Vec3r offset = centroid_bbox.GetOffset(primitives[i].centroid);
+        morton[i] = MortonPrimitive{MortonCode(offset), static_cast<uint32_t>(i)};
+      }
+    });
+  RadixSort(morton);
+
+  // store surfaces in leaf order, i.e., sorted by code
+  primitives_.resize(primitives.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, primitives.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i)
+        primitives_[i] = std::move(primitives[morton[i].index].surface);
+    });
+
+  // build the tree, then lay it out as sibling pairs in depth-first
+  // order; a binary tree has fewer than 2n nodes
+  vector<LinearBuildNode> build_nodes(2 * primitives.size() - 1);
+  LinearBuildContext<vector<PrimitiveInfo>> context{morton, primitives,
+                                                    build_nodes, {0}};
+  uint32_t root = BuildLinearSubtree(context, 0,
+                                     static_cast<uint32_t>(primitives.size()));
+  if (build_nodes[root].leaf) {
+    nodes_.resize(1);
+    EmitLinearSubtree(build_nodes, root, nodes_.data(), 0, 1);
+  } else {
+    nodes_.resize(build_nodes[root].node_count + 1);
+    nodes_[1] = MakePaddingNode();
+    EmitLinearSubtree(build_nodes, root, nodes_.data(), 0, 2);
+  }
+}
+
+
+void
+BVH::BuildNodes(const vector<AABB> &bounds, NodeArray &nodes,
+                vector<uint32_t> &order)
+{
+  nodes.clear();
+  order.clear();
+  if (!bounds.size())
+    return;
+
+  vector<PrimitiveInfo> primitives(bounds.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, bounds.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i) {
+        PrimitiveInfo &info = primitives[i];
+        info.bbox = bounds[i];
+        info.centroid = info.bbox.GetCentroid();
+        info.index = static_cast<uint32_t>(i);
+      }
+    });
+  nodes.reserve(2 * primitives.size());
+  nodes.emplace_back();
+  Build(primitives, 0, primitives.size(), 0, nodes, 0);
+  nodes.shrink_to_fit();
+  ReorderNodes(nodes);
+
+  order.resize(primitives.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, primitives.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i)
+        order[i] = primitives[i].index;
+    });
+}
+
+
+void
+BVH::ReorderNodes()
+{
+  ReorderNodes(nodes_);
+}
+
+
+void
+BVH::ReorderNodes(NodeArray &nodes)
+{
+  if (nodes.size() <= 1)
+    return;
+
+  // sibling pairs are identified by their first node; new_position
+  // maps the first node of each pair to its new index
+  vector<uint32_t> new_position(nodes.size(), 0);
+  uint32_t next = 2;
+  vector<uint32_t> treelet_roots{nodes[0].offset};
+  while (treelet_roots.size()) {
+    // grow the treelet by the pair behind the largest parent
+    using Candidate = pair<Real, uint32_t>;
+    priority_queue<Candidate> candidates;
+    candidates.push(Candidate{0, treelet_roots.back()});
+    treelet_roots.pop_back();
+    for (uint pair_count = 0; candidates.size() && pair_count < kTreeletSize;
+         ++pair_count) {
+      uint32_t first = candidates.top().second;
+      candidates.pop();
+      new_position[first] = next;
+      next += 2;
+      for (uint32_t child = first; child < first + 2; ++child)
+        if (!nodes[child].IsLeaf())
+          candidates.push(Candidate{NodeSurfaceArea(nodes[child]),
+                                    nodes[child].offset});
+    }
+
+    // remaining candidates start later treelets, the largest first
+    vector<uint32_t> remaining;
+    for (; candidates.size(); candidates.pop())
+      remaining.push_back(candidates.top().second);
+    treelet_roots.insert(treelet_roots.end(), remaining.rbegin(),
+                         remaining.rend());
+  }
+
+  NodeArray reordered(nodes.size());
+  auto relocate = [&](LinearBVHNode node) -> LinearBVHNode {
+    if (!node.IsLeaf())
+      node.offset = new_position[node.offset];
+    return node;
+  };
+  reordered[0] = relocate(nodes[0]);
+  reordered[1] = nodes[1];
+  tbb::parallel_for(tbb::blocked_range<size_t>(2, nodes.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i) {
+        // pairs start at even indices
+        size_t first = i & ~size_t{1};
+        reordered[new_position[first] + (i - first)] = relocate(nodes[i]);
+      }
+    });
+  nodes.swap(reordered);
+}
+
+
+void
+BVH::ReorderPrimitives()
+{
+  // surfaces referenced by several leaves (SBVH) share one copy
+  vector<const Surface*> originals;
+  unordered_map<const Surface*, size_t> copy_index;
+  copy_index.reserve(primitives_.size());
+  size_t arena_size = 0;
+  for (const auto &primitive : primitives_) {
+    const Surface *surface = primitive.get();
+    // only exact spheres and triangles are copied: copying a subclass
+    // as its base class would slice off its Hit()
+    size_t size = 0;
+    if (typeid(*surface) == typeid(Sphere))
+      size = sizeof(Sphere);
+    else if (typeid(*surface) == typeid(Triangle))
+      size = sizeof(Triangle);
+    if (!size || !copy_index.emplace(surface, originals.size()).second)
+      continue;
+    originals.push_back(surface);
+    arena_size += PrimitiveArena::RoundUp(size);
+  }
+  if (originals.empty())
+    return;
+
+  // copy the surfaces, in leaf order, into one block of memory
+  auto arena = make_shared<PrimitiveArena>(arena_size);
+  vector<Surface::Ptr> copies(originals.size());
+  for (size_t i = 0; i < originals.size(); ++i) {
+    const Surface *surface = originals[i];
+    if (typeid(*surface) == typeid(Sphere))
+      copies[i] = arena->Copy(*static_cast<const Sphere*>(surface));
+    else
+      copies[i] = arena->Copy(*static_cast<const Triangle*>(surface));
+  }
+  for (auto &primitive : primitives_) {
+    auto it = copy_index.find(primitive.get());
+    if (it != copy_index.end())
+      primitive = copies[it->second];
+  }
+}
+
+
+void
+BVH::Refit()
+{
+  if (!nodes_.size())
+    return;
+  bbox_ = Refit(0, 0);
+}
+
+
+AABB
+BVH::Refit(uint32_t node_index, uint depth)
+{
+  LinearBVHNode &node = nodes_[node_index];
+  AABB bbox;
+  if (node.IsLeaf()) {
+    for (uint32_t i = 0; i < node.primitive_count; ++i) {
+      AABB primitive_bbox;
+      if (primitives_[node.offset + i]->GetBoundingBox(primitive_bbox))
+        bbox.Extend(primitive_bbox);
+    }
+  } else {
+    // subtrees near the root of large hierarchies are refitted as
+    // concurrent tasks
+    constexpr uint kParallelRefitDepth = 8;
+    AABB first_bbox, second_bbox;
+    if (depth < kParallelRefitDepth && nodes_.size() > 2 * kParallelBuildSize) {
+      tbb::parallel_invoke(
+        [&]() {first_bbox = Refit(node.offset, depth + 1);},
+        [&]() {second_bbox = Refit(node.offset + 1, depth + 1);});
+    } else {
+      first_bbox = Refit(node.offset, depth + 1);
+      second_bbox = Refit(node.offset + 1, depth + 1);
+    }
+    bbox = first_bbox;
+    bbox.Extend(second_bbox);
+  }
+
+  LinearBVHNode refitted = MakeNode(bbox);
+  std::copy(refitted.bbox_min, refitted.bbox_min + 3, node.bbox_min);
+  std::copy(refitted.bbox_max, refitted.bbox_max + 3, node.bbox_max);
+  return bbox;
+}
+
+
+void
+BVH::Rebuild()
+{
+  // spatial splits reference surfaces more than once
+  vector<Surface::Ptr> surfaces;
+  if (method_ == BuildMethod::kSpatialSplit) {
+    unordered_set<const Surface*> seen;
+    surfaces.reserve(primitives_.size());
+    for (const auto &surface : primitives_)
+      if (seen.insert(surface.get()).second)
+        surfaces.push_back(surface);
+  } else {
+    surfaces = primitives_;
+  }
+  Init(surfaces);
+}
+
+
+bool
+BVH::Update(Real max_cost_ratio)
+{
+  Refit();
+  Real cost = GetSAHCost();
+  if (cost <= build_cost_ * max_cost_ratio)
+    return false;
+  spdlog::info("{}: SAH cost grew from {} to {} after refit; rebuilding",
+               name_, build_cost_, cost);
+  Rebuild();
+  return true;
+}
+
+
+Real
+BVH::GetSAHCost() const
+{
+  if (!nodes_.size())
+    return 0;
+  Real root_area = NodeSurfaceArea(nodes_[0]);
+  if (!(root_area > 0))
+    return static_cast<Real>(primitives_.size());
+
+  Real cost = 0;
+  for (const auto &node : nodes_) {
+    Real probability = NodeSurfaceArea(node) / root_area;
+    cost += probability * (node.IsLeaf() ?
+                           static_cast<Real>(node.primitive_count) :
+                           kTraversalCost);
+  }
+  return cost;
+}
+
+
+bool
+BVH::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
+{
+  if (!nodes_.size())
+    return false;
+  return HitSubtree(0, ray, tmin, tmax, hit_record);
+}
+
+
+bool
+BVH::HitSubtree(uint32_t root, const Ray &ray, Real tmin, Real tmax,
+                HitRecord &hit_record)
+{
+  const Vec3r origin = ray.GetOrigin();
+  const Vec3r inv_dir = ray.GetDirection().cwiseInverse();
+  const int dir_is_neg[3] = {inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0};
+
+  bool hit_something = false;
+  uint32_t to_visit[kMaxDepth];
+  uint to_visit_count = 0;
+  uint32_t current = root;
+  const LinearBVHNode *nodes = nodes_.data();
+  while (true) {
+    const LinearBVHNode &node = nodes[current];
+    if (node.Intersect(origin, inv_dir, dir_is_neg, tmin, tmax)) {
+      if (node.IsLeaf()) {
+        for (uint32_t i = 0; i < node.primitive_count; ++i) {
+          if (primitives_[node.offset + i]->Hit(ray, tmin, tmax, hit_record)) {
+            hit_something = true;
+            tmax = hit_record.GetRayT();
+          }
+        }
+        if (!to_visit_count)
+          break;
+        current = to_visit[--to_visit_count];
+      } else {
+        // visit the child on the near side of the split first; both
+        // share a cache line
+        uint32_t near_child = node.offset;
+        uint32_t far_child = node.offset + 1;
+        if (dir_is_neg[node.axis])
+          std::swap(near_child, far_child);
+        to_visit[to_visit_count++] = far_child;
+        current = near_child;
+      }
+    } else {
+      if (!to_visit_count)
+        break;
+      current = to_visit[--to_visit_count];
+    }
+  }
+  return hit_something;
+}
+
+
+uint64_t
+BVH::HitPacket(RayPacket &packet, uint64_t active, HitRecord *hit_records)
+{
+  if (!nodes_.size() || !active)
+    return 0;
+
+  // rays whose directions differ in sign can't share the order in
+  // which children are visited, nor the interval bounds of the packet
+  if (!packet.IsCoherent())
+    return Surface::HitPacket(packet, active, hit_records);
+
+  return detail::TraversePacket(
+    nodes_.data(), packet, active, hit_records,
+    [&](const LinearBVHNode &leaf, uint64_t mask) {
+      uint64_t hits = 0;
+      for (uint32_t i = 0; i < leaf.primitive_count; ++i)
+        hits |= primitives_[leaf.offset + i]->HitPacket(packet, mask,
+                                                        hit_records);
+      return hits;
+    },
+    [&](uint32_t root, uint32_t lane) {
+      return HitSubtree(root, packet.rays[lane], packet.tmin,
+                        packet.tmax[lane], hit_records[lane]);
+    });
+}
+
+
+bool
+BVH::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!nodes_.size())
+    return false;
+
+  const Vec3r origin = ray.GetOrigin();
+  const Vec3r inv_dir = ray.GetDirection().cwiseInverse();
+  const int dir_is_neg[3] = {inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0};
+
+  uint32_t to_visit[kMaxDepth];
+  uint to_visit_count = 0;
+  uint32_t current = 0;
+  const LinearBVHNode *nodes = nodes_.data();
+  while (true) {
+    const LinearBVHNode &node = nodes[current];
+    if (node.Intersect(origin, inv_dir, dir_is_neg, tmin, tmax)) {
+      if (node.IsLeaf()) {
+        for (uint32_t i = 0; i < node.primitive_count; ++i)
+          if (primitives_[node.offset + i]->Occluded(ray, tmin, tmax))
+            return true;
+        if (!to_visit_count)
+          break;
+        current = to_visit[--to_visit_count];
+      } else {
+        // any hit will do, so the first child is as good as the near one
+        to_visit[to_visit_count++] = node.offset + 1;
+        current = node.offset;
+      }
+    } else {
+      if (!to_visit_count)
+        break;
+      current = to_visit[--to_visit_count];
+    }
+  }
+  return false;
+}
+
+
+bool
+BVH::GetBoundingBox(AABB &bbox) const
+{
+  bbox = bbox_;
+  return nodes_.size() > 0;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,360 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       bvh.h
+//! \brief      BVH class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tbb/cache_aligned_allocator.h>
+#include "core/geometry/surface.h"
+#include "core/geometry/aabb.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class Ray;
+class HitRecord;
+
+//! \struct LinearBVHNode
+//! \brief BVH node. The two children of an inner node are stored next
+//! to each other as a sibling pair; only the index of the first child
+//! is stored. Bounds are kept in single precision, rounded outwards, so
+//! a sibling pair fills one cache line.
+struct alignas(32) LinearBVHNode {
+  float bbox_min[3];         //!< minimum corner of node's bounding box
+  float bbox_max[3];         //!< maximum corner of node's bounding box
+  uint32_t offset;           //!< leaf: first primitive; inner: first child
+  uint16_t primitive_count;  //!< number of primitives; 0 for inner nodes
+  uint8_t axis;              //!< inner node's split axis
+  uint8_t pad;               //!< unused
+
+  //! \brief Whether the node is a leaf
+  //! \return True if the node references primitives
+  inline bool IsLeaf() const {return primitive_count > 0;}
+
+  //! \brief Slab test of a ray against the node's box
+  //! \param[in] origin Ray origin
+  //! \param[in] inv_dir Reciprocal of the ray direction
+  //! \param[in] dir_is_neg Whether the direction is negative on each axis
+  //! \param[in] tmin Minimum acceptable ray t
+  //! \param[in] tmax Maximum acceptable ray t
+  //! \return True if the ray overlaps the box within [tmin, tmax]
+  inline bool Intersect(const Vec3r &origin, const Vec3r &inv_dir,
+                        const int dir_is_neg[3], Real tmin, Real tmax) const {
+    for (int axis = 0; axis < 3; ++axis) {
+      const float *near_bound = dir_is_neg[axis] ? bbox_max : bbox_min;
+      const float *far_bound = dir_is_neg[axis] ? bbox_min : bbox_max;
+      Real t0 = (near_bound[axis] - origin[axis]) * inv_dir[axis];
+      Real t1 = (far_bound[axis] - origin[axis]) * inv_dir[axis];
+
+      // written so that NaNs (0 * inf) leave the interval unchanged
+      tmin = t0 > tmin ? t0 : tmin;
+      tmax = t1 < tmax ? t1 : tmax;
+      if (tmax < tmin)
+        return false;
+    }
+    return true;
+  }
+};
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode must be 32 bytes");
+
+
+//! \class BVH
+//! \brief Bounding volume hierarchy over a set of surfaces, built
+//! top-down in parallel with a binned surface area heuristic (SAH) or,
+//! when build time matters more than trace time, from sorted Morton
+//! codes (LBVH)
+//! \details The hierarchy is stored as a flat, cache-line aligned
+//! array of LinearBVHNodes whose leaves index contiguous ranges of
+//! the reordered surface array. Node 0 is the root and node 1 unused
+//! padding, so that every sibling pair starts on a cache line. Builds
+//! lay pairs out in depth-first order; ReorderNodes() and
+//! ReorderPrimitives() improve memory locality once the hierarchy is
+//! built. Traversal uses a fixed-size stack.
+//! The spatial-split builder (SBVH) may reference a surface from
+//! several leaves, each bounding only the part of the surface inside
+//! it; refitting falls back to the surfaces' full bounds.
+class BVH : public Surface {
+public:
+  OLIO_NODE(BVH)
+
+  //! \brief Algorithm used to build the hierarchy
+  enum class BuildMethod {
+    kBinnedSAH,    //!< top-down binned SAH; good trace performance
+    kLinear,       //!< parallel Morton-code LBVH; fastest to build
+    kSpatialSplit  //!< binned SAH that may also split surfaces at
+                   //!< spatial planes (SBVH); best trace performance
+                   //!< for long, thin, or overlapping surfaces
+  };
+
+  //! \brief Constructor; builds the hierarchy over the input surfaces
+  //!        with the binned SAH
+  //! \details Unbounded surfaces cannot be placed in the hierarchy
+  //!          and are skipped with a warning.
+  //! \param[in] surfaces Surfaces to build the hierarchy over
+  //! \param[in] name Node name
+  BVH(const std::vector<Surface::Ptr> &surfaces,
+      const std::string &name=std::string());
+
+  //! \brief Constructor; builds the hierarchy over the input surfaces
+  //! \details Unbounded surfaces cannot be placed in the hierarchy
+  //!          and are skipped with a warning.
+  //! \param[in] surfaces Surfaces to build the hierarchy over
+  //! \param[in] method Build algorithm
+  //! \param[in] name Node name
+  BVH(const std::vector<Surface::Ptr> &surfaces, BuildMethod method,
+      const std::string &name=std::string());
+
+  //! \brief Constructor; restores a hierarchy built earlier over the
+  //!        same surfaces (e.g., by AcceleratorCache) without building
+  //! \details The input must describe a valid hierarchy: leaves index
+  //!          the primitive index array and inner nodes' first child
+  //!          offsets lie within the node array.
+  //! \param[in] surfaces Surfaces the hierarchy was built over
+  //! \param[in] method Build algorithm the hierarchy was built with
+  //! \param[in] nodes Nodes, with children stored as sibling pairs
+  //! \param[in] node_count Number of nodes
+  //! \param[in] primitive_indices Indices into 'surfaces' in leaf order
+  //! \param[in] primitive_count Number of primitive indices
+  //! \param[in] bbox Bounding box of all surfaces
+  //! \param[in] name Node name
+  BVH(const std::vector<Surface::Ptr> &surfaces, BuildMethod method,
+      const LinearBVHNode *nodes, size_t node_count,
+      const uint32_t *primitive_indices, size_t primitive_count,
+      const AABB &bbox, const std::string &name=std::string());
+
+  //! \brief Check if ray intersects with surface
+  //! \details If the ray intersections the surface, the function
+  //!          should fill in the 'hit_record' (i.e., information
+  //!          about the hit point, normal, etc.)
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \param[out] hit_record Resulting hit record if ray intersected with surface
+  //! \return True if ray intersected with surface
+  bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
+
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Stops at the first primitive hit; children are visited
+  //!          in a fixed order rather than front to back
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Intersect the rays of a packet with the hierarchy
+  //! \details Coherent packets (see RayPacket::IsCoherent()) traverse
+  //!          the tree together: a node is skipped if an interval
+  //!          bound of the whole packet misses it, otherwise each ray
+  //!          is slab tested and only the rays that enter the node go
+  //!          on to its children. Once fewer than 1/kPacketDivergence
+  //!          of the rays enter a subtree, they traverse it one at a
+  //!          time. Incoherent packets are traced ray by ray.
+  //! \param[in,out] packet Ray packet
+  //! \param[in] active Lanes to intersect (bit i is lane i)
+  //! \param[in,out] hit_records Hit records, one per lane of the packet
+  //! \return Lanes that intersected the hierarchy
+  uint64_t HitPacket(RayPacket &packet, uint64_t active,
+                     HitRecord *hit_records) override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the hierarchy contains at least one surface
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  //! \brief Get the algorithm the hierarchy was built with
+  //! \return Build method
+  BuildMethod GetBuildMethod() const {return method_;}
+
+  //! \brief Contiguous node storage aligned to cache lines
+  using NodeArray = std::vector<LinearBVHNode,
+                                tbb::cache_aligned_allocator<LinearBVHNode>>;
+
+  //! \brief Get the nodes; node 0 is the root and, if the root has
+  //!        children, node 1 is padding
+  //! \return Hierarchy nodes
+  const NodeArray& GetNodes() const {return nodes_;}
+
+  //! \brief Build nodes over primitives that are not surfaces (e.g.,
+  //!        the triangles of a TriangleMesh) with the binned SAH, and
+  //!        lay them out in treelets
+  //! \param[in] bounds Bounding box of each primitive
+  //! \param[out] nodes Hierarchy nodes; leaves index 'order'
+  //! \param[out] order Primitive indices in leaf order
+  static void BuildNodes(const std::vector<AABB> &bounds, NodeArray &nodes,
+                         std::vector<uint32_t> &order);
+
+  //! \brief Get the surfaces in leaf order, as indexed by the leaves
+  //! \details Surfaces split by the SBVH builder appear more than once
+  //! \return Surfaces in leaf order
+  const std::vector<Surface::Ptr>& GetPrimitives() const {return primitives_;}
+
+  //! \brief Lay out the nodes in treelets: starting from a sibling
+  //!        pair, each treelet greedily adds the pair whose parent has
+  //!        the largest surface area, i.e., the pair a random ray is
+  //!        most likely to fetch next, until it fills a 4 KB page
+  //!        (kTreeletSize pairs). Pairs left out start the treelets
+  //!        that follow. Keeps the tree and its traversal order.
+  void ReorderNodes();
+
+  //! \brief Replace spheres and triangles with copies placed in leaf
+  //!        order in one block of memory, so that surfaces tested
+  //!        together are adjacent
+  //! \details The block is freed with the last copy. Afterwards the
+  //!          hierarchy no longer references the input surfaces: use
+  //!          GetPrimitives() to move surfaces before Refit(). Other
+  //!          surfaces (e.g., instances, or subclasses of Sphere and
+  //!          Triangle) are kept.
+  void ReorderPrimitives();
+
+  //! \brief Recompute all node bounds bottom-up, in parallel, from the
+  //!        surfaces' current bounds, keeping the tree topology
+  //! \details Use after moving surfaces (e.g., Sphere::SetCenter or
+  //!          Triangle::SetPoints). Must not run concurrently with Hit().
+  void Refit();
+
+  //! \brief Rebuild the hierarchy from scratch over its surfaces with
+  //!        the original build method
+  void Rebuild();
+
+  //! \brief Refit the hierarchy and rebuild it instead if refitting
+  //!        degraded its SAH cost too much
+  //! \param[in] max_cost_ratio Rebuild when the refitted cost exceeds
+  //!            the cost right after the last build by this factor
+  //! \return True if the hierarchy was rebuilt
+  bool Update(Real max_cost_ratio=kMaxRefitCostRatio);
+
+  //! \brief Compute the SAH cost of the hierarchy: expected number of
+  //!        node visits and surface tests, relative to one surface
+  //!        test, for a random ray hitting the root
+  //! \return SAH cost; 0 for empty hierarchies
+  Real GetSAHCost() const;
+
+  static constexpr uint kBinCount = 12;      //!< number of SAH bins per split
+  static constexpr size_t kMaxLeafSize = 4;  //!< max surfaces per leaf
+  static constexpr uint kMaxDepth = 64;      //!< max tree depth (stack size)
+  //! node visit cost relative to one surface test
+  static constexpr Real kTraversalCost = 0.125;
+  //! min surfaces per parallel build or refit task
+  static constexpr size_t kParallelBuildSize = 4096;
+  //! default refit degradation before rebuilding
+  static constexpr Real kMaxRefitCostRatio = 1.5;
+  static constexpr uint kSpatialBinCount = 16;  //!< SBVH spatial split bins
+  //! min child overlap, relative to the root's area, to try spatial splits
+  static constexpr Real kSpatialSplitAlpha = static_cast<Real>(1e-5);
+  //! max extra SBVH surface references per surface
+  static constexpr Real kMaxDuplicationRatio = 0.5;
+  static constexpr uint kTreeletSize = 64;  //!< sibling pairs per treelet (4 KB)
+  //! packets split into single rays below 1/kPacketDivergence active rays
+  static constexpr uint kPacketDivergence = 4;
+protected:
+  //! \brief Per-surface data used only while building
+  struct PrimitiveInfo {
+    Surface::Ptr surface;  //!< surface
+    AABB bbox;             //!< surface's bounding box
+    Vec3r centroid;        //!< center of surface's bounding box
+    uint32_t index;        //!< primitive index, for builds without surfaces
+  };
+
+  //! \brief Find the closest hit of a ray in the subtree rooted at
+  //!        'root' (see Hit())
+  //! \param[in] root Subtree root
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t
+  //! \param[in] tmax Maximum value for acceptable t
+  //! \param[out] hit_record Resulting hit record if ray intersected
+  //! \return True if ray intersected a surface in the subtree
+  bool HitSubtree(uint32_t root, const Ray &ray, Real tmin, Real tmax,
+                  HitRecord &hit_record);
+
+  //! \brief Build the hierarchy over the input surfaces, replacing
+  //!        any previous content
+  //! \param[in] surfaces Surfaces to build the hierarchy over
+  void Init(const std::vector<Surface::Ptr> &surfaces);
+
+  //! \brief Lay out nodes in treelets (see ReorderNodes())
+  //! \param[in,out] nodes Hierarchy nodes
+  static void ReorderNodes(NodeArray &nodes);
+
+  //! \brief Recursively refit the subtree rooted at 'node_index'
+  //! \param[in] node_index Subtree root
+  //! \param[in] depth Depth of the subtree's root
+  //! \return Subtree bounds
+  AABB Refit(uint32_t node_index, uint depth);
+
+  //! \brief Recursively build the subtree for primitives in [start,
+  //!        end) into the node at 'node_index', appending descendants
+  //!        to 'nodes' as sibling pairs in depth-first order
+  //! \details Ranges larger than kParallelBuildSize are binned and
+  //!          partitioned in parallel, and their two subtrees are built
+  //!          as concurrent tasks into separate arrays that are appended
+  //!          to 'nodes' afterwards. The result does not depend on the
+  //!          number of threads.
+  //! \param[in,out] primitives Build primitives; reordered in place
+  //! \param[in] start First primitive of the subtree
+  //! \param[in] end One past the last primitive of the subtree
+  //! \param[in] depth Depth of the subtree's root
+  //! \param[in,out] nodes Node array holding the subtree
+  //! \param[in] node_index Already allocated node for the subtree's root
+  static void Build(std::vector<PrimitiveInfo> &primitives, size_t start,
+                    size_t end, uint depth, NodeArray &nodes,
+                    uint32_t node_index);
+
+  //! \brief Recursively build the SBVH subtree over the input
+  //!        references into the node at 'node_index', appending
+  //!        descendants to 'nodes_' as sibling pairs in depth-first
+  //!        order and its leaves' surfaces to 'primitives_'
+  //! \details Besides the binned object split of Build(), tries
+  //!          splitting the node's box into equal spatial bins when the
+  //!          object split's children overlap. References straddling a
+  //!          spatial split are clipped to either side, unless moving
+  //!          them whole to one side is cheaper (reference unsplitting).
+  //! \param[in,out] references Build references; the bounds of each are
+  //!                clipped to the part of its surface in the subtree.
+  //!                Consumed by the call.
+  //! \param[in] depth Depth of the subtree's root
+  //! \param[in] min_overlap_area Child overlap above which spatial
+  //!            splits are tried
+  //! \param[in,out] budget Number of references that spatial splits
+  //!                may still add
+  //! \param[in] node_index Already allocated node for the subtree's root
+  void BuildSpatial(std::vector<PrimitiveInfo> &references, uint depth,
+                    Real min_overlap_area, size_t &budget, uint32_t node_index);
+
+  //! \brief Build the hierarchy from the Morton codes of the surfaces'
+  //!        centroids: codes are radix-sorted and every inner node
+  //!        splits its range where the highest differing code bit
+  //!        flips. All stages run in parallel. Also fills 'primitives_'.
+  //! \param[in,out] primitives Build primitives; their surfaces are
+  //!                moved to 'primitives_'
+  void BuildLinear(std::vector<PrimitiveInfo> &primitives);
+
+  //! \brief Append a sibling pair of uninitialized nodes to a node
+  //!        array; the root's children are preceded by padding
+  //! \param[in,out] nodes Node array
+  //! \param[in] depth Depth of the pair's parent
+  //! \return Index of the pair's first node
+  static uint32_t AddPair(NodeArray &nodes, uint depth);
+
+  NodeArray nodes_;                        //!< depth-first ordered nodes
+  std::vector<Surface::Ptr> primitives_;   //!< surfaces in leaf order
+  AABB bbox_;                              //!< bounding box of all surfaces
+  BuildMethod method_;                     //!< algorithm used to build
+  Real build_cost_{0};                     //!< SAH cost right after building
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,385 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       compressed_bvh.cc
+//! \brief      CompressedBVH class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/compressed_bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include "core/ray.h"
+#include "core/geometry/wide_bvh_intersector.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+using namespace detail;
+
+constexpr uint CompressedBVH::kWidth;
+constexpr int CompressedBVH::kMinExponent;
+constexpr uint CompressedBVH::kStackSize;
+
+namespace {
+
+// leaf children's primitives are addressed with 3-bit counts and 5-bit
+// offsets from the node's primitive base
+static_assert(BVH::kMaxLeafSize <= 4,
+              "CompressedBVHNode cannot address leaves this large");
+
+
+// 2^exponent for exponents of normal floats
+inline float
+PowerOfTwo(int exponent)
+{
+  auto bits = static_cast<uint32_t>(exponent + 127) << 23;
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+
+// largest quantized value that decodes to at most 'value'
+inline uint8_t
+QuantizeDown(float value, float origin, float scale)
+{
+  auto q = static_cast<int>(std::floor((value - origin) / scale));
+  q = std::max(0, std::min(q, 255));
+  while (q > 0 && origin + static_cast<float>(q) * scale > value)
+    --q;
+  return static_cast<uint8_t>(q);
+}
+
+
+// smallest quantized value that decodes to at least 'value'
+inline uint8_t
+QuantizeUp(float value, float origin, float scale)
+{
+  auto q = static_cast<int>(std::ceil((value - origin) / scale));
+  q = std::max(0, std::min(q, 255));
+  while (q < 255 && origin + static_cast<float>(q) * scale < value)
+    ++q;
+  return static_cast<uint8_t>(q);
+}
+
+
+#if defined(OLIO_WIDE_BVH_SSE)
+// decode four quantized values
+inline __m128
+Decode4(const uint8_t *q, __m128 origin, __m128 scale)
+{
+  int32_t bytes;
+  memcpy(&bytes, q, sizeof(bytes));
+  __m128i zero = _mm_setzero_si128();
+  __m128i values = _mm_unpacklo_epi16(
+    _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+  return _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(values), scale), origin);
+}
+#endif
+
+
+// decode a node's child boxes into the bounds of an uncompressed node
+inline void
+Decode(const CompressedBVHNode &node, WideBVHNode<CompressedBVH::kWidth> &decoded)
+{
+  for (int axis = 0; axis < 3; ++axis) {
+    float scale = PowerOfTwo(node.exponent[axis]);
+#if defined(OLIO_WIDE_BVH_SSE)
+    __m128 origin4 = _mm_set1_ps(node.origin[axis]);
+    __m128 scale4 = _mm_set1_ps(scale);
+    for (uint i = 0; i < CompressedBVH::kWidth; i += 4) {
+      _mm_store_ps(decoded.bbox_min[axis] + i,
+                   Decode4(node.qmin[axis] + i, origin4, scale4));
+      _mm_store_ps(decoded.bbox_max[axis] + i,
+                   Decode4(node.qmax[axis] + i, origin4, scale4));
+    }
+#else
+    for (uint i = 0; i < CompressedBVH::kWidth; ++i) {
+      decoded.bbox_min[axis][i] = node.origin[axis] +
+        static_cast<float>(node.qmin[axis][i]) * scale;
+      decoded.bbox_max[axis][i] = node.origin[axis] +
+        static_cast<float>(node.qmax[axis][i]) * scale;
+    }
+#endif
+  }
+}
+
+}  // namespace
+
+
+CompressedBVH::CompressedBVH(const vector<Surface::Ptr> &surfaces,
+                             const std::string &name) :
+  Surface{}
+{
+  name_ = name.size() ? name : "CompressedBVH";
+  auto bvh = BVH::Create(surfaces);
+  Init(*bvh);
+}
+
+
+CompressedBVH::CompressedBVH(const BVH &bvh, const std::string &name) :
+  Surface{}
+{
+  name_ = name.size() ? name : "CompressedBVH";
+  Init(bvh);
+}
+
+
+void
+CompressedBVH::Init(const BVH &bvh)
+{
+  bvh.GetBoundingBox(bbox_);
+  const auto &binary_nodes = bvh.GetNodes();
+  if (!binary_nodes.size())
+    return;
+
+  // every node but a single-leaf root replaces at least one binary
+  // inner node
+  nodes_.reserve(binary_nodes.size() / 2 + 1);
+  primitives_.reserve(bvh.GetPrimitives().size());
+  nodes_.emplace_back();
+  Collapse(bvh, 0, 0);
+  nodes_.shrink_to_fit();
+  spdlog::info("{}: {} nodes in {} KB ({} KB uncompressed)", name_,
+               nodes_.size(), nodes_.size() * sizeof(CompressedBVHNode) / 1024,
+               nodes_.size() * sizeof(WideBVHNode<kWidth>) / 1024);
+}
+
+
+void
+CompressedBVH::Collapse(const BVH &bvh, uint32_t binary_index,
+                        uint32_t node_index)
+{
+  const auto &binary_nodes = bvh.GetNodes();
+  auto node_area = [&](uint32_t index) -> float {
+    const LinearBVHNode &node = binary_nodes[index];
+    float dx = node.bbox_max[0] - node.bbox_min[0];
+    float dy = node.bbox_max[1] - node.bbox_min[1];
+    float dz = node.bbox_max[2] - node.bbox_min[2];
+    return dx * dy + dx * dz + dy * dz;
+  };
+
+  // open up the largest inner descendants until all slots are used, as
+  // WideBVH does
+  uint32_t slots[kWidth];
+  uint slot_count = 1;
+  slots[0] = binary_index;
+  if (!binary_nodes[binary_index].IsLeaf()) {
+    slot_count = 2;
+    slots[0] = binary_nodes[binary_index].offset;
+    slots[1] = binary_nodes[binary_index].offset + 1;
+  }
+  while (slot_count < kWidth) {
+    uint largest = kWidth;
+    float largest_area = -1;
+    for (uint i = 0; i < slot_count; ++i) {
+      if (binary_nodes[slots[i]].IsLeaf())
+        continue;
+      float area = node_area(slots[i]);
+      if (area > largest_area) {
+        largest_area = area;
+        largest = i;
+      }
+    }
+    if (largest == kWidth)
+      break;
+    uint32_t opened = slots[largest];
+    slots[largest] = binary_nodes[opened].offset;
+    slots[slot_count++] = binary_nodes[opened].offset + 1;
+  }
+
+  // quantization grid: per axis, the smallest power-of-two step whose
+  // 255 steps from the children's minimum cover their maximum
+  CompressedBVHNode node;
+  memset(&node, 0, sizeof(node));
+  float scale[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    float lo = numeric_limits<float>::infinity();
+    float hi = -numeric_limits<float>::infinity();
+    for (uint i = 0; i < slot_count; ++i) {
+      lo = std::min(lo, binary_nodes[slots[i]].bbox_min[axis]);
+      hi = std::max(hi, binary_nodes[slots[i]].bbox_max[axis]);
+    }
+    int exponent = kMinExponent;
+    if (hi > lo) {
+      int step_exponent;
+      std::frexp((static_cast<double>(hi) - lo) / 255, &step_exponent);
+      exponent = std::max(step_exponent, kMinExponent);
+    }
+    while (exponent < 127 && lo + 255 * PowerOfTwo(exponent) < hi)
+      ++exponent;
+    node.origin[axis] = lo;
+    node.exponent[axis] = static_cast<int8_t>(exponent);
+    scale[axis] = PowerOfTwo(exponent);
+  }
+
+  // inner children get consecutive nodes; leaf children's primitives
+  // are appended in slot order
+  uint inner_count = 0;
+  for (uint i = 0; i < slot_count; ++i)
+    if (!binary_nodes[slots[i]].IsLeaf())
+      ++inner_count;
+  node.child_base = static_cast<uint32_t>(nodes_.size());
+  node.primitive_base = static_cast<uint32_t>(primitives_.size());
+  nodes_.resize(nodes_.size() + inner_count);
+  const auto &binary_primitives = bvh.GetPrimitives();
+  uint inner_index = 0;
+  for (uint i = 0; i < slot_count; ++i) {
+    const LinearBVHNode &child = binary_nodes[slots[i]];
+    for (int axis = 0; axis < 3; ++axis) {
+      node.qmin[axis][i] = QuantizeDown(child.bbox_min[axis], node.origin[axis],
+                                        scale[axis]);
+      node.qmax[axis][i] = QuantizeUp(child.bbox_max[axis], node.origin[axis],
+                                      scale[axis]);
+    }
+    if (child.IsLeaf()) {
+      auto first = primitives_.size() - node.primitive_base;
+      node.meta[i] = static_cast<uint8_t>(child.primitive_count << 5 | first);
+      primitives_.insert(primitives_.end(),
+                         binary_primitives.begin() + child.offset,
+                         binary_primitives.begin() + child.offset +
+                         child.primitive_count);
+    } else {
+      node.inner_mask = static_cast<uint8_t>(node.inner_mask | 1u << i);
+      node.meta[i] = static_cast<uint8_t>(inner_index++);
+    }
+  }
+  nodes_[node_index] = node;
+  for (uint i = 0; i < slot_count; ++i)
+    if (node.inner_mask & (1u << i))
+      Collapse(bvh, slots[i], node.child_base + node.meta[i]);
+}
+
+
+bool
+CompressedBVH::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
+{
+  if (!nodes_.size())
+    return false;
+
+  WideRay wide_ray(ray);
+  NodeIntersector<kWidth> intersector(wide_ray);
+  float tmin_f = RoundDownToFloat(tmin);
+  float tmax_f = RoundUpToFloat(tmax);
+
+  bool hit_something = false;
+  StackEntry stack[kStackSize];
+  uint stack_size = 0;
+  stack[stack_size++] = StackEntry{0, tmin_f};
+  const CompressedBVHNode *nodes = nodes_.data();
+  WideBVHNode<kWidth> decoded;
+  while (stack_size) {
+    const StackEntry entry = stack[--stack_size];
+    if (entry.tnear > tmax_f * kRobustScale)
+      continue;
+    const CompressedBVHNode &node = nodes[entry.node];
+    Decode(node, decoded);
+    float tnear[kWidth];
+    uint mask = intersector.Intersect(decoded, tmin_f, tmax_f, tnear) &
+      node.GetChildMask();
+    if (!mask)
+      continue;
+
+    // sort hit children front to back
+    uint order[kWidth];
+    uint hit_count = 0;
+    for (uint i = 0; i < kWidth; ++i) {
+      if (!(mask & (1u << i)))
+        continue;
+      uint j = hit_count++;
+      for (; j > 0 && tnear[order[j - 1]] > tnear[i]; --j)
+        order[j] = order[j - 1];
+      order[j] = i;
+    }
+
+    // intersect leaves now, nearest first, and queue inner children
+    // so that the nearest one is visited next
+    for (uint k = 0; k < hit_count; ++k) {
+      uint i = order[k];
+      if ((node.inner_mask & (1u << i)) || tnear[i] > tmax_f * kRobustScale)
+        continue;
+      uint32_t first = node.primitive_base + (node.meta[i] & 31u);
+      uint32_t count = node.meta[i] >> 5;
+      for (uint32_t p = first; p < first + count; ++p) {
+        if (primitives_[p]->Hit(ray, tmin, tmax, hit_record)) {
+          hit_something = true;
+          tmax = hit_record.GetRayT();
+          tmax_f = RoundUpToFloat(tmax);
+        }
+      }
+    }
+    for (uint k = hit_count; k-- > 0;) {
+      uint i = order[k];
+      if (!(node.inner_mask & (1u << i)))
+        continue;
+      uint32_t child = node.child_base + node.meta[i];
+      OLIO_PREFETCH(&nodes[child]);
+      stack[stack_size++] = StackEntry{child, tnear[i]};
+    }
+  }
+  return hit_something;
+}
+
+
+bool
+CompressedBVH::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!nodes_.size())
+    return false;
+
+  WideRay wide_ray(ray);
+  NodeIntersector<kWidth> intersector(wide_ray);
+  float tmin_f = RoundDownToFloat(tmin);
+  float tmax_f = RoundUpToFloat(tmax);
+
+  // any hit will do: children are neither sorted nor culled by distance
+  uint32_t stack[kStackSize];
+  uint stack_size = 0;
+  stack[stack_size++] = 0;
+  const CompressedBVHNode *nodes = nodes_.data();
+  WideBVHNode<kWidth> decoded;
+  while (stack_size) {
+    const CompressedBVHNode &node = nodes[stack[--stack_size]];
+    Decode(node, decoded);
+    float tnear[kWidth];
+    uint mask = intersector.Intersect(decoded, tmin_f, tmax_f, tnear) &
+      node.GetChildMask();
+    for (uint i = 0; i < kWidth; ++i) {
+      if (!(mask & (1u << i)))
+        continue;
+      if (node.inner_mask & (1u << i)) {
+        uint32_t child = node.child_base + node.meta[i];
+        OLIO_PREFETCH(&nodes[child]);
+        stack[stack_size++] = child;
+        continue;
+      }
+      uint32_t first = node.primitive_base + (node.meta[i] & 31u);
+      uint32_t count = node.meta[i] >> 5;
+      for (uint32_t p = first; p < first + count; ++p)
+        if (primitives_[p]->Occluded(ray, tmin, tmax))
+          return true;
+    }
+  }
+  return false;
+}
+
+
+bool
+CompressedBVH::GetBoundingBox(AABB &bbox) const
+{
+  bbox = bbox_;
+  return nodes_.size() > 0;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
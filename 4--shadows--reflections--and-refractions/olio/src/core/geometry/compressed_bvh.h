@@ -0,0 +1,149 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       compressed_bvh.h
+//! \brief      CompressedBVH class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tbb/cache_aligned_allocator.h>
+#include "core/geometry/surface.h"
+#include "core/geometry/aabb.h"
+#include "core/geometry/bvh.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class Ray;
+class HitRecord;
+
+//! \struct CompressedBVHNode
+//! \brief Node of an 8-wide BVH whose child bounds are quantized to 8
+//! bits relative to the node's own box: 80 bytes instead of the 256 of
+//! WideBVHNode<8>. Per axis, quantized value q decodes to origin + q *
+//! 2^exponent; the product is exact, so decoding rounds once, and the
+//! builder picks quantized values whose decoded bounds contain the
+//! exact ones. Inner children are stored contiguously from
+//! 'child_base', and the primitives of all leaf children contiguously
+//! from 'primitive_base'.
+struct alignas(16) CompressedBVHNode {
+  float origin[3];          //!< minimum corner of the node's box
+  int8_t exponent[3];       //!< per-axis quantization step as a power of two
+  uint8_t inner_mask;       //!< bit i set if child i is an inner node
+  uint32_t child_base;      //!< node index of the first inner child
+  uint32_t primitive_base;  //!< index of the first leaf primitive
+  uint8_t meta[8];          //!< inner: child - child_base; leaf:
+                            //!< primitive count << 5 | first primitive -
+                            //!< primitive_base; unused: 0
+  uint8_t qmin[3][8];       //!< per-axis quantized minimum corners of children
+  uint8_t qmax[3][8];       //!< per-axis quantized maximum corners of children
+
+  //! \brief Get the slots that hold a child
+  //! \return Bit mask of used child slots
+  inline uint GetChildMask() const {
+    uint mask = inner_mask;
+    for (uint i = 0; i < 8; ++i)
+      if (meta[i] >> 5)
+        mask |= 1u << i;
+    return mask;
+  }
+};
+static_assert(sizeof(CompressedBVHNode) == 80, "CompressedBVHNode must be 80 bytes");
+
+
+//! \class CompressedBVH
+//! \brief 8-wide bounding volume hierarchy with quantized child bounds,
+//! collapsed from a binary BVH, for scenes whose node memory would
+//! otherwise dominate
+//! \details Quantized bounds are rounded outwards, so decoded boxes
+//! contain the exact ones and traversal finds the same hits as the
+//! uncompressed WideBVH; rays merely visit a few more nodes. Each
+//! traversal step decodes the node's child boxes and tests them with
+//! the WideBVH intersectors. Surfaces are reordered so that the leaf
+//! children of a node share one contiguous primitive range.
+class CompressedBVH : public Surface {
+public:
+  OLIO_NODE(CompressedBVH)
+
+  //! \brief Constructor; builds a binary BVH over the input surfaces
+  //!        and collapses it into a compressed 8-wide hierarchy
+  //! \param[in] surfaces Surfaces to build the hierarchy over
+  //! \param[in] name Node name
+  CompressedBVH(const std::vector<Surface::Ptr> &surfaces,
+                const std::string &name=std::string());
+
+  //! \brief Constructor; collapses an existing binary BVH
+  //! \param[in] bvh Binary BVH to collapse
+  //! \param[in] name Node name
+  CompressedBVH(const BVH &bvh, const std::string &name=std::string());
+
+  //! \brief Check if ray intersects with surface
+  //! \details If the ray intersections the surface, the function
+  //!          should fill in the 'hit_record' (i.e., information
+  //!          about the hit point, normal, etc.)
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \param[out] hit_record Resulting hit record if ray intersected with surface
+  //! \return True if ray intersected with surface
+  bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
+
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Stops at the first primitive hit; hit children are not
+  //!          sorted by distance
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the hierarchy contains at least one surface
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  //! \brief Contiguous node storage aligned to cache lines
+  using NodeArray = std::vector<CompressedBVHNode,
+                                tbb::cache_aligned_allocator<CompressedBVHNode>>;
+
+  //! \brief Get the nodes; node 0 is the root
+  //! \return Hierarchy nodes
+  const NodeArray& GetNodes() const {return nodes_;}
+
+  static constexpr uint kWidth = 8;  //!< children per node
+  static constexpr int kMinExponent = -100;  //!< smallest quantization step exponent
+  //! \brief Max number of pending nodes during traversal; the wide
+  //! tree is never deeper than the binary one
+  static constexpr uint kStackSize = BVH::kMaxDepth * (kWidth - 1);
+protected:
+  //! \brief Collapse the binary subtree rooted at 'binary_index' into
+  //!        the compressed node at 'node_index' and, recursively, its
+  //!        descendants
+  //! \param[in] bvh Binary BVH
+  //! \param[in] binary_index Root of the binary subtree; a leaf only
+  //!            for single-leaf hierarchies
+  //! \param[in] node_index Already allocated compressed node
+  void Collapse(const BVH &bvh, uint32_t binary_index, uint32_t node_index);
+
+  //! \brief Initialize from a binary BVH
+  //! \param[in] bvh Binary BVH to collapse
+  void Init(const BVH &bvh);
+
+  NodeArray nodes_;                       //!< compressed nodes; node 0 is the root
+  std::vector<Surface::Ptr> primitives_;  //!< surfaces in leaf order
+  AABB bbox_;                             //!< bounding box of all surfaces
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,354 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       grid_accelerator.cc
+//! \brief      GridAccelerator class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/grid_accelerator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include "core/ray.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+constexpr Real GridAccelerator::kCellDensity;
+constexpr uint GridAccelerator::kMaxResolution;
+constexpr uint GridAccelerator::kSubgridThreshold;
+constexpr uint GridAccelerator::kMaxSubgridResolution;
+constexpr uint32_t GridAccelerator::kNoSubgrid;
+
+namespace {
+
+// surfaces are inserted into every cell their bounds touch, grown by
+// this fraction of a cell, so that rounding in the DDA never skips them
+constexpr Real kCellPadding = Real(1e-3);
+
+// pick the number of cells along each axis so that the cells are
+// roughly cubes and there are about kCellDensity cells per surface
+void
+ComputeResolution(const Vec3r &extent, size_t count, uint max_resolution,
+                  uint resolution[3])
+{
+  Real max_extent = extent.maxCoeff();
+  if (!(max_extent > 0) || !count) {
+    resolution[0] = resolution[1] = resolution[2] = 1;
+    return;
+  }
+
+  // flat axes count as thin slabs so the volume is never zero
+  Vec3r padded = extent.cwiseMax(Vec3r::Constant(max_extent * Real(1e-3)));
+  Real volume = padded[0] * padded[1] * padded[2];
+  Real cells_per_unit = std::cbrt(GridAccelerator::kCellDensity *
+                                  static_cast<Real>(count) / volume);
+  for (uint axis = 0; axis < 3; ++axis) {
+    Real cells = std::round(extent[axis] * cells_per_unit);
+    cells = std::min(std::max(cells, Real(1)), static_cast<Real>(max_resolution));
+    resolution[axis] = static_cast<uint>(cells);
+  }
+}
+
+
+// index of the cell containing 'value' along an axis, clamped to the grid
+inline int
+CellIndex(Real value, Real origin, Real inv_cell_size, uint resolution)
+{
+  Real cell = std::floor((value - origin) * inv_cell_size);
+  cell = std::min(std::max(cell, Real(0)), static_cast<Real>(resolution - 1));
+  return static_cast<int>(cell);
+}
+
+}  // namespace
+
+
+GridAccelerator::GridAccelerator(const vector<Surface::Ptr> &surfaces,
+                                 bool two_level, const std::string &name) :
+  Surface{}
+{
+  name_ = name.size() ? name : (two_level ? "Grid2" : "Grid");
+
+  // gather bounds of all surfaces
+  vector<AABB> primitive_bounds;
+  primitive_bounds.reserve(surfaces.size());
+  primitives_.reserve(surfaces.size());
+  for (auto &surface : surfaces) {
+    AABB bbox;
+    if (!surface || !surface->GetBoundingBox(bbox)) {
+      spdlog::warn("GridAccelerator: skipping unbounded surface");
+      continue;
+    }
+    bbox_.Extend(bbox);
+    primitive_bounds.push_back(bbox);
+    primitives_.push_back(surface);
+  }
+  if (!primitives_.size())
+    return;
+
+  // top-level grid over all surfaces
+  vector<uint32_t> primitive_ids(primitives_.size());
+  for (uint32_t i = 0; i < primitive_ids.size(); ++i)
+    primitive_ids[i] = i;
+  AddLevel(bbox_, primitive_ids, primitive_bounds, kMaxResolution);
+  if (!two_level)
+    return;
+
+  // refine dense top-level cells with their own grids
+  const GridLevel top_level = levels_[0];
+  for (uint z = 0; z < top_level.resolution[2]; ++z) {
+    for (uint y = 0; y < top_level.resolution[1]; ++y) {
+      for (uint x = 0; x < top_level.resolution[0]; ++x) {
+        uint32_t cell_index = (z * top_level.resolution[1] + y) *
+          top_level.resolution[0] + x;
+        const GridCell cell = cells_[cell_index];
+        if (cell.count <= kSubgridThreshold)
+          continue;
+        Vec3r cell_min = top_level.bounds.GetMin() +
+          Vec3r{static_cast<Real>(x), static_cast<Real>(y),
+                static_cast<Real>(z)}.cwiseProduct(top_level.cell_size);
+        AABB cell_bounds{cell_min, cell_min + top_level.cell_size};
+        vector<uint32_t> cell_ids(cell_primitives_.begin() + cell.offset,
+                                  cell_primitives_.begin() + cell.offset +
+                                  cell.count);
+        uint32_t subgrid = AddLevel(cell_bounds, cell_ids, primitive_bounds,
+                                    kMaxSubgridResolution);
+        cells_[cell_index].subgrid = subgrid;
+      }
+    }
+  }
+  spdlog::info("GridAccelerator: refined {} dense cell(s)", levels_.size() - 1);
+}
+
+
+uint32_t
+GridAccelerator::AddLevel(const AABB &bounds,
+                          const vector<uint32_t> &primitive_ids,
+                          const vector<AABB> &primitive_bounds,
+                          uint max_resolution)
+{
+  GridLevel level;
+  level.bounds = bounds;
+  Vec3r extent = bounds.GetDiagonal();
+  ComputeResolution(extent, primitive_ids.size(), max_resolution,
+                    level.resolution);
+  for (uint axis = 0; axis < 3; ++axis) {
+    level.cell_size[axis] = extent[axis] /
+      static_cast<Real>(level.resolution[axis]);
+    level.inv_cell_size[axis] = level.cell_size[axis] > 0 ?
+      1 / level.cell_size[axis] : 0;
+  }
+  level.first_cell = static_cast<uint32_t>(cells_.size());
+  size_t cell_count = static_cast<size_t>(level.resolution[0]) *
+    level.resolution[1] * level.resolution[2];
+  cells_.resize(cells_.size() + cell_count);
+  GridCell *cells = cells_.data() + level.first_cell;
+
+  // range of cells overlapped by a surface, along each axis
+  const Vec3r &origin = bounds.GetMin();
+  auto cell_range = [&](uint32_t id, uint lo[3], uint hi[3]) {
+    const AABB &bbox = primitive_bounds[id];
+    for (uint axis = 0; axis < 3; ++axis) {
+      Real inv = level.inv_cell_size[axis];
+      Real pad = kCellPadding / (inv > 0 ? inv : 1);
+      lo[axis] = static_cast<uint>(CellIndex(bbox.GetMin()[axis] - pad,
+                                             origin[axis], inv,
+                                             level.resolution[axis]));
+      hi[axis] = static_cast<uint>(CellIndex(bbox.GetMax()[axis] + pad,
+                                             origin[axis], inv,
+                                             level.resolution[axis]));
+    }
+  };
+
+  // count the surfaces of each cell, then fill the cells' ranges
+  uint lo[3], hi[3];
+  for (auto id : primitive_ids) {
+    cell_range(id, lo, hi);
+    for (uint z = lo[2]; z <= hi[2]; ++z)
+      for (uint y = lo[1]; y <= hi[1]; ++y)
+        for (uint x = lo[0]; x <= hi[0]; ++x)
+          ++cells[(z * level.resolution[1] + y) * level.resolution[0] + x].count;
+  }
+  size_t offset = cell_primitives_.size();
+  for (size_t i = 0; i < cell_count; ++i) {
+    cells[i].offset = static_cast<uint32_t>(offset);
+    offset += cells[i].count;
+  }
+  if (offset > std::numeric_limits<uint32_t>::max())
+    spdlog::error("GridAccelerator: too many cell references ({})", offset);
+  cell_primitives_.resize(offset);
+  vector<uint32_t> fill(cell_count, 0);
+  for (auto id : primitive_ids) {
+    cell_range(id, lo, hi);
+    for (uint z = lo[2]; z <= hi[2]; ++z) {
+      for (uint y = lo[1]; y <= hi[1]; ++y) {
+        for (uint x = lo[0]; x <= hi[0]; ++x) {
+          uint cell = (z * level.resolution[1] + y) * level.resolution[0] + x;
+          cell_primitives_[cells[cell].offset + fill[cell]++] = id;
+        }
+      }
+    }
+  }
+
+  levels_.push_back(level);
+  return static_cast<uint32_t>(levels_.size() - 1);
+}
+
+
+GridAccelerator::Mailbox&
+GridAccelerator::NextMailbox()
+{
+  // start a new ray in this thread's mailbox; reset on id wrap-around
+  Mailbox &mailbox = mailboxes_.local();
+  if (mailbox.last_ray.size() != primitives_.size()) {
+    mailbox.last_ray.assign(primitives_.size(), 0);
+    mailbox.ray_id = 0;
+  }
+  if (++mailbox.ray_id == 0) {
+    std::fill(mailbox.last_ray.begin(), mailbox.last_ray.end(), 0);
+    mailbox.ray_id = 1;
+  }
+  return mailbox;
+}
+
+
+bool
+GridAccelerator::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
+{
+  if (!levels_.size())
+    return false;
+  return Traverse(0, ray, tmin, tmax, tmin, tmax, NextMailbox(),
+                  &hit_record);
+}
+
+
+bool
+GridAccelerator::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!levels_.size())
+    return false;
+  return Traverse(0, ray, tmin, tmax, tmin, tmax, NextMailbox(), nullptr);
+}
+
+
+bool
+GridAccelerator::Traverse(uint32_t level_index, const Ray &ray, Real tmin,
+                          Real &tmax, Real tstart, Real tend, Mailbox &mailbox,
+                          HitRecord *hit_record)
+{
+  const GridLevel &level = levels_[level_index];
+  const Vec3r origin = ray.GetOrigin();
+  const Vec3r dir = ray.GetDirection();
+  const Vec3r &grid_min = level.bounds.GetMin();
+  const Vec3r &grid_max = level.bounds.GetMax();
+
+  // clip the ray segment to the grid; written so that NaNs (0 * inf)
+  // leave the segment unchanged
+  for (uint axis = 0; axis < 3; ++axis) {
+    Real inv_dir = 1 / dir[axis];
+    Real t0 = (grid_min[axis] - origin[axis]) * inv_dir;
+    Real t1 = (grid_max[axis] - origin[axis]) * inv_dir;
+    if (t0 > t1)
+      std::swap(t0, t1);
+    tstart = t0 > tstart ? t0 : tstart;
+    tend = t1 < tend ? t1 : tend;
+    if (tend < tstart)
+      return false;
+  }
+
+  // set up the 3D-DDA at the cell where the ray enters the grid
+  const Vec3r entry = ray.At(tstart);
+  int cell[3], step[3], out[3];
+  Real next_t[3], delta_t[3];
+  for (uint axis = 0; axis < 3; ++axis) {
+    cell[axis] = CellIndex(entry[axis], grid_min[axis],
+                           level.inv_cell_size[axis], level.resolution[axis]);
+    if (level.resolution[axis] == 1 || dir[axis] == 0) {
+      next_t[axis] = kInfinity;
+      delta_t[axis] = 0;
+      step[axis] = 0;
+      out[axis] = -1;
+    } else if (dir[axis] > 0) {
+      Real boundary = grid_min[axis] +
+        static_cast<Real>(cell[axis] + 1) * level.cell_size[axis];
+      next_t[axis] = tstart + (boundary - entry[axis]) / dir[axis];
+      delta_t[axis] = level.cell_size[axis] / dir[axis];
+      step[axis] = 1;
+      out[axis] = static_cast<int>(level.resolution[axis]);
+    } else {
+      Real boundary = grid_min[axis] +
+        static_cast<Real>(cell[axis]) * level.cell_size[axis];
+      next_t[axis] = tstart + (boundary - entry[axis]) / dir[axis];
+      delta_t[axis] = -level.cell_size[axis] / dir[axis];
+      step[axis] = -1;
+      out[axis] = -1;
+    }
+  }
+
+  bool hit_something = false;
+  Real cell_enter = tstart;
+  while (true) {
+    const GridCell &grid_cell = cells_[level.first_cell +
+      (static_cast<uint32_t>(cell[2]) * level.resolution[1] +
+       static_cast<uint32_t>(cell[1])) * level.resolution[0] +
+      static_cast<uint32_t>(cell[0])];
+
+    // the axis whose cell boundary the ray crosses first
+    uint axis = next_t[0] < next_t[1] ? 0 : 1;
+    axis = next_t[2] < next_t[axis] ? 2 : axis;
+    Real cell_exit = std::min(next_t[axis], tend);
+
+    if (grid_cell.subgrid != kNoSubgrid) {
+      if (Traverse(grid_cell.subgrid, ray, tmin, tmax, cell_enter, cell_exit,
+                   mailbox, hit_record)) {
+        if (!hit_record)
+          return true;
+        hit_something = true;
+      }
+    } else {
+      for (uint32_t i = 0; i < grid_cell.count; ++i) {
+        uint32_t id = cell_primitives_[grid_cell.offset + i];
+        if (mailbox.last_ray[id] == mailbox.ray_id)
+          continue;
+        mailbox.last_ray[id] = mailbox.ray_id;
+        if (!hit_record) {
+          if (primitives_[id]->Occluded(ray, tmin, tmax))
+            return true;
+        } else if (primitives_[id]->Hit(ray, tmin, tmax, *hit_record)) {
+          hit_something = true;
+          tmax = hit_record->GetRayT();
+        }
+      }
+    }
+
+    // no hit in later cells can be closer than one inside this cell
+    if (tmax <= cell_exit || next_t[axis] > tend)
+      break;
+    cell[axis] += step[axis];
+    if (cell[axis] == out[axis])
+      break;
+    cell_enter = next_t[axis];
+    next_t[axis] += delta_t[axis];
+  }
+  return hit_something;
+}
+
+
+bool
+GridAccelerator::GetBoundingBox(AABB &bbox) const
+{
+  bbox = bbox_;
+  return levels_.size() > 0;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
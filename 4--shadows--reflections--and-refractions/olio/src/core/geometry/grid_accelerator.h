@@ -0,0 +1,149 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       grid_accelerator.h
+//! \brief      GridAccelerator class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tbb/enumerable_thread_specific.h>
+#include "core/geometry/surface.h"
+#include "core/geometry/aabb.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class Ray;
+class HitRecord;
+
+//! \class GridAccelerator
+//! \brief Uniform grid over the scene's surfaces, optionally with a
+//! second level: cells that overlap many surfaces get their own,
+//! finer grid. Rays walk the cells front to back with a 3D-DDA and
+//! stop at the first cell that ends behind the closest hit.
+//! \details A surface overlapping several cells is referenced by all
+//! of them. Per-thread mailboxes make sure each ray tests each surface
+//! at most once.
+class GridAccelerator : public Surface {
+public:
+  OLIO_NODE(GridAccelerator)
+
+  //! \brief Constructor; builds the grid over the input surfaces
+  //! \details Surfaces without a bounding box cannot be placed in
+  //!          cells and are skipped with a warning.
+  //! \param[in] surfaces Surfaces to build the grid over
+  //! \param[in] two_level Whether to refine dense cells with sub-grids
+  //! \param[in] name Node name
+  GridAccelerator(const std::vector<Surface::Ptr> &surfaces,
+                  bool two_level=false,
+                  const std::string &name=std::string());
+
+  //! \brief Check if ray intersects with surface
+  //! \details If the ray intersections the surface, the function
+  //!          should fill in the 'hit_record' (i.e., information
+  //!          about the hit point, normal, etc.)
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \param[out] hit_record Resulting hit record if ray intersected with surface
+  //! \return True if ray intersected with surface
+  bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
+
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Stops at the first primitive hit while walking the cells
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the grid contains at least one surface
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  static constexpr Real kCellDensity = 4;        //!< target cells per surface
+  static constexpr uint kMaxResolution = 128;    //!< max top-level cells per axis
+  static constexpr uint kSubgridThreshold = 16;  //!< surfaces that make a cell dense
+  static constexpr uint kMaxSubgridResolution = 8;  //!< max sub-grid cells per axis
+protected:
+  static constexpr uint32_t kNoSubgrid = 0xffffffff;  //!< cell has no sub-grid
+
+  //! \brief Cell of a grid level: a range of 'cell_primitives_' or,
+  //!        for dense top-level cells, a sub-grid
+  struct GridCell {
+    uint32_t offset{0};          //!< first entry in 'cell_primitives_'
+    uint32_t count{0};           //!< number of surfaces overlapping the cell
+    uint32_t subgrid{kNoSubgrid};  //!< index of sub-grid level, if any
+  };
+
+  //! \brief One uniform grid; level 0 spans the scene, the others are
+  //!        sub-grids of dense top-level cells
+  struct GridLevel {
+    AABB bounds;             //!< region covered by the grid
+    Vec3r cell_size;         //!< cell extent along each axis
+    Vec3r inv_cell_size;     //!< reciprocal of 'cell_size'
+    uint resolution[3];      //!< number of cells along each axis
+    uint32_t first_cell;     //!< index of the grid's first cell in 'cells_'
+  };
+
+  //! \brief Per-thread record of the last ray that tested each surface
+  struct Mailbox {
+    uint32_t ray_id{0};                //!< id of the current ray
+    std::vector<uint32_t> last_ray;    //!< per-surface id of last testing ray
+  };
+
+  //! \brief Add a grid level over the input surfaces
+  //! \param[in] bounds Region covered by the new grid
+  //! \param[in] primitive_ids Surfaces (indices into 'primitives_')
+  //!            overlapping the region
+  //! \param[in] primitive_bounds Bounds of all surfaces
+  //! \param[in] max_resolution Max number of cells along each axis
+  //! \return Index of the new level in 'levels_'
+  uint32_t AddLevel(const AABB &bounds,
+                    const std::vector<uint32_t> &primitive_ids,
+                    const std::vector<AABB> &primitive_bounds,
+                    uint max_resolution);
+
+  //! \brief Start a new ray in the calling thread's mailbox
+  //! \return Calling thread's mailbox
+  Mailbox& NextMailbox();
+
+  //! \brief Walk the cells of a grid level pierced by the ray
+  //! \param[in] level_index Grid level to traverse
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t
+  //! \param[in,out] tmax Maximum value for acceptable t; lowered to
+  //!                the closest hit
+  //! \param[in] tstart Start of the ray segment to walk
+  //! \param[in] tend End of the ray segment to walk
+  //! \param[in,out] mailbox Calling thread's mailbox
+  //! \param[out] hit_record Resulting hit record if ray intersected a
+  //!             surface; if null, the walk stops at the first hit
+  //!             (occlusion query)
+  //! \return True if ray intersected a surface
+  bool Traverse(uint32_t level_index, const Ray &ray, Real tmin, Real &tmax,
+                Real tstart, Real tend, Mailbox &mailbox,
+                HitRecord *hit_record);
+
+  std::vector<Surface::Ptr> primitives_;   //!< surfaces in the grid
+  std::vector<GridLevel> levels_;          //!< level 0 is the top-level grid
+  std::vector<GridCell> cells_;            //!< cells of all levels
+  std::vector<uint32_t> cell_primitives_;  //!< surfaces referenced by cells
+  AABB bbox_;                              //!< bounding box of all surfaces
+  tbb::enumerable_thread_specific<Mailbox> mailboxes_;  //!< per-thread mailboxes
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
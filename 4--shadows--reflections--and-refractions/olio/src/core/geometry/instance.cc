@@ -0,0 +1,157 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       instance.cc
+//! \brief      Instance class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/instance.h"
+#include <spdlog/spdlog.h>
+#include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/aabb.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+Instance::Ptr
+Instance::Create(Surface::Ptr object, const Mat4r &transform,
+                 const std::string &name)
+{
+  if (!IsInvertible(transform)) {
+    spdlog::error("Instance: transform is not invertible");
+    return nullptr;
+  }
+  return Ptr(new Instance(object, transform, name), NodeDeleter);
+}
+
+
+bool
+Instance::IsInvertible(const Mat4r &transform)
+{
+  Mat3r linear = transform.topLeftCorner<3, 3>();
+  Real scale = linear.col(0).norm() * linear.col(1).norm() *
+    linear.col(2).norm();
+  return std::abs(linear.determinant()) > kEpsilon * scale;
+}
+
+
+Instance::Instance(Surface::Ptr object, const Mat4r &transform,
+                   const std::string &name) :
+  Surface{},
+  object_{object}
+{
+  name_ = name.size() ? name : "Instance";
+  linear_ = transform.topLeftCorner<3, 3>();
+  translation_ = transform.topRightCorner<3, 1>();
+  inv_linear_ = linear_.inverse();
+  inv_translation_ = -(inv_linear_ * translation_);
+  normal_matrix_ = inv_linear_.transpose();
+}
+
+
+Mat4r
+Instance::GetTransform() const
+{
+  Mat4r transform = Mat4r::Identity();
+  transform.topLeftCorner<3, 3>() = linear_;
+  transform.topRightCorner<3, 1>() = translation_;
+  return transform;
+}
+
+
+bool
+Instance::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
+{
+  if (!object_)
+    return false;
+
+  // intersect in object space
+  Ray object_ray(inv_linear_ * ray.GetOrigin() + inv_translation_,
+                 inv_linear_ * ray.GetDirection());
+  if (!object_->Hit(object_ray, tmin, tmax, hit_record))
+    return false;
+
+  // the object's surfaces only know the object-space ray, so their
+  // attributes are computed here rather than for the final hit. t is
+  // shared by both spaces; the transformed normal keeps its side
+  // relative to the ray
+  hit_record.ComputeAttributes(object_ray);
+  hit_record.SetPoint(ray.At(hit_record.GetRayT()));
+  Vec3r normal = (normal_matrix_ * hit_record.GetNormal()).normalized();
+  hit_record.SetNormal(normal, hit_record.IsFrontFace());
+  return true;
+}
+
+
+uint64_t
+Instance::HitPacket(RayPacket &packet, uint64_t active, HitRecord *hit_records)
+{
+  if (!object_ || !active)
+    return 0;
+
+  // the same object-space rays as Hit() builds, traced as a packet
+  RayPacket object_packet;
+  object_packet.tmin = packet.tmin;
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    const Ray &ray = packet.rays[lane];
+    object_packet.Add(Ray(inv_linear_ * ray.GetOrigin() + inv_translation_,
+                          inv_linear_ * ray.GetDirection()), packet.tmax[lane]);
+  }
+  uint64_t hits = object_->HitPacket(object_packet, active, hit_records);
+
+  // convert the new hits to world space, as in Hit()
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    if (!(hits & (uint64_t(1) << lane)))
+      continue;
+    HitRecord &hit_record = hit_records[lane];
+    hit_record.ComputeAttributes(object_packet.rays[lane]);
+    hit_record.SetPoint(packet.rays[lane].At(hit_record.GetRayT()));
+    Vec3r normal = (normal_matrix_ * hit_record.GetNormal()).normalized();
+    hit_record.SetNormal(normal, hit_record.IsFrontFace());
+    packet.tmax[lane] = object_packet.tmax[lane];
+  }
+  return hits;
+}
+
+
+bool
+Instance::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!object_)
+    return false;
+  Ray object_ray(inv_linear_ * ray.GetOrigin() + inv_translation_,
+                 inv_linear_ * ray.GetDirection());
+  return object_->Occluded(object_ray, tmin, tmax);
+}
+
+
+bool
+Instance::GetBoundingBox(AABB &bbox) const
+{
+  AABB object_bbox;
+  if (!object_ || !object_->GetBoundingBox(object_bbox))
+    return false;
+
+  bbox = AABB();
+  const Vec3r &min_corner = object_bbox.GetMin();
+  const Vec3r &max_corner = object_bbox.GetMax();
+  for (uint corner = 0; corner < 8; ++corner) {
+    Vec3r point{(corner & 1) ? max_corner[0] : min_corner[0],
+                (corner & 2) ? max_corner[1] : min_corner[1],
+                (corner & 4) ? max_corner[2] : min_corner[2]};
+    bbox.Extend(linear_ * point + translation_);
+  }
+  return true;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,129 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       instance.h
+//! \brief      Instance class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "core/geometry/surface.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class Ray;
+class HitRecord;
+
+//! \class Instance
+//! \brief Placement of a shared surface (typically the acceleration
+//! structure of a group of surfaces) with an affine transform
+//! \details Rays are transformed into the object's space instead of
+//! transforming the object, so any number of instances share one copy
+//! of the geometry and of its acceleration structure. The direction
+//! is not renormalized, which keeps ray t identical in both spaces.
+//! Hit records keep the hit object-space surface (and thus its
+//! material); point and normal are computed when the instance is hit,
+//! while the object-space ray is at hand, and converted to world space.
+class Instance : public Surface {
+public:
+  // OLIO_NODE without its generic Create, so that invalid transforms
+  // can be rejected
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  using Ptr = std::shared_ptr<Instance>;
+  using ConstPtr = std::shared_ptr<Instance const>;
+  using WeakPtr = std::weak_ptr<Instance>;
+  std::shared_ptr<Instance> GetPtr() {
+    return std::dynamic_pointer_cast<Instance>(shared_from_this());}
+  std::shared_ptr<Instance const> GetPtr() const {
+    return std::dynamic_pointer_cast<Instance const>(shared_from_this());}
+  std::shared_ptr<Node> Clone() const override {
+    return std::shared_ptr<Node>(new Instance(*this), NodeDeleter);}
+
+  //! \brief Create an instance
+  //! \param[in] object Shared surface to place
+  //! \param[in] transform Affine object-to-world transform
+  //! \param[in] name Node name
+  //! \return Instance, or null if the transform is not invertible
+  static Ptr Create(Surface::Ptr object, const Mat4r &transform,
+                    const std::string &name=std::string());
+
+  //! \brief Check whether the linear part of a transform can be
+  //!        inverted
+  //! \details The determinant is compared to the product of the column
+  //!          lengths, so the test does not depend on the overall scale
+  //! \param[in] transform Affine transform
+  //! \return True if the transform is invertible
+  static bool IsInvertible(const Mat4r &transform);
+
+  //! \brief Check if ray intersects with surface
+  //! \details If the ray intersections the surface, the function
+  //!          should fill in the 'hit_record' (i.e., information
+  //!          about the hit point, normal, etc.)
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \param[out] hit_record Resulting hit record if ray intersected with surface
+  //! \return True if ray intersected with surface
+  bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
+
+  //! \brief Intersect the rays of a packet with the placed surface
+  //! \details Transforms the packet's rays into object space and
+  //!          intersects them with the object as one packet; hits are
+  //!          converted to world space as in Hit()
+  //! \param[in,out] packet Ray packet
+  //! \param[in] active Lanes to intersect (bit i is lane i)
+  //! \param[in,out] hit_records Hit records, one per lane of the packet
+  //! \return Lanes that intersected the surface
+  uint64_t HitPacket(RayPacket &packet, uint64_t active,
+                     HitRecord *hit_records) override;
+
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Transforms the ray into object space and asks the
+  //!          object; no point or normal is transformed
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \details Bounds the transformed corners of the object's box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the object is bounded
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  //! \brief Get the placed surface
+  //! \return Placed surface
+  Surface::Ptr GetObject() const {return object_;}
+
+  //! \brief Get the object-to-world transform
+  //! \return Affine transform
+  Mat4r GetTransform() const;
+protected:
+  //! \brief Constructor
+  //! \param[in] object Shared surface to place
+  //! \param[in] transform Affine object-to-world transform; must be
+  //!            invertible
+  //! \param[in] name Node name
+  Instance(Surface::Ptr object, const Mat4r &transform,
+           const std::string &name=std::string());
+
+  Surface::Ptr object_;         //!< placed surface
+  Mat3r linear_;                //!< linear part of object-to-world transform
+  Vec3r translation_;           //!< translation of object-to-world transform
+  Mat3r inv_linear_;            //!< linear part of world-to-object transform
+  Vec3r inv_translation_;       //!< translation of world-to-object transform
+  Mat3r normal_matrix_;         //!< inverse transpose of 'linear_'
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,354 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       kd_tree.cc
+//! \brief      KdTree class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/kd_tree.h"
+#include <algorithm>
+#include <cmath>
+#include <spdlog/spdlog.h>
+#include "core/ray.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+constexpr Real KdTree::kIntersectionCost;
+constexpr Real KdTree::kTraversalCost;
+constexpr Real KdTree::kEmptyBonus;
+constexpr uint KdTree::kMaxLeafSize;
+constexpr uint KdTree::kMaxDepth;
+
+namespace {
+
+// start or end of a surface's extent along the split axis
+struct BoundEdge {
+  Real t;             // position along the axis
+  uint32_t primitive; // surface index
+  bool start;         // whether the surface starts here
+
+  // order by position; at equal positions starts come first
+  bool operator<(const BoundEdge &other) const {
+    if (t == other.t)
+      return start && !other.start;
+    return t < other.t;
+  }
+};
+
+
+// node pending during traversal with the ray segment inside it
+struct KdToDo {
+  uint32_t node;
+  Real tmin, tmax;
+};
+
+}  // namespace
+
+
+KdTree::KdTree(const vector<Surface::Ptr> &surfaces, const std::string &name) :
+  Surface{}
+{
+  name_ = name.size() ? name : "KdTree";
+
+  // gather bounds of all surfaces
+  vector<AABB> primitive_bounds;
+  primitive_bounds.reserve(surfaces.size());
+  primitives_.reserve(surfaces.size());
+  for (auto &surface : surfaces) {
+    AABB bbox;
+    if (!surface || !surface->GetBoundingBox(bbox)) {
+      spdlog::warn("KdTree: skipping unbounded surface");
+      continue;
+    }
+    bbox_.Extend(bbox);
+    primitive_bounds.push_back(bbox);
+    primitives_.push_back(surface);
+  }
+  if (!primitives_.size())
+    return;
+
+  // split positions are stored in single precision; surfaces within a
+  // few float ulps of a plane are placed on both sides of it
+  split_padding_ = bbox_.GetDiagonal().cwiseAbs().maxCoeff() * Real(1e-6);
+
+  auto max_depth = static_cast<uint>(std::round(
+    8 + 1.3 * std::log2(static_cast<double>(primitives_.size()))));
+  max_depth = std::min(max_depth, kMaxDepth);
+  vector<uint32_t> primitive_ids(primitives_.size());
+  for (uint32_t i = 0; i < primitive_ids.size(); ++i)
+    primitive_ids[i] = i;
+  Build(bbox_, primitive_ids, primitive_bounds, max_depth, 0);
+}
+
+
+void
+KdTree::Build(const AABB &bounds, const vector<uint32_t> &primitive_ids,
+              const vector<AABB> &primitive_bounds, uint depth, uint bad_refines)
+{
+  auto node_index = static_cast<uint32_t>(nodes_.size());
+  nodes_.emplace_back();
+  auto count = static_cast<uint32_t>(primitive_ids.size());
+  auto make_leaf = [&]() {
+    nodes_[node_index].InitLeaf(static_cast<uint32_t>(primitive_indices_.size()),
+                                count);
+    primitive_indices_.insert(primitive_indices_.end(), primitive_ids.begin(),
+                              primitive_ids.end());
+  };
+  Real total_area = bounds.GetSurfaceArea();
+  if (count <= kMaxLeafSize || depth == 0 || !(total_area > 0)) {
+    make_leaf();
+    return;
+  }
+
+  // sweep the surfaces' edges along each axis, longest first, for the
+  // plane with the lowest SAH cost
+  const Vec3r diagonal = bounds.GetDiagonal();
+  const Real leaf_cost = kIntersectionCost * static_cast<Real>(count);
+  Real best_cost = kInfinity;
+  Real best_split = 0;
+  uint best_axis = 3;
+  uint axis = bounds.GetMaxExtentAxis();
+  vector<BoundEdge> edges(2 * primitive_ids.size());
+  for (uint retries = 0; retries < 3 && best_axis == 3; ++retries) {
+    for (size_t i = 0; i < primitive_ids.size(); ++i) {
+      uint32_t id = primitive_ids[i];
+      edges[2 * i] = BoundEdge{primitive_bounds[id].GetMin()[axis], id, true};
+      edges[2 * i + 1] = BoundEdge{primitive_bounds[id].GetMax()[axis], id, false};
+    }
+    std::sort(edges.begin(), edges.end());
+
+    uint other0 = (axis + 1) % 3;
+    uint other1 = (axis + 2) % 3;
+    Real cap_area = diagonal[other0] * diagonal[other1];
+    Real perimeter = diagonal[other0] + diagonal[other1];
+    uint32_t below_count = 0;
+    uint32_t above_count = count;
+    for (const auto &edge : edges) {
+      if (!edge.start)
+        --above_count;
+      if (edge.t > bounds.GetMin()[axis] && edge.t < bounds.GetMax()[axis]) {
+        Real below_area = 2 * (cap_area + (edge.t - bounds.GetMin()[axis]) *
+                               perimeter);
+        Real above_area = 2 * (cap_area + (bounds.GetMax()[axis] - edge.t) *
+                               perimeter);
+        Real bonus = (!below_count || !above_count) ? kEmptyBonus : 0;
+        Real cost = kTraversalCost + kIntersectionCost * (1 - bonus) *
+          (below_area * static_cast<Real>(below_count) +
+           above_area * static_cast<Real>(above_count)) / total_area;
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_split = edge.t;
+          best_axis = axis;
+        }
+      }
+      if (edge.start)
+        ++below_count;
+    }
+    axis = (axis + 1) % 3;
+  }
+
+  // give up on splits that keep costing more than a leaf
+  if (best_cost > leaf_cost)
+    ++bad_refines;
+  if (best_axis == 3 || bad_refines >= 3 ||
+      (best_cost > 4 * leaf_cost && count < 16)) {
+    make_leaf();
+    return;
+  }
+
+  // classify surfaces against the plane as stored in the node
+  auto split = static_cast<float>(best_split);
+  vector<uint32_t> below_ids, above_ids;
+  for (auto id : primitive_ids) {
+    if (primitive_bounds[id].GetMin()[best_axis] <= split + split_padding_)
+      below_ids.push_back(id);
+    if (primitive_bounds[id].GetMax()[best_axis] >= split - split_padding_)
+      above_ids.push_back(id);
+  }
+  if (below_ids.size() == count && above_ids.size() == count) {
+    make_leaf();
+    return;
+  }
+
+  Vec3r below_max = bounds.GetMax();
+  below_max[best_axis] = split;
+  Vec3r above_min = bounds.GetMin();
+  above_min[best_axis] = split;
+  Build(AABB{bounds.GetMin(), below_max}, below_ids, primitive_bounds,
+        depth - 1, bad_refines);
+  nodes_[node_index].InitInner(best_axis, split,
+                               static_cast<uint32_t>(nodes_.size()));
+  Build(AABB{above_min, bounds.GetMax()}, above_ids, primitive_bounds,
+        depth - 1, bad_refines);
+}
+
+
+bool
+KdTree::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
+{
+  if (!nodes_.size())
+    return false;
+
+  // clip the ray segment to the tree; written so that NaNs (0 * inf)
+  // leave the segment unchanged
+  const Vec3r origin = ray.GetOrigin();
+  const Vec3r dir = ray.GetDirection();
+  const Vec3r inv_dir = dir.cwiseInverse();
+  Real node_tmin = tmin;
+  Real node_tmax = tmax;
+  for (uint axis = 0; axis < 3; ++axis) {
+    Real t0 = (bbox_.GetMin()[axis] - origin[axis]) * inv_dir[axis];
+    Real t1 = (bbox_.GetMax()[axis] - origin[axis]) * inv_dir[axis];
+    if (t0 > t1)
+      std::swap(t0, t1);
+    node_tmin = t0 > node_tmin ? t0 : node_tmin;
+    node_tmax = t1 < node_tmax ? t1 : node_tmax;
+    if (node_tmax < node_tmin)
+      return false;
+  }
+
+  bool hit_something = false;
+  KdToDo to_do[kMaxDepth];
+  uint to_do_count = 0;
+  uint32_t current = 0;
+  const KdTreeNode *nodes = nodes_.data();
+  while (true) {
+    // nodes further along the ray cannot contain a closer hit, nor any
+    // hit past the end of the ray segment
+    if (tmax < node_tmin)
+      break;
+
+    const KdTreeNode &node = nodes[current];
+    if (!node.IsLeaf()) {
+      uint axis = node.GetSplitAxis();
+      Real split = node.split;
+      Real t_plane = (split - origin[axis]) * inv_dir[axis];
+
+      // the child on the origin's side of the plane comes first
+      bool below_first = origin[axis] < split ||
+        (origin[axis] == split && dir[axis] <= 0);
+      uint32_t first_child = current + 1;
+      uint32_t second_child = node.GetAboveChild();
+      if (!below_first)
+        std::swap(first_child, second_child);
+
+      if (t_plane > node_tmax || t_plane <= 0) {
+        current = first_child;
+      } else if (t_plane < node_tmin) {
+        current = second_child;
+      } else {
+        to_do[to_do_count++] = KdToDo{second_child, t_plane, node_tmax};
+        current = first_child;
+        node_tmax = t_plane;
+      }
+    } else {
+      const uint32_t *indices = primitive_indices_.data() + node.primitive_offset;
+      for (uint32_t i = 0; i < node.GetPrimitiveCount(); ++i) {
+        if (primitives_[indices[i]]->Hit(ray, tmin, tmax, hit_record)) {
+          hit_something = true;
+          tmax = hit_record.GetRayT();
+        }
+      }
+      if (!to_do_count)
+        break;
+      --to_do_count;
+      current = to_do[to_do_count].node;
+      node_tmin = to_do[to_do_count].tmin;
+      node_tmax = to_do[to_do_count].tmax;
+    }
+  }
+  return hit_something;
+}
+
+
+bool
+KdTree::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!nodes_.size())
+    return false;
+
+  // clip the ray segment to the tree; written so that NaNs (0 * inf)
+  // leave the segment unchanged
+  const Vec3r origin = ray.GetOrigin();
+  const Vec3r dir = ray.GetDirection();
+  const Vec3r inv_dir = dir.cwiseInverse();
+  Real node_tmin = tmin;
+  Real node_tmax = tmax;
+  for (uint axis = 0; axis < 3; ++axis) {
+    Real t0 = (bbox_.GetMin()[axis] - origin[axis]) * inv_dir[axis];
+    Real t1 = (bbox_.GetMax()[axis] - origin[axis]) * inv_dir[axis];
+    if (t0 > t1)
+      std::swap(t0, t1);
+    node_tmin = t0 > node_tmin ? t0 : node_tmin;
+    node_tmax = t1 < node_tmax ? t1 : node_tmax;
+    if (node_tmax < node_tmin)
+      return false;
+  }
+
+  KdToDo to_do[kMaxDepth];
+  uint to_do_count = 0;
+  uint32_t current = 0;
+  const KdTreeNode *nodes = nodes_.data();
+  while (true) {
+    // nodes past the end of the ray segment cannot block it
+    if (tmax < node_tmin)
+      break;
+
+    const KdTreeNode &node = nodes[current];
+    if (!node.IsLeaf()) {
+      uint axis = node.GetSplitAxis();
+      Real split = node.split;
+      Real t_plane = (split - origin[axis]) * inv_dir[axis];
+
+      // the child on the origin's side of the plane comes first
+      bool below_first = origin[axis] < split ||
+        (origin[axis] == split && dir[axis] <= 0);
+      uint32_t first_child = current + 1;
+      uint32_t second_child = node.GetAboveChild();
+      if (!below_first)
+        std::swap(first_child, second_child);
+
+      if (t_plane > node_tmax || t_plane <= 0) {
+        current = first_child;
+      } else if (t_plane < node_tmin) {
+        current = second_child;
+      } else {
+        to_do[to_do_count++] = KdToDo{second_child, t_plane, node_tmax};
+        current = first_child;
+        node_tmax = t_plane;
+      }
+    } else {
+      const uint32_t *indices = primitive_indices_.data() + node.primitive_offset;
+      for (uint32_t i = 0; i < node.GetPrimitiveCount(); ++i)
+        if (primitives_[indices[i]]->Occluded(ray, tmin, tmax))
+          return true;
+      if (!to_do_count)
+        break;
+      --to_do_count;
+      current = to_do[to_do_count].node;
+      node_tmin = to_do[to_do_count].tmin;
+      node_tmax = to_do[to_do_count].tmax;
+    }
+  }
+  return false;
+}
+
+
+bool
+KdTree::GetBoundingBox(AABB &bbox) const
+{
+  bbox = bbox_;
+  return nodes_.size() > 0;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
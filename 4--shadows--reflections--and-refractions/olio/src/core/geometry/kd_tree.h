@@ -0,0 +1,148 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       kd_tree.h
+//! \brief      KdTree class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "core/geometry/surface.h"
+#include "core/geometry/aabb.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class Ray;
+class HitRecord;
+
+//! \struct KdTreeNode
+//! \brief 8-byte kd-tree node stored in a depth-first ordered array.
+//! The child below the split plane is the node right after its parent;
+//! only the index of the child above the plane is stored.
+struct KdTreeNode {
+  union {
+    float split;                //!< inner: split plane position
+    uint32_t primitive_offset;  //!< leaf: first entry in the index array
+  };
+  uint32_t flags;  //!< low 2 bits: split axis or 3 for leaves; upper
+                   //!< 30 bits: leaf primitive count or above child
+
+  //! \brief Make the node a leaf
+  //! \param[in] offset First entry in the primitive index array
+  //! \param[in] count Number of primitives
+  inline void InitLeaf(uint32_t offset, uint32_t count) {
+    primitive_offset = offset;
+    flags = 3 | (count << 2);
+  }
+
+  //! \brief Make the node an inner node
+  //! \param[in] axis Split axis
+  //! \param[in] split_position Split plane position
+  //! \param[in] above_child Index of the child above the split plane
+  inline void InitInner(uint axis, float split_position, uint32_t above_child) {
+    split = split_position;
+    flags = axis | (above_child << 2);
+  }
+
+  //! \brief Whether the node is a leaf
+  //! \return True if the node references primitives
+  inline bool IsLeaf() const {return (flags & 3) == 3;}
+
+  //! \brief Get inner node's split axis
+  //! \return 0, 1, or 2 for x, y, or z
+  inline uint GetSplitAxis() const {return flags & 3;}
+
+  //! \brief Get leaf's primitive count
+  //! \return Number of primitives
+  inline uint32_t GetPrimitiveCount() const {return flags >> 2;}
+
+  //! \brief Get index of inner node's child above the split plane
+  //! \return Node index
+  inline uint32_t GetAboveChild() const {return flags >> 2;}
+};
+static_assert(sizeof(KdTreeNode) == 8, "KdTreeNode must be 8 bytes");
+
+
+//! \class KdTree
+//! \brief kd-tree over a set of surfaces with split planes chosen by
+//! the surface area heuristic (SAH)
+//! \details Surfaces straddling a split plane are referenced by both
+//! children. Traversal visits leaves front to back and stops as soon
+//! as the closest hit lies before the next leaf, or the next leaf lies
+//! beyond the ray segment's tmax (e.g., the light for shadow rays).
+class KdTree : public Surface {
+public:
+  OLIO_NODE(KdTree)
+
+  //! \brief Constructor; builds the tree over the input surfaces
+  //! \details Surfaces without a bounding box cannot be placed in
+  //!          the tree and are skipped with a warning.
+  //! \param[in] surfaces Surfaces to build the tree over
+  //! \param[in] name Node name
+  KdTree(const std::vector<Surface::Ptr> &surfaces,
+         const std::string &name=std::string());
+
+  //! \brief Check if ray intersects with surface
+  //! \details If the ray intersections the surface, the function
+  //!          should fill in the 'hit_record' (i.e., information
+  //!          about the hit point, normal, etc.)
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \param[out] hit_record Resulting hit record if ray intersected with surface
+  //! \return True if ray intersected with surface
+  bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
+
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Stops at the first primitive hit in the leaves pierced
+  //!          by the segment
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the tree contains at least one surface
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  static constexpr Real kIntersectionCost = 80;  //!< surface test cost
+  static constexpr Real kTraversalCost = 1;      //!< node visit cost
+  static constexpr Real kEmptyBonus = 0.5;       //!< SAH discount for empty children
+  static constexpr uint kMaxLeafSize = 1;        //!< leaf size that ends subdivision
+  static constexpr uint kMaxDepth = 64;          //!< max tree depth (traversal stack size)
+protected:
+  //! \brief Recursively build the subtree over the input surfaces,
+  //!        appending its nodes to 'nodes_' in depth-first order
+  //! \param[in] bounds Region covered by the subtree
+  //! \param[in] primitive_ids Surfaces (indices into 'primitives_')
+  //!            overlapping the region
+  //! \param[in] primitive_bounds Bounds of all surfaces
+  //! \param[in] depth Remaining depth budget
+  //! \param[in] bad_refines Number of ancestors whose split cost more
+  //!            than making a leaf
+  void Build(const AABB &bounds, const std::vector<uint32_t> &primitive_ids,
+             const std::vector<AABB> &primitive_bounds, uint depth,
+             uint bad_refines);
+
+  std::vector<KdTreeNode> nodes_;             //!< depth-first ordered nodes
+  std::vector<uint32_t> primitive_indices_;   //!< surfaces referenced by leaves
+  std::vector<Surface::Ptr> primitives_;      //!< surfaces in the tree
+  AABB bbox_;                                 //!< bounding box of all surfaces
+  Real split_padding_{0};  //!< surfaces this close to a plane go to both sides
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,176 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       packet_traversal.h
+//! \brief      Ray packet traversal of binary BVH nodes
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include "core/types.h"
+#include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/bvh.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+namespace detail {
+
+//! \brief Trace the active rays of a coherent packet through a
+//!        hierarchy of LinearBVHNodes, as BVH::HitPacket() describes
+//! \details Shared by the hierarchies over surfaces (BVH) and over
+//!          mesh triangles (TriangleMesh), which differ only in what
+//!          their leaves hold.
+//! \param[in] nodes Hierarchy nodes; node 0 is the root
+//! \param[in,out] packet Ray packet; must be coherent
+//! \param[in] active Lanes to intersect (bit i is lane i)
+//! \param[in,out] hit_records Hit records, one per lane of the packet
+//! \param[in] leaf_hit Called as leaf_hit(leaf, mask) to intersect the
+//!            lanes in 'mask' with a leaf; lowers the tmax of lanes
+//!            that hit, and returns them
+//! \param[in] subtree_hit Called as subtree_hit(node_index, lane) to
+//!            trace a single lane through a subtree into its hit
+//!            record; returns true on a hit
+//! \return Lanes that intersected the hierarchy
+template<typename LeafHit, typename SubtreeHit>
+uint64_t
+TraversePacket(const LinearBVHNode *nodes, RayPacket &packet,
+               uint64_t active, HitRecord *hit_records,
+               LeafHit leaf_hit, SubtreeHit subtree_hit)
+{
+  // bounds of the active rays' origins and reciprocal directions
+  Real origin_lo[3], origin_hi[3], inv_dir_lo[3], inv_dir_hi[3];
+  uint32_t active_count = 0;
+  for (int axis = 0; axis < 3; ++axis) {
+    origin_lo[axis] = inv_dir_lo[axis] = kInfinity;
+    origin_hi[axis] = inv_dir_hi[axis] = -kInfinity;
+  }
+  Real packet_tmax = -kInfinity;
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    if (!(active & (uint64_t(1) << lane)))
+      continue;
+    ++active_count;
+    for (int axis = 0; axis < 3; ++axis) {
+      origin_lo[axis] = std::min(origin_lo[axis], packet.origin[axis][lane]);
+      origin_hi[axis] = std::max(origin_hi[axis], packet.origin[axis][lane]);
+      inv_dir_lo[axis] = std::min(inv_dir_lo[axis], packet.inv_dir[axis][lane]);
+      inv_dir_hi[axis] = std::max(inv_dir_hi[axis], packet.inv_dir[axis][lane]);
+    }
+    packet_tmax = std::max(packet_tmax, packet.tmax[lane]);
+  }
+  const int dir_is_neg[3] = {packet.dir[0][0] < 0, packet.dir[1][0] < 0,
+                             packet.dir[2][0] < 0};
+  const uint32_t min_packet_count =
+    std::max(active_count / BVH::kPacketDivergence, 1u);
+
+  // conservative test of the whole packet: t = (bound - origin) *
+  // inv_dir is bilinear, so over the packet it lies between the
+  // values at the corners of the origin and inv_dir intervals
+  auto packet_misses = [&](const LinearBVHNode &node) {
+    Real tnear = packet.tmin;
+    Real tfar = packet_tmax;
+    for (int axis = 0; axis < 3; ++axis) {
+      Real near_bound = dir_is_neg[axis] ? node.bbox_max[axis] : node.bbox_min[axis];
+      Real far_bound = dir_is_neg[axis] ? node.bbox_min[axis] : node.bbox_max[axis];
+      Real near_lo = near_bound - origin_hi[axis];
+      Real near_hi = near_bound - origin_lo[axis];
+      Real far_lo = far_bound - origin_hi[axis];
+      Real far_hi = far_bound - origin_lo[axis];
+      tnear = std::max(tnear, std::min(std::min(near_lo * inv_dir_lo[axis],
+                                                near_lo * inv_dir_hi[axis]),
+                                       std::min(near_hi * inv_dir_lo[axis],
+                                                near_hi * inv_dir_hi[axis])));
+      tfar = std::min(tfar, std::max(std::max(far_lo * inv_dir_lo[axis],
+                                              far_lo * inv_dir_hi[axis]),
+                                     std::max(far_hi * inv_dir_lo[axis],
+                                              far_hi * inv_dir_hi[axis])));
+    }
+    return tfar < tnear;
+  };
+
+  // per-ray slab test, as LinearBVHNode::Intersect(), over all lanes
+  auto enter_mask = [&](const LinearBVHNode &node, uint64_t mask) {
+    Real near_bound[3], far_bound[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      near_bound[axis] = dir_is_neg[axis] ? node.bbox_max[axis] : node.bbox_min[axis];
+      far_bound[axis] = dir_is_neg[axis] ? node.bbox_min[axis] : node.bbox_max[axis];
+    }
+    uint8_t enters[RayPacket::kMaxSize];
+    for (uint32_t lane = 0; lane < packet.size; ++lane) {
+      Real tmin = packet.tmin;
+      Real tmax = packet.tmax[lane];
+      for (int axis = 0; axis < 3; ++axis) {
+        Real t0 = (near_bound[axis] - packet.origin[axis][lane]) *
+          packet.inv_dir[axis][lane];
+        Real t1 = (far_bound[axis] - packet.origin[axis][lane]) *
+          packet.inv_dir[axis][lane];
+        tmin = t0 > tmin ? t0 : tmin;
+        tmax = t1 < tmax ? t1 : tmax;
+      }
+      enters[lane] = !(tmax < tmin);
+    }
+    uint64_t entered = 0;
+    for (uint32_t lane = 0; lane < packet.size; ++lane)
+      entered |= static_cast<uint64_t>(enters[lane]) << lane;
+    return entered & mask;
+  };
+
+  struct StackEntry {
+    uint32_t node;  // node to visit
+    uint64_t mask;  // rays that entered its parent
+  };
+  StackEntry to_visit[BVH::kMaxDepth];
+  uint to_visit_count = 0;
+  uint64_t hits = 0;
+  StackEntry current{0, active};
+  while (true) {
+    const LinearBVHNode &node = nodes[current.node];
+    uint64_t mask = packet_misses(node) ? 0 : enter_mask(node, current.mask);
+    uint32_t mask_count = 0;
+    for (uint64_t bits = mask; bits; bits &= bits - 1)
+      ++mask_count;
+    if (mask_count && mask_count < min_packet_count) {
+      // too few rays left to share the traversal
+      for (uint32_t lane = 0; lane < packet.size; ++lane) {
+        if (!(mask & (uint64_t(1) << lane)))
+          continue;
+        if (subtree_hit(current.node, lane)) {
+          packet.tmax[lane] = hit_records[lane].GetRayT();
+          hits |= uint64_t(1) << lane;
+        }
+      }
+    } else if (mask_count && node.IsLeaf()) {
+      hits |= leaf_hit(node, mask);
+      packet_tmax = -kInfinity;
+      for (uint32_t lane = 0; lane < packet.size; ++lane)
+        if (active & (uint64_t(1) << lane))
+          packet_tmax = std::max(packet_tmax, packet.tmax[lane]);
+    } else if (mask_count) {
+      // visit the child on the near side of the split first
+      uint32_t near_child = node.offset;
+      uint32_t far_child = node.offset + 1;
+      if (dir_is_neg[node.axis])
+        std::swap(near_child, far_child);
+      to_visit[to_visit_count++] = StackEntry{far_child, mask};
+      current = StackEntry{near_child, mask};
+      continue;
+    }
+    if (!to_visit_count)
+      break;
+    current = to_visit[--to_visit_count];
+  }
+  return hits;
+}
+
+}  // namespace detail
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -10,11 +10,32 @@
 //! \author     Hadi Fadaifard, 2022
 
 #include "core/geometry/sphere.h"
+#include <cmath>
 #include <spdlog/spdlog.h>
 #include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/aabb.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+namespace {
+
+//! \brief Dot product summed left to right
+//! \details Eigen's summation order depends on the vector
+//!          instruction set, and HitPacket() can't use Eigen across
+//!          lanes; Hit() and HitPacket() both use this order so that
+//!          they find bit-identical roots
+//! \return ax * bx + ay * by + az * bz
+inline Real
+Dot(Real ax, Real ay, Real az, Real bx, Real by, Real bz)
+{
+  return ax * bx + ay * by + az * bz;
+}
+
+}  // namespace
+
 
 Sphere::Sphere(const std::string &name) :
   Surface{}
@@ -49,11 +70,11 @@ Sphere::SetRadius(Real radius)
 bool
 Sphere::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
 {
-  auto p0 = ray.GetOrigin() - center_;
-  auto v = ray.GetDirection();
-  auto a = v.squaredNorm();
-  auto b = 2 * p0.dot(v);
-  auto c = p0.squaredNorm() - radius_ * radius_;
+  Vec3r p0 = ray.GetOrigin() - center_;
+  Vec3r v = ray.GetDirection();
+  auto a = Dot(v[0], v[1], v[2], v[0], v[1], v[2]);
+  auto b = 2 * Dot(p0[0], p0[1], p0[2], v[0], v[1], v[2]);
+  auto c = Dot(p0[0], p0[1], p0[2], p0[0], p0[1], p0[2]) - radius_ * radius_;
 
   // solve quadratic equation to find t
   auto a2 = 2 * a;
@@ -67,15 +88,91 @@ Sphere::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
   if (t < tmin || t > tmax)
     return false;
 
-  // fill hit record
-  const Vec3r &hit_point = ray.At(t);
-  hit_record.SetRayT(t);
+  hit_record.SetHit(t, this);
+  return true;
+}
+
+
+void
+Sphere::ComputeHitAttributes(const Ray &ray, HitRecord &hit_record) const
+{
+  const Vec3r &hit_point = ray.At(hit_record.GetRayT());
   hit_record.SetPoint(hit_point);
   hit_record.SetNormal(ray, (hit_point - center_).normalized());
-  hit_record.SetSurface(GetPtr());
+}
+
+
+bool
+Sphere::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  Vec3r p0 = ray.GetOrigin() - center_;
+  Vec3r v = ray.GetDirection();
+  auto a = Dot(v[0], v[1], v[2], v[0], v[1], v[2]);
+  auto b = 2 * Dot(p0[0], p0[1], p0[2], v[0], v[1], v[2]);
+  auto c = Dot(p0[0], p0[1], p0[2], p0[0], p0[1], p0[2]) - radius_ * radius_;
+
+  // same roots as Hit(), so both agree on which segments are blocked
+  auto a2 = 2 * a;
+  auto discriminant = b * b - 2 * a2 * c;
+  if (discriminant < 0)
+    return false;
+  auto s = static_cast<Real>(sqrt(discriminant));
+  auto t = (-b - s) / a2;
+  if (t < tmin)
+    t = (-b + s) / a2;
+  return t >= tmin && t <= tmax;
+}
+
+
+uint64_t
+Sphere::HitPacket(RayPacket &packet, uint64_t active, HitRecord *hit_records)
+{
+  // solve all lanes first, in the same order of operations as Hit(),
+  // then record the lanes that hit
+  Real ts[RayPacket::kMaxSize];
+  uint8_t is_hit[RayPacket::kMaxSize];
+  const Real tmin = packet.tmin;
+  const Real radius2 = radius_ * radius_;
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    Real p0x = packet.origin[0][lane] - center_[0];
+    Real p0y = packet.origin[1][lane] - center_[1];
+    Real p0z = packet.origin[2][lane] - center_[2];
+    Real vx = packet.dir[0][lane];
+    Real vy = packet.dir[1][lane];
+    Real vz = packet.dir[2][lane];
+    Real a = Dot(vx, vy, vz, vx, vy, vz);
+    Real b = 2 * Dot(p0x, p0y, p0z, vx, vy, vz);
+    Real c = Dot(p0x, p0y, p0z, p0x, p0y, p0z) - radius2;
+    Real a2 = 2 * a;
+    Real discriminant = b * b - 2 * a2 * c;
+    Real s = std::sqrt(discriminant < 0 ? 0 : discriminant);
+    Real t = (-b - s) / a2;
+    t = t < tmin ? (-b + s) / a2 : t;
+    ts[lane] = t;
+    is_hit[lane] = !(discriminant < 0) && !(t < tmin) && !(t > packet.tmax[lane]);
+  }
+
+  uint64_t hits = 0;
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    if (!is_hit[lane] || !(active & (uint64_t(1) << lane)))
+      continue;
+    hit_records[lane].SetHit(ts[lane], this);
+    packet.tmax[lane] = ts[lane];
+    hits |= uint64_t(1) << lane;
+  }
+  return hits;
+}
+
 
+bool
+Sphere::GetBoundingBox(AABB &bbox) const
+{
+  Real r = std::fabs(radius_);
+  Vec3r extent{r, r, r};
+  bbox = AABB{center_ - extent, center_ + extent};
   return true;
 }
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -18,6 +18,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 //! \class Sphere
 //! \brief Sphere class
@@ -48,6 +49,36 @@ public:
   bool Hit(const Ray &ray, Real tmin, Real tmax,
            HitRecord &hit_record) override;
 
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Solves for t only; no hit record is filled in
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Intersect the rays of a packet with the surface
+  //! \details Solves the quadratic of every lane in one SIMD
+  //!          friendly loop, with the same operations as Hit()
+  //! \param[in,out] packet Ray packet
+  //! \param[in] active Lanes to intersect (bit i is lane i)
+  //! \param[in,out] hit_records Hit records, one per lane of the packet
+  //! \return Lanes that intersected the surface
+  uint64_t HitPacket(RayPacket &packet, uint64_t active,
+                     HitRecord *hit_records) override;
+
+  //! \brief Compute point and normal of a hit recorded by Hit()
+  //! \details The normal points from the center to the hit point
+  //! \param[in] ray Ray that hit the surface
+  //! \param[in,out] hit_record Hit record filled in by Hit()
+  void ComputeHitAttributes(const Ray &ray,
+                            HitRecord &hit_record) const override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the surface is bounded; false otherwise
+  bool GetBoundingBox(AABB &bbox) const override;
+
   //! \brief Set sphere position
   //! \param[in] center Sphere center/position
   void SetCenter(const Vec3r &center);
@@ -69,5 +100,6 @@ protected:
 private:
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -11,10 +11,14 @@
 
 #include "core/geometry/surface.h"
 #include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/aabb.h"
 #include "core/material/material.h"
+#include "core/material/material_table.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 Surface::Surface(const std::string &name) :
   Node{name}
@@ -27,6 +31,7 @@ void
 Surface::SetMaterial(std::shared_ptr<Material> material)
 {
   material_ = material;
+  material_id_ = MaterialTable::kNoMaterial;
 }
 
 
@@ -43,5 +48,55 @@ Surface::Hit(const Ray &, Real, Real, HitRecord &)
   return false;
 }
 
+
+bool
+Surface::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  HitRecord hit_record;
+  return Hit(ray, tmin, tmax, hit_record);
+}
+
+
+uint64_t
+Surface::HitPacket(RayPacket &packet, uint64_t active, HitRecord *hit_records)
+{
+  uint64_t hits = 0;
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    if (!(active & (uint64_t(1) << lane)))
+      continue;
+    if (Hit(packet.rays[lane], packet.tmin, packet.tmax[lane],
+            hit_records[lane])) {
+      packet.tmax[lane] = hit_records[lane].GetRayT();
+      hits |= uint64_t(1) << lane;
+    }
+  }
+  return hits;
+}
+
+
+void
+Surface::ComputeHitAttributes(const Ray &ray, HitRecord &hit_record) const
+{
+  hit_record.SetPoint(ray.At(hit_record.GetRayT()));
+}
+
+
+bool
+Surface::GetBoundingBox(AABB &) const
+{
+  return false;
+}
+
+
+bool
+Surface::GetClippedBoundingBox(const AABB &clip_box, AABB &bbox) const
+{
+  if (!GetBoundingBox(bbox))
+    return false;
+  bbox.Intersect(clip_box);
+  return !bbox.IsEmpty();
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -18,10 +19,13 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class Ray;
 class HitRecord;
+struct RayPacket;
 class Material;
+class AABB;
 
 //! \class Surface
 //! \brief Surface class
@@ -43,17 +47,78 @@ public:
   virtual bool Hit(const Ray &ray, Real tmin, Real tmax,
                    HitRecord &hit_record);
 
-  //! \brief Set surface's material
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Unlike Hit(), the function may return at the first
+  //!          intersection it finds, in any order, and fills in no hit
+  //!          record; used for shadow rays. The default calls Hit().
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  virtual bool Occluded(const Ray &ray, Real tmin, Real tmax);
+
+  //! \brief Intersect the rays of a packet with the surface
+  //! \details Works like Hit() for every lane in 'active', with t in
+  //!          [packet.tmin, packet.tmax[lane]] and the lane's hit
+  //!          record; lanes that hit have their tmax lowered to the
+  //!          hit's t. The default traces the lanes one at a time.
+  //! \param[in,out] packet Ray packet
+  //! \param[in] active Lanes to intersect (bit i is lane i)
+  //! \param[in,out] hit_records Hit records, one per lane of the packet
+  //! \return Lanes that intersected the surface
+  virtual uint64_t HitPacket(RayPacket &packet, uint64_t active,
+                             HitRecord *hit_records);
+
+  //! \brief Compute point and normal of a hit recorded by Hit()
+  //! \details Hit() only records t, the surface, and the primitive
+  //!          and UV coordinates of the hit (HitRecord::SetHit()); the
+  //!          remaining attributes are computed once, for the closest
+  //!          hit. The default sets the point only.
+  //! \param[in] ray Ray that hit the surface
+  //! \param[in,out] hit_record Hit record filled in by Hit()
+  virtual void ComputeHitAttributes(const Ray &ray,
+                                    HitRecord &hit_record) const;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the surface is bounded; false otherwise
+  virtual bool GetBoundingBox(AABB &bbox) const;
+
+  //! \brief Get the bounding box of the part of the surface inside
+  //!        the input box
+  //! \details The default intersects the surface's bounding box with
+  //!          'clip_box'; surfaces can return tighter bounds
+  //! \param[in] clip_box Box to clip the surface against
+  //! \param[out] bbox Bounding box of the clipped surface
+  //! \return True if part of the surface lies inside 'clip_box'
+  virtual bool GetClippedBoundingBox(const AABB &clip_box, AABB &bbox) const;
+
+  //! \brief Set surface's material. Clears the material id, so that
+  //!        shading uses the new material until SetMaterialId() is
+  //!        called with its id.
   //! \param[in] material Material to set
   virtual void SetMaterial(std::shared_ptr<Material> material);
 
   //! \brief Get surface's material
   //! \return Node's material
   virtual std::shared_ptr<Material> GetMaterial();
+
+  //! \brief Set the id of the surface's material in the scene's
+  //!        MaterialTable, used for shading
+  //! \param[in] material_id Material id
+  inline void SetMaterialId(uint32_t material_id) {material_id_ = material_id;}
+
+  //! \brief Get the id of the surface's material in the scene's
+  //!        MaterialTable
+  //! \return Material id; 0 (MaterialTable::kNoMaterial) if unset, in
+  //!         which case shading uses GetMaterial()
+  inline uint32_t GetMaterialId() const {return material_id_;}
 protected:
   std::shared_ptr<Material> material_; //!< node material
+  uint32_t material_id_{0};            //!< shading material id
 private:
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
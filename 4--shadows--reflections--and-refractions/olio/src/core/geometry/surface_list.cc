@@ -12,9 +12,11 @@
 #include "core/geometry/surface_list.h"
 #include <spdlog/spdlog.h>
 #include "core/ray.h"
+#include "core/geometry/aabb.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 
@@ -30,25 +32,44 @@ SurfaceList::SurfaceList(const vector<Surface::Ptr> &surfaces,
 bool
 SurfaceList::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
 {
+  // surfaces only write to the record when they find a closer hit
   bool hit_something = false;
-  for (size_t i = 0; i < surfaces_.size(); ++i) {
-    auto surface = surfaces_[i];
-    if (!surface)
+  for (auto &surface : surfaces_) {
+    if (!surface || !surface->Hit(ray, tmin, tmax, hit_record))
       continue;
-
-    // check for hit
-    HitRecord current_hit;
-    if (!surface->Hit(ray, tmin, tmax, current_hit))
-      continue;
-
-    // update closest hit record
-    hit_record = current_hit;
-    tmax = current_hit.GetRayT();
+    tmax = hit_record.GetRayT();
     hit_something = true;
   }
 
   return hit_something;
 }
 
+
+bool
+SurfaceList::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  for (auto &surface : surfaces_)
+    if (surface && surface->Occluded(ray, tmin, tmax))
+      return true;
+  return false;
+}
+
+
+bool
+SurfaceList::GetBoundingBox(AABB &bbox) const
+{
+  bool bounded = false;
+  bbox = AABB{};
+  for (auto &surface : surfaces_) {
+    AABB surface_bbox;
+    if (!surface || !surface->GetBoundingBox(surface_bbox))
+      continue;
+    bbox.Extend(surface_bbox);
+    bounded = true;
+  }
+  return bounded;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
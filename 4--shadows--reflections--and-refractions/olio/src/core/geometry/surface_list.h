@@ -18,6 +18,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class Ray;
 class HitRecord;
@@ -42,10 +43,30 @@ public:
   //! \return True if ray intersected with surface
   bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
 
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Stops at the first surface that is hit
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \details The box is the union of the boxes of all bounded
+  //!          surfaces in the list
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if at least one surface in the list is bounded
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  //! \brief Get the surfaces in the list
+  //! \return Surfaces in the list
+  const std::vector<Surface::Ptr>& GetSurfaces() const {return surfaces_;}
+
 protected:
   std::vector<Surface::Ptr> surfaces_;
 private:
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -10,11 +10,15 @@
 //! \author     Hadi Fadaifard, 2022
 
 #include "core/geometry/triangle.h"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 #include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/aabb.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 Triangle::Triangle(const std::string &name) :
   Surface{}
@@ -24,10 +28,13 @@ Triangle::Triangle(const std::string &name) :
 
 
 Triangle::Triangle(const std::vector<Vec3r> &points, const std::string &name) :
-  Surface{},
-  points_{points}
+  Surface{}
 {
   name_ = name.size() ? name : "Triangle";
+  if (points.size() >= 3) {
+    std::copy(points.begin(), points.begin() + 3, points_);
+    has_points_ = true;
+  }
   ComputeNormal();
 }
 
@@ -36,10 +43,11 @@ bool
 Triangle::ComputeNormal()
 {
   normal_ = Vec3r{0, 0, 0};
-  if (points_.size() < 3)
+  record_ = TriangleRecord{};
+  if (!has_points_)
     return false;
-  normal_ = (points_[1] - points_[0]).cross(points_[2] - points_[0]);
-  normal_.normalize();
+  record_ = TriangleRecord{points_[0], points_[1], points_[2]};
+  normal_ = record_.GetNormal();
   return true;
 }
 
@@ -48,15 +56,24 @@ bool
 Triangle::RayTriangleHit(const Vec3r &p0, const Vec3r &p1, const Vec3r &p2,
                          const Ray &ray, Real tmin, Real tmax,
                          Real &ray_t, Vec2r &uv)
+{
+  return RayTriangleHit(TriangleRecord{p0, p1, p2}, ray, tmin, tmax, ray_t, uv);
+}
+
+
+bool
+Triangle::RayTriangleHit(const TriangleRecord &triangle, const Ray &ray,
+                         Real tmin, Real tmax, Real &ray_t, Vec2r &uv)
 {
   const Vec3r &ray_dir = ray.GetDirection();
   const Vec3r &ray_origin = ray.GetOrigin();
-  Real a = p0[0] - p1[0];
-  Real b = p0[1] - p1[1];
-  Real c = p0[2] - p1[2];
-  Real d = p0[0] - p2[0];
-  Real e = p0[1] - p2[1];
-  Real f = p0[2] - p2[2];
+  const Vec3r &p0 = triangle.p0;
+  Real a = triangle.edge1[0];
+  Real b = triangle.edge1[1];
+  Real c = triangle.edge1[2];
+  Real d = triangle.edge2[0];
+  Real e = triangle.edge2[1];
+  Real f = triangle.edge2[2];
   Real g = ray_dir[0];
   Real h = ray_dir[1];
   Real i = ray_dir[2];
@@ -98,24 +115,156 @@ Triangle::RayTriangleHit(const Vec3r &p0, const Vec3r &p1, const Vec3r &p2,
 bool
 Triangle::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
 {
-  if (points_.size() < 3)
+  if (!has_points_)
     return false;
 
   Real ray_t{0};
   Vec2r uv;
-  if (!RayTriangleHit(points_[0], points_[1], points_[2], ray,
-                      tmin, tmax, ray_t, uv))
+  if (!RayTriangleHit(record_, ray, tmin, tmax, ray_t, uv))
     return false;
+  hit_record.SetHit(ray_t, this, 0, uv);
+  return true;
+}
 
-  // fill hit_record
-  const Vec3r &hit_point = ray.At(ray_t);
-  hit_record.SetRayT(ray_t);
-  hit_record.SetPoint(hit_point);
+
+void
+Triangle::ComputeHitAttributes(const Ray &ray, HitRecord &hit_record) const
+{
+  hit_record.SetPoint(ray.At(hit_record.GetRayT()));
   hit_record.SetNormal(ray, normal_);
-  hit_record.SetSurface(GetPtr());
+}
+
+
+bool
+Triangle::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!has_points_)
+    return false;
+
+  Real ray_t{0};
+  Vec2r uv;
+  return RayTriangleHit(record_, ray, tmin, tmax, ray_t, uv);
+}
+
+
+uint64_t
+Triangle::HitPacket(RayPacket &packet, uint64_t active, HitRecord *hit_records)
+{
+  if (!has_points_)
+    return 0;
+
+  // test all lanes first, in the same order of operations as
+  // RayTriangleHit(), then record the lanes that hit
+  Real ts[RayPacket::kMaxSize], betas[RayPacket::kMaxSize],
+    gammas[RayPacket::kMaxSize];
+  uint8_t is_hit[RayPacket::kMaxSize];
+  const Real tmin = packet.tmin;
+  const Real a = record_.edge1[0];
+  const Real b = record_.edge1[1];
+  const Real c = record_.edge1[2];
+  const Real d = record_.edge2[0];
+  const Real e = record_.edge2[1];
+  const Real f = record_.edge2[2];
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    Real g = packet.dir[0][lane];
+    Real h = packet.dir[1][lane];
+    Real i = packet.dir[2][lane];
+    Real j = record_.p0[0] - packet.origin[0][lane];
+    Real k = record_.p0[1] - packet.origin[1][lane];
+    Real l = record_.p0[2] - packet.origin[2][lane];
+    Real ei_minus_hf = e * i - h * f;
+    Real gf_minus_di = g * f - d * i;
+    Real dh_minus_eg = d * h - e * g;
+    Real ak_minus_jb = a * k - j * b;
+    Real jc_minus_al = j * c - a * l;
+    Real bl_minus_kc = b * l - k * c;
+    Real M = a * ei_minus_hf + b * gf_minus_di + c * dh_minus_eg;
+    Real ray_t = -(f * ak_minus_jb + e * jc_minus_al + d * bl_minus_kc) / M;
+    Real gamma = (i * ak_minus_jb + h * jc_minus_al + g * bl_minus_kc) / M;
+    Real beta = (j * ei_minus_hf + k * gf_minus_di + l * dh_minus_eg) / M;
+    ts[lane] = ray_t;
+    betas[lane] = beta;
+    gammas[lane] = gamma;
+    is_hit[lane] = !(std::fabs(M) < kEpsilon) &&
+      !(ray_t < tmin || ray_t > packet.tmax[lane]) &&
+      !(gamma < 0 || gamma > 1) && !(beta < 0 || beta > 1 - gamma);
+  }
+
+  uint64_t hits = 0;
+  for (uint32_t lane = 0; lane < packet.size; ++lane) {
+    if (!is_hit[lane] || !(active & (uint64_t(1) << lane)))
+      continue;
+    hit_records[lane].SetHit(ts[lane], this, 0, Vec2r{betas[lane], gammas[lane]});
+    packet.tmax[lane] = ts[lane];
+    hits |= uint64_t(1) << lane;
+  }
+  return hits;
+}
+
+
+bool
+Triangle::GetBoundingBox(AABB &bbox) const
+{
+  if (!has_points_)
+    return false;
+  bbox = AABB{};
+  for (size_t i = 0; i < 3; ++i)
+    bbox.Extend(points_[i]);
   return true;
 }
 
+
+bool
+Triangle::GetClippedBoundingBox(const AABB &clip_box, AABB &bbox) const
+{
+  if (!has_points_)
+    return false;
+
+  // Sutherland-Hodgman: each of the six planes adds at most one vertex
+  Vec3r polygons[2][9];
+  uint counts[2] = {3, 0};
+  for (uint i = 0; i < 3; ++i)
+    polygons[0][i] = points_[i];
+  uint current = 0;
+  for (uint plane = 0; plane < 6 && counts[current]; ++plane) {
+    uint axis = plane / 2;
+    bool is_max = plane % 2;
+    Real bound = is_max ? clip_box.GetMax()[axis] : clip_box.GetMin()[axis];
+    auto inside = [&](const Vec3r &point) -> bool {
+      return is_max ? point[axis] <= bound : point[axis] >= bound;
+    };
+    const Vec3r *input = polygons[current];
+    Vec3r *output = polygons[1 - current];
+    uint input_count = counts[current];
+    uint output_count = 0;
+    for (uint i = 0; i < input_count; ++i) {
+      const Vec3r &a = input[i];
+      const Vec3r &b = input[(i + 1) % input_count];
+      bool a_inside = inside(a);
+      if (a_inside)
+        output[output_count++] = a;
+      if (a_inside != inside(b)) {
+        Real t = (bound - a[axis]) / (b[axis] - a[axis]);
+        Vec3r point = a + t * (b - a);
+        point[axis] = bound;
+        output[output_count++] = point;
+      }
+    }
+    counts[1 - current] = output_count;
+    current = 1 - current;
+  }
+  if (!counts[current])
+    return false;
+
+  // keep rounding in the intersection points inside the box
+  bbox = AABB{};
+  for (uint i = 0; i < counts[current]; ++i)
+    bbox.Extend(polygons[current][i]);
+  bbox.Intersect(clip_box);
+  return !bbox.IsEmpty();
+}
+
+
 bool
 Triangle::SetPoints(const std::vector<Vec3r> &points)
 {
@@ -128,10 +277,8 @@ Triangle::SetPoints(const std::vector<Vec3r> &points)
     spdlog::warn("Triangle::SetPoints: number of points > 3 -- "
                  "using first three points");
   }
-  points_.reserve(3);
-  points_.push_back(points[0]);
-  points_.push_back(points[1]);
-  points_.push_back(points[2]);
+  std::copy(points.begin(), points.begin() + 3, points_);
+  has_points_ = true;
   ComputeNormal();
   return true;
 }
@@ -140,9 +287,14 @@ Triangle::SetPoints(const std::vector<Vec3r> &points)
 bool
 Triangle::GetPoints(std::vector<Vec3r> &points) const
 {
-  points = points_;
-  return points_.size() == 3;
+  if (!has_points_) {
+    points.clear();
+    return false;
+  }
+  points.assign(points_, points_ + 3);
+  return true;
 }
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
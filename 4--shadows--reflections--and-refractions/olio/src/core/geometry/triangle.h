@@ -18,6 +18,32 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \struct TriangleRecord
+//! \brief Intersection-ready form of a triangle: its first point and
+//! the two edge vectors that Triangle::RayTriangleHit would otherwise
+//! recompute for every ray. Intersecting a record gives bit-identical
+//! results to intersecting the three points.
+struct TriangleRecord {
+  TriangleRecord() = default;
+
+  //! \brief Constructor
+  //! \param[in] p0 first triangle point
+  //! \param[in] p1 second triangle point
+  //! \param[in] p2 third triangle point
+  TriangleRecord(const Vec3r &p0, const Vec3r &p1, const Vec3r &p2) :
+    p0{p0}, edge1{p0 - p1}, edge2{p0 - p2} {}
+
+  //! \brief Get the unit normal, oriented as (p1 - p0) x (p2 - p0)
+  //! \return Triangle normal
+  Vec3r GetNormal() const {return edge1.cross(edge2).normalized();}
+
+  Vec3r p0{0, 0, 0};     //!< first triangle point
+  Vec3r edge1{0, 0, 0};  //!< p0 - p1
+  Vec3r edge2{0, 0, 0};  //!< p0 - p2
+};
+
 
 //! \class Triangle
 //! \brief Triangle class
@@ -56,6 +82,20 @@ public:
                              const Ray &ray, Real tmin, Real tmax,
                              Real &ray_t, Vec2r &uv);
 
+  //! \brief Static function to compute ray-triangle intersection
+  //!        between input ray and a precomputed triangle record
+  //! \param[in] triangle Triangle record
+  //! \param[in] ray Input ray
+  //! \param[in] tmin Minimum acceptable value for ray_t
+  //! \param[in] tmax Maximum acceptable value for ray_t
+  //! \param[out] In case of intersection, value of t for hit point p:
+  //!             p = ray_origin + t * ray_dir
+  //! \param[out] uv UV coordinates of the hit point inside the
+  //!             triangle, as above
+  //! \return True on success
+  static bool RayTriangleHit(const TriangleRecord &triangle, const Ray &ray,
+                             Real tmin, Real tmax, Real &ray_t, Vec2r &uv);
+
   //! \brief Check if ray intersects with surface
   //! \details If the ray intersections the surface, the function
   //!          should fill in the 'hit_record' (i.e., information
@@ -68,6 +108,46 @@ public:
   bool Hit(const Ray &ray, Real tmin, Real tmax,
            HitRecord &hit_record) override;
 
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Computes t and the barycentrics only; no hit record is
+  //!          filled in
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Intersect the rays of a packet with the surface
+  //! \details Runs the intersection test of every lane in one
+  //!          SIMD friendly loop, with the same operations as
+  //!          RayTriangleHit()
+  //! \param[in,out] packet Ray packet
+  //! \param[in] active Lanes to intersect (bit i is lane i)
+  //! \param[in,out] hit_records Hit records, one per lane of the packet
+  //! \return Lanes that intersected the surface
+  uint64_t HitPacket(RayPacket &packet, uint64_t active,
+                     HitRecord *hit_records) override;
+
+  //! \brief Compute point and normal of a hit recorded by Hit()
+  //! \details Uses the precomputed triangle normal
+  //! \param[in] ray Ray that hit the surface
+  //! \param[in,out] hit_record Hit record filled in by Hit()
+  void ComputeHitAttributes(const Ray &ray,
+                            HitRecord &hit_record) const override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the surface is bounded; false otherwise
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  //! \brief Get the bounding box of the part of the triangle inside
+  //!        the input box
+  //! \details Clips the triangle polygon against the box's six planes
+  //! \param[in] clip_box Box to clip the triangle against
+  //! \param[out] bbox Bounding box of the clipped triangle
+  //! \return True if part of the triangle lies inside 'clip_box'
+  bool GetClippedBoundingBox(const AABB &clip_box, AABB &bbox) const override;
+
   //! \brief Set triangle points
   //! \details The function returns false if the number of input
   //! points is fewer than 3. The function should also compute/update
@@ -85,14 +165,18 @@ public:
   //! \return Triangle normal
   Vec3r GetNormal() const {return normal_;}
 protected:
-  //! \brief Compute/update triangle normal
+  //! \brief Compute/update triangle normal and intersection record
   //! \return True if triangle has three points
   bool ComputeNormal();
 
-  std::vector<Vec3r> points_;  //!< triangle points
+  Vec3r points_[3];            //!< triangle points; stored in place so
+                               //!< that copies need no heap allocation
+  bool has_points_{false};     //!< whether 'points_' was set
   Vec3r normal_{0, 0, 0};      //!< triangle normal
+  TriangleRecord record_;      //!< points_ prepared for intersection
 private:
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -0,0 +1,277 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       triangle_mesh.cc
+//! \brief      TriangleMesh class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/triangle_mesh.h"
+#include <utility>
+#include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/packet_traversal.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+TriangleMesh::TriangleMesh(const vector<Vec3r> &vertices,
+                           const vector<uint32_t> &indices,
+                           const std::string &name) :
+  Surface{},
+  vertices_{vertices}
+{
+  name_ = name.size() ? name : "TriangleMesh";
+
+  // keep triangles whose indices are valid
+  indices_.reserve(indices.size() - indices.size() % 3);
+  size_t skipped = 0;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    if (indices[i] >= vertices_.size() || indices[i + 1] >= vertices_.size() ||
+        indices[i + 2] >= vertices_.size()) {
+      ++skipped;
+      continue;
+    }
+    indices_.insert(indices_.end(), indices.begin() + static_cast<ptrdiff_t>(i),
+                    indices.begin() + static_cast<ptrdiff_t>(i + 3));
+  }
+  if (skipped)
+    spdlog::warn("{}: skipping {} triangle(s) with invalid vertex indices",
+                 name_, skipped);
+  if (indices.size() % 3)
+    spdlog::warn("{}: index count is not a multiple of 3", name_);
+
+  // build the hierarchy, then store triangles in leaf order
+  size_t triangle_count = GetTriangleCount();
+  vector<AABB> bounds(triangle_count);
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, triangle_count),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i) {
+        Vec3r points[3];
+        GetTrianglePoints(i, points);
+        for (const auto &point : points)
+          bounds[i].Extend(point);
+      }
+    });
+  for (const auto &triangle_bbox : bounds)
+    bbox_.Extend(triangle_bbox);
+  vector<uint32_t> order;
+  BVH::BuildNodes(bounds, nodes_, order);
+  vector<uint32_t> ordered_indices(indices_.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, triangle_count),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i)
+        for (size_t j = 0; j < 3; ++j)
+          ordered_indices[3 * i + j] = indices_[3 * order[i] + j];
+    });
+  indices_.swap(ordered_indices);
+
+  // pack each leaf's triangles, and point leaves at their packets
+  vector<uint32_t> leaves;
+  for (uint32_t i = 0; i < nodes_.size(); ++i)
+    if (nodes_[i].IsLeaf() && nodes_[i].primitive_count)
+      leaves.push_back(i);
+  packets_.resize(leaves.size());
+  tbb::parallel_for(tbb::blocked_range<size_t>(0, leaves.size()),
+                    [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i = range.begin(); i < range.end(); ++i) {
+        LinearBVHNode &leaf = nodes_[leaves[i]];
+        TrianglePacket packet(leaf.offset);
+        for (uint lane = 0; lane < leaf.primitive_count; ++lane) {
+          Vec3r points[3];
+          GetTrianglePoints(leaf.offset + lane, points);
+          packet.Set(lane, TriangleRecord{points[0], points[1], points[2]});
+        }
+        packets_[i] = packet;
+        leaf.offset = static_cast<uint32_t>(i);
+      }
+    });
+}
+
+
+void
+TriangleMesh::GetTrianglePoints(size_t triangle, Vec3r points[3]) const
+{
+  for (size_t i = 0; i < 3; ++i)
+    points[i] = vertices_[indices_[3 * triangle + i]];
+}
+
+
+bool
+TriangleMesh::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
+{
+  if (!nodes_.size())
+    return false;
+  return HitSubtree(0, ray, tmin, tmax, hit_record);
+}
+
+
+bool
+TriangleMesh::HitSubtree(uint32_t root, const Ray &ray, Real tmin, Real tmax,
+                         HitRecord &hit_record)
+{
+  const Vec3r origin = ray.GetOrigin();
+  const Vec3r inv_dir = ray.GetDirection().cwiseInverse();
+  const int dir_is_neg[3] = {inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0};
+
+  // find the closest triangle, then fill in the hit record once
+  uint32_t hit_packet = 0;
+  uint hit_lane = 0;
+  Real hit_t = 0;
+  Vec2r hit_uv{0, 0};
+  bool hit_something = false;
+  uint32_t to_visit[BVH::kMaxDepth];
+  uint to_visit_count = 0;
+  uint32_t current = root;
+  const LinearBVHNode *nodes = nodes_.data();
+  while (true) {
+    const LinearBVHNode &node = nodes[current];
+    if (node.Intersect(origin, inv_dir, dir_is_neg, tmin, tmax)) {
+      if (node.IsLeaf()) {
+        const TrianglePacket &packet = packets_[node.offset];
+        Real ray_t{0};
+        Vec2r uv;
+        int lane = packet.Intersect(ray, tmin, tmax, ray_t, uv);
+        if (lane >= 0) {
+          hit_something = true;
+          hit_packet = node.offset;
+          hit_lane = static_cast<uint>(lane);
+          hit_t = ray_t;
+          hit_uv = uv;
+          tmax = ray_t;
+        }
+        if (!to_visit_count)
+          break;
+        current = to_visit[--to_visit_count];
+      } else {
+        // visit the child on the near side of the split first
+        uint32_t near_child = node.offset;
+        uint32_t far_child = node.offset + 1;
+        if (dir_is_neg[node.axis])
+          std::swap(near_child, far_child);
+        to_visit[to_visit_count++] = far_child;
+        current = near_child;
+      }
+    } else {
+      if (!to_visit_count)
+        break;
+      current = to_visit[--to_visit_count];
+    }
+  }
+  if (!hit_something)
+    return false;
+
+  // a packet's lanes hold consecutive triangles
+  hit_record.SetHit(hit_t, this, packets_[hit_packet].first + hit_lane, hit_uv);
+  return true;
+}
+
+
+uint64_t
+TriangleMesh::HitPacket(RayPacket &packet, uint64_t active,
+                        HitRecord *hit_records)
+{
+  if (!nodes_.size() || !active)
+    return 0;
+  if (!packet.IsCoherent())
+    return Surface::HitPacket(packet, active, hit_records);
+
+  // each ray of a leaf is tested against the leaf's triangles at once
+  return detail::TraversePacket(
+    nodes_.data(), packet, active, hit_records,
+    [&](const LinearBVHNode &leaf, uint64_t mask) {
+      const TrianglePacket &triangles = packets_[leaf.offset];
+      uint64_t hits = 0;
+      for (uint32_t lane = 0; lane < packet.size; ++lane) {
+        if (!(mask & (uint64_t(1) << lane)))
+          continue;
+        Real ray_t{0};
+        Vec2r uv;
+        int hit_lane = triangles.Intersect(packet.rays[lane], packet.tmin,
+                                           packet.tmax[lane], ray_t, uv);
+        if (hit_lane < 0)
+          continue;
+        hit_records[lane].SetHit(ray_t, this, triangles.first +
+                                 static_cast<uint32_t>(hit_lane), uv);
+        packet.tmax[lane] = ray_t;
+        hits |= uint64_t(1) << lane;
+      }
+      return hits;
+    },
+    [&](uint32_t root, uint32_t lane) {
+      return HitSubtree(root, packet.rays[lane], packet.tmin,
+                        packet.tmax[lane], hit_records[lane]);
+    });
+}
+
+
+void
+TriangleMesh::ComputeHitAttributes(const Ray &ray, HitRecord &hit_record) const
+{
+  // shade as Triangle does
+  Vec3r points[3];
+  GetTrianglePoints(hit_record.GetPrimitiveId(), points);
+  hit_record.SetPoint(ray.At(hit_record.GetRayT()));
+  hit_record.SetNormal(ray, TriangleRecord{points[0], points[1],
+        points[2]}.GetNormal());
+}
+
+
+bool
+TriangleMesh::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!nodes_.size())
+    return false;
+
+  const Vec3r origin = ray.GetOrigin();
+  const Vec3r inv_dir = ray.GetDirection().cwiseInverse();
+  const int dir_is_neg[3] = {inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0};
+
+  uint32_t to_visit[BVH::kMaxDepth];
+  uint to_visit_count = 0;
+  uint32_t current = 0;
+  const LinearBVHNode *nodes = nodes_.data();
+  while (true) {
+    const LinearBVHNode &node = nodes[current];
+    if (node.Intersect(origin, inv_dir, dir_is_neg, tmin, tmax)) {
+      if (node.IsLeaf()) {
+        Real ray_t{0};
+        Vec2r uv;
+        if (packets_[node.offset].Intersect(ray, tmin, tmax, ray_t, uv) >= 0)
+          return true;
+        if (!to_visit_count)
+          break;
+        current = to_visit[--to_visit_count];
+      } else {
+        to_visit[to_visit_count++] = node.offset + 1;
+        current = node.offset;
+      }
+    } else {
+      if (!to_visit_count)
+        break;
+      current = to_visit[--to_visit_count];
+    }
+  }
+  return false;
+}
+
+
+bool
+TriangleMesh::GetBoundingBox(AABB &bbox) const
+{
+  bbox = bbox_;
+  return nodes_.size() > 0;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
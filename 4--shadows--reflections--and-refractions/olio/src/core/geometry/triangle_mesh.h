@@ -0,0 +1,143 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       triangle_mesh.h
+//! \brief      TriangleMesh class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tbb/cache_aligned_allocator.h>
+#include "core/geometry/surface.h"
+#include "core/geometry/aabb.h"
+#include "core/geometry/bvh.h"
+#include "core/geometry/triangle.h"
+#include "core/geometry/triangle_packet.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class Ray;
+class HitRecord;
+
+//! \class TriangleMesh
+//! \brief Triangles sharing one vertex array and one material
+//! \details Triangles are three indices into the vertex array rather
+//! than Surfaces of their own, with no per-triangle allocations. The
+//! mesh intersects its triangles through its own binned SAH hierarchy
+//! over triangle indices (see BVH::BuildNodes); acceleration
+//! structures over the scene treat it as a single surface. For
+//! intersection, the triangles of each leaf are also kept as one
+//! TrianglePacket, so a leaf is a single SIMD intersection instead of
+//! one call per triangle. Triangles are intersected and shaded exactly
+//! as Triangle does.
+class TriangleMesh : public Surface {
+public:
+  OLIO_NODE(TriangleMesh)
+
+  //! \brief Constructor; builds the mesh's hierarchy
+  //! \details Triangles with out-of-range indices are skipped with a
+  //!          warning.
+  //! \param[in] vertices Vertex positions
+  //! \param[in] indices Three vertex indices per triangle
+  //! \param[in] name Node name
+  TriangleMesh(const std::vector<Vec3r> &vertices,
+               const std::vector<uint32_t> &indices,
+               const std::string &name=std::string());
+
+  //! \brief Check if ray intersects with surface
+  //! \details If the ray intersections the surface, the function
+  //!          should fill in the 'hit_record' (i.e., information
+  //!          about the hit point, normal, etc.)
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \param[out] hit_record Resulting hit record if ray intersected with surface
+  //! \return True if ray intersected with surface
+  bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
+
+  //! \brief Intersect the rays of a packet with the mesh
+  //! \details Coherent packets traverse the mesh's hierarchy together,
+  //!          as in BVH::HitPacket(); in each leaf, every ray is tested
+  //!          against the leaf's TrianglePacket. Incoherent packets
+  //!          are traced ray by ray.
+  //! \param[in,out] packet Ray packet
+  //! \param[in] active Lanes to intersect (bit i is lane i)
+  //! \param[in,out] hit_records Hit records, one per lane of the packet
+  //! \return Lanes that intersected the mesh
+  uint64_t HitPacket(RayPacket &packet, uint64_t active,
+                     HitRecord *hit_records) override;
+
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Stops at the first leaf packet with a hit
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Compute point and normal of a hit recorded by Hit()
+  //! \details Uses the normal of the hit triangle, computed as
+  //!          Triangle does
+  //! \param[in] ray Ray that hit the surface
+  //! \param[in,out] hit_record Hit record filled in by Hit()
+  void ComputeHitAttributes(const Ray &ray,
+                            HitRecord &hit_record) const override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the mesh has at least one triangle
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  //! \brief Get the vertex positions
+  //! \return Vertex positions
+  const std::vector<Vec3r>& GetVertices() const {return vertices_;}
+
+  //! \brief Get the triangles' vertex indices, three per triangle, in
+  //!        the hierarchy's leaf order
+  //! \return Vertex indices
+  const std::vector<uint32_t>& GetIndices() const {return indices_;}
+
+  //! \brief Get the number of triangles
+  //! \return Number of triangles
+  size_t GetTriangleCount() const {return indices_.size() / 3;}
+
+  //! \brief Get the points of a triangle
+  //! \param[in] triangle Triangle index
+  //! \param[out] points Triangle points
+  void GetTrianglePoints(size_t triangle, Vec3r points[3]) const;
+protected:
+  //! \brief Find the closest hit of a ray in the subtree rooted at
+  //!        'root' (see Hit())
+  //! \param[in] root Subtree root
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t
+  //! \param[in] tmax Maximum value for acceptable t
+  //! \param[out] hit_record Resulting hit record if ray intersected
+  //! \return True if ray intersected a triangle in the subtree
+  bool HitSubtree(uint32_t root, const Ray &ray, Real tmin, Real tmax,
+                  HitRecord &hit_record);
+
+  std::vector<Vec3r> vertices_;    //!< shared vertex positions
+  std::vector<uint32_t> indices_;  //!< three vertex indices per triangle
+  //! \brief Contiguous packet storage aligned to cache lines
+  using PacketArray = std::vector<TrianglePacket,
+                                  tbb::cache_aligned_allocator<TrianglePacket>>;
+
+  PacketArray packets_;            //!< one packet per leaf
+  BVH::NodeArray nodes_;           //!< hierarchy over triangles; leaves index packets
+  AABB bbox_;                      //!< bounding box of all triangles
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
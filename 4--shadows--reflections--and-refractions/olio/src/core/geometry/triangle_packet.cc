@@ -0,0 +1,61 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       triangle_packet.cc
+//! \brief      TrianglePacket struct
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/triangle_packet.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+constexpr uint TrianglePacket::kWidth;
+
+TrianglePacket::TrianglePacket(uint32_t first) :
+  first{first},
+  count{0}
+{
+  for (int axis = 0; axis < 3; ++axis) {
+    for (uint lane = 0; lane < kWidth; ++lane) {
+      p0[axis][lane] = 0;
+      edge1[axis][lane] = 0;
+      edge2[axis][lane] = 0;
+    }
+  }
+}
+
+
+void
+TrianglePacket::Set(uint lane, const TriangleRecord &triangle)
+{
+  for (int axis = 0; axis < 3; ++axis) {
+    p0[axis][lane] = triangle.p0[axis];
+    edge1[axis][lane] = triangle.edge1[axis];
+    edge2[axis][lane] = triangle.edge2[axis];
+  }
+  if (lane >= count)
+    count = lane + 1;
+}
+
+
+TriangleRecord
+TrianglePacket::Get(uint lane) const
+{
+  TriangleRecord triangle;
+  for (int axis = 0; axis < 3; ++axis) {
+    triangle.p0[axis] = p0[axis][lane];
+    triangle.edge1[axis] = edge1[axis][lane];
+    triangle.edge2[axis] = edge2[axis][lane];
+  }
+  return triangle;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,252 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       triangle_packet.h
+//! \brief      TrianglePacket struct and its SIMD ray intersection kernel
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#if defined(__SSE2__) || defined(_M_X64)
+#define OLIO_TRIANGLE_PACKET_SSE
+#include <immintrin.h>
+#endif
+#if defined(__AVX__) && !defined(OLIO_USE_SINGLE_PRECISION)
+#define OLIO_TRIANGLE_PACKET_AVX
+#endif
+#include "core/types.h"
+#include "core/ray.h"
+#include "core/geometry/bvh.h"
+#include "core/geometry/triangle.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \struct TrianglePacket
+//! \brief Up to four triangles of a BVH leaf as TriangleRecords in
+//! structure-of-arrays form, so that one ray is intersected with all
+//! of them in a single SIMD pass (one AVX or SSE pass for four lanes,
+//! or two SSE2 passes in double precision). Each lane performs the
+//! same operations as Triangle::RayTriangleHit, so results match the
+//! scalar kernel; unused lanes have zero edges and never hit.
+struct alignas(32) TrianglePacket {
+  static constexpr uint kWidth = 4;  //!< triangles per packet
+
+  Real p0[3][kWidth];     //!< per-axis first points
+  Real edge1[3][kWidth];  //!< per-axis p0 - p1
+  Real edge2[3][kWidth];  //!< per-axis p0 - p2
+  uint32_t first;         //!< index of the triangle in lane 0
+  uint32_t count;         //!< number of used lanes
+
+  //! \brief Constructor; creates an empty packet
+  //! \param[in] first Index of the triangle to be stored in lane 0
+  explicit TrianglePacket(uint32_t first=0);
+
+  //! \brief Store a triangle in a lane
+  //! \param[in] lane Lane index
+  //! \param[in] triangle Triangle record
+  void Set(uint lane, const TriangleRecord &triangle);
+
+  //! \brief Get the triangle stored in a lane
+  //! \param[in] lane Lane index
+  //! \return Triangle record
+  TriangleRecord Get(uint lane) const;
+
+  //! \brief Find the closest triangle hit by the ray
+  //! \details Equivalent to calling Triangle::RayTriangleHit on the
+  //!          used lanes in order, lowering tmax after each hit
+  //! \param[in] ray Input ray
+  //! \param[in] tmin Minimum acceptable value for ray_t
+  //! \param[in] tmax Maximum acceptable value for ray_t
+  //! \param[out] ray_t Value of t at the closest hit point
+  //! \param[out] uv UV coordinates of the closest hit point
+  //! \return Lane of the closest hit triangle; -1 if none was hit
+  inline int Intersect(const Ray &ray, Real tmin, Real tmax, Real &ray_t,
+                       Vec2r &uv) const;
+};
+static_assert(BVH::kMaxLeafSize <= TrianglePacket::kWidth,
+              "TrianglePacket cannot hold a BVH leaf");
+
+
+namespace detail {
+
+#if defined(OLIO_TRIANGLE_PACKET_AVX)
+// four double lanes
+struct TriangleLanes {
+  using V = __m256d;
+  static constexpr uint kCount = 4;
+  static V Load(const double *p) {return _mm256_load_pd(p);}
+  static void Store(double *p, V a) {_mm256_storeu_pd(p, a);}
+  static V Set1(double a) {return _mm256_set1_pd(a);}
+  static V Add(V a, V b) {return _mm256_add_pd(a, b);}
+  static V Sub(V a, V b) {return _mm256_sub_pd(a, b);}
+  static V Mul(V a, V b) {return _mm256_mul_pd(a, b);}
+  static V Div(V a, V b) {return _mm256_div_pd(a, b);}
+  static V Neg(V a) {return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));}
+  static V Abs(V a) {return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);}
+  static V And(V a, V b) {return _mm256_and_pd(a, b);}
+  // comparisons are negated so that NaNs pass, as in the scalar kernel
+  static V NotLess(V a, V b) {return _mm256_cmp_pd(a, b, _CMP_NLT_UQ);}
+  static V NotGreater(V a, V b) {return _mm256_cmp_pd(a, b, _CMP_NGT_UQ);}
+  static uint Mask(V a) {return static_cast<uint>(_mm256_movemask_pd(a));}
+};
+#elif defined(OLIO_TRIANGLE_PACKET_SSE) && defined(OLIO_USE_SINGLE_PRECISION)
+// four float lanes
+struct TriangleLanes {
+  using V = __m128;
+  static constexpr uint kCount = 4;
+  static V Load(const float *p) {return _mm_load_ps(p);}
+  static void Store(float *p, V a) {_mm_storeu_ps(p, a);}
+  static V Set1(float a) {return _mm_set1_ps(a);}
+  static V Add(V a, V b) {return _mm_add_ps(a, b);}
+  static V Sub(V a, V b) {return _mm_sub_ps(a, b);}
+  static V Mul(V a, V b) {return _mm_mul_ps(a, b);}
+  static V Div(V a, V b) {return _mm_div_ps(a, b);}
+  static V Neg(V a) {return _mm_xor_ps(a, _mm_set1_ps(-0.0f));}
+  static V Abs(V a) {return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);}
+  static V And(V a, V b) {return _mm_and_ps(a, b);}
+  static V NotLess(V a, V b) {return _mm_cmpnlt_ps(a, b);}
+  static V NotGreater(V a, V b) {return _mm_cmpngt_ps(a, b);}
+  static uint Mask(V a) {return static_cast<uint>(_mm_movemask_ps(a));}
+};
+#elif defined(OLIO_TRIANGLE_PACKET_SSE)
+// two double lanes
+struct TriangleLanes {
+  using V = __m128d;
+  static constexpr uint kCount = 2;
+  static V Load(const double *p) {return _mm_load_pd(p);}
+  static void Store(double *p, V a) {_mm_storeu_pd(p, a);}
+  static V Set1(double a) {return _mm_set1_pd(a);}
+  static V Add(V a, V b) {return _mm_add_pd(a, b);}
+  static V Sub(V a, V b) {return _mm_sub_pd(a, b);}
+  static V Mul(V a, V b) {return _mm_mul_pd(a, b);}
+  static V Div(V a, V b) {return _mm_div_pd(a, b);}
+  static V Neg(V a) {return _mm_xor_pd(a, _mm_set1_pd(-0.0));}
+  static V Abs(V a) {return _mm_andnot_pd(_mm_set1_pd(-0.0), a);}
+  static V And(V a, V b) {return _mm_and_pd(a, b);}
+  static V NotLess(V a, V b) {return _mm_cmpnlt_pd(a, b);}
+  static V NotGreater(V a, V b) {return _mm_cmpngt_pd(a, b);}
+  static uint Mask(V a) {return static_cast<uint>(_mm_movemask_pd(a));}
+};
+#endif
+
+#if defined(OLIO_TRIANGLE_PACKET_SSE)
+// Triangle::RayTriangleHit on lanes [lane, lane + kCount); returns the
+// mask of hit lanes and their t, beta and gamma. Like the scalar
+// kernel, it stops as soon as every lane has been rejected.
+inline uint
+IntersectTriangleLanes(const TrianglePacket &packet, uint lane,
+                       const Ray &ray, Real tmin, Real tmax,
+                       Real ray_t[], Real beta[], Real gamma[])
+{
+  using L = TriangleLanes;
+  const Vec3r &ray_dir = ray.GetDirection();
+  const Vec3r &ray_origin = ray.GetOrigin();
+  L::V a = L::Load(packet.edge1[0] + lane);
+  L::V b = L::Load(packet.edge1[1] + lane);
+  L::V c = L::Load(packet.edge1[2] + lane);
+  L::V d = L::Load(packet.edge2[0] + lane);
+  L::V e = L::Load(packet.edge2[1] + lane);
+  L::V f = L::Load(packet.edge2[2] + lane);
+  L::V g = L::Set1(ray_dir[0]);
+  L::V h = L::Set1(ray_dir[1]);
+  L::V i = L::Set1(ray_dir[2]);
+  L::V j = L::Sub(L::Load(packet.p0[0] + lane), L::Set1(ray_origin[0]));
+  L::V k = L::Sub(L::Load(packet.p0[1] + lane), L::Set1(ray_origin[1]));
+  L::V l = L::Sub(L::Load(packet.p0[2] + lane), L::Set1(ray_origin[2]));
+  L::V ei_minus_hf = L::Sub(L::Mul(e, i), L::Mul(h, f));
+  L::V gf_minus_di = L::Sub(L::Mul(g, f), L::Mul(d, i));
+  L::V dh_minus_eg = L::Sub(L::Mul(d, h), L::Mul(e, g));
+  L::V ak_minus_jb = L::Sub(L::Mul(a, k), L::Mul(j, b));
+  L::V jc_minus_al = L::Sub(L::Mul(j, c), L::Mul(a, l));
+  L::V bl_minus_kc = L::Sub(L::Mul(b, l), L::Mul(k, c));
+  L::V M = L::Add(L::Add(L::Mul(a, ei_minus_hf), L::Mul(b, gf_minus_di)),
+                  L::Mul(c, dh_minus_eg));
+  L::V valid = L::NotLess(L::Abs(M), L::Set1(kEpsilon));
+  if (!L::Mask(valid))
+    return 0;
+
+  L::V t = L::Div(L::Neg(L::Add(L::Add(L::Mul(f, ak_minus_jb),
+                                       L::Mul(e, jc_minus_al)),
+                                L::Mul(d, bl_minus_kc))), M);
+  valid = L::And(valid, L::And(L::NotLess(t, L::Set1(tmin)),
+                               L::NotGreater(t, L::Set1(tmax))));
+  if (!L::Mask(valid))
+    return 0;
+
+  L::V zero = L::Set1(0);
+  L::V one = L::Set1(1);
+  L::V gamma_v = L::Div(L::Add(L::Add(L::Mul(i, ak_minus_jb),
+                                      L::Mul(h, jc_minus_al)),
+                               L::Mul(g, bl_minus_kc)), M);
+  valid = L::And(valid, L::And(L::NotLess(gamma_v, zero),
+                               L::NotGreater(gamma_v, one)));
+  if (!L::Mask(valid))
+    return 0;
+
+  L::V beta_v = L::Div(L::Add(L::Add(L::Mul(j, ei_minus_hf),
+                                     L::Mul(k, gf_minus_di)),
+                              L::Mul(l, dh_minus_eg)), M);
+  valid = L::And(valid, L::And(L::NotLess(beta_v, zero),
+                               L::NotGreater(beta_v, L::Sub(one, gamma_v))));
+
+  L::Store(ray_t, t);
+  L::Store(beta, beta_v);
+  L::Store(gamma, gamma_v);
+  return L::Mask(valid);
+}
+#endif
+
+}  // namespace detail
+
+
+inline int
+TrianglePacket::Intersect(const Ray &ray, Real tmin, Real tmax, Real &ray_t,
+                          Vec2r &uv) const
+{
+  Real t[kWidth], beta[kWidth], gamma[kWidth];
+  uint mask = 0;
+#if defined(OLIO_TRIANGLE_PACKET_SSE)
+  for (uint lane = 0; lane < count; lane += detail::TriangleLanes::kCount)
+    mask |= detail::IntersectTriangleLanes(*this, lane, ray, tmin, tmax,
+                                           t + lane, beta + lane,
+                                           gamma + lane) << lane;
+#else
+  for (uint lane = 0; lane < count; ++lane) {
+    Vec2r lane_uv;
+    if (Triangle::RayTriangleHit(Get(lane), ray, tmin, tmax, t[lane],
+                                 lane_uv)) {
+      mask |= 1u << lane;
+      beta[lane] = lane_uv[0];
+      gamma[lane] = lane_uv[1];
+    }
+  }
+#endif
+
+  // keep the closest hit; on ties the later lane wins, as it would
+  // with sequential calls
+  int hit_lane = -1;
+  for (uint lane = 0; lane < count; ++lane) {
+    if ((mask & (1u << lane)) && !(t[lane] > tmax)) {
+      hit_lane = static_cast<int>(lane);
+      tmax = t[lane];
+    }
+  }
+  if (hit_lane >= 0) {
+    ray_t = t[hit_lane];
+    uv[0] = beta[hit_lane];
+    uv[1] = gamma[hit_lane];
+  }
+  return hit_lane;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
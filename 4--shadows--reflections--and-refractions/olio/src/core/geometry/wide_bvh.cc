@@ -0,0 +1,265 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       wide_bvh.cc
+//! \brief      WideBVH class
+//! \author     Stephanie Jung, 2025
+
+#include "core/geometry/wide_bvh.h"
+#include <algorithm>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include "core/ray.h"
+#include "core/geometry/wide_bvh_intersector.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+using namespace detail;
+
+template <uint N>
+constexpr uint WideBVH<N>::kStackSize;
+
+
+template <uint N>
+WideBVH<N>::WideBVH(const vector<Surface::Ptr> &surfaces,
+                    const std::string &name) :
+  Surface{}
+{
+  name_ = name.size() ? name : "BVH" + to_string(N);
+  auto bvh = BVH::Create(surfaces);
+  Init(*bvh);
+}
+
+
+template <uint N>
+WideBVH<N>::WideBVH(const BVH &bvh, const std::string &name) :
+  Surface{}
+{
+  name_ = name.size() ? name : "BVH" + to_string(N);
+  Init(bvh);
+}
+
+
+template <uint N>
+void
+WideBVH<N>::Init(const BVH &bvh)
+{
+  bvh.GetBoundingBox(bbox_);
+  primitives_ = bvh.GetPrimitives();
+  const auto &binary_nodes = bvh.GetNodes();
+  if (!binary_nodes.size())
+    return;
+
+  // every wide node replaces at least one binary inner node
+  nodes_.reserve(binary_nodes.size() / 2 + 1);
+  if (binary_nodes[0].IsLeaf()) {
+    // single leaf: wrap it in a root with one used slot
+    WideBVHNode<N> root;
+    for (uint i = 0; i < N; ++i) {
+      for (int axis = 0; axis < 3; ++axis) {
+        root.bbox_min[axis][i] = numeric_limits<float>::infinity();
+        root.bbox_max[axis][i] = -numeric_limits<float>::infinity();
+      }
+      root.child[i] = 0;
+      root.primitive_count[i] = 0;
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+      root.bbox_min[axis][0] = binary_nodes[0].bbox_min[axis];
+      root.bbox_max[axis][0] = binary_nodes[0].bbox_max[axis];
+    }
+    root.child[0] = binary_nodes[0].offset;
+    root.primitive_count[0] = binary_nodes[0].primitive_count;
+    nodes_.push_back(root);
+  } else {
+    Collapse(binary_nodes, 0);
+  }
+  nodes_.shrink_to_fit();
+}
+
+
+template <uint N>
+uint32_t
+WideBVH<N>::Collapse(const BVH::NodeArray &binary_nodes, uint32_t binary_index)
+{
+  auto node_area = [&](uint32_t index) -> float {
+    const LinearBVHNode &node = binary_nodes[index];
+    float dx = node.bbox_max[0] - node.bbox_min[0];
+    float dy = node.bbox_max[1] - node.bbox_min[1];
+    float dz = node.bbox_max[2] - node.bbox_min[2];
+    return dx * dy + dx * dz + dy * dz;
+  };
+
+  // open up the largest inner descendants until all N slots are used
+  uint32_t slots[N];
+  uint slot_count = 2;
+  slots[0] = binary_nodes[binary_index].offset;
+  slots[1] = binary_nodes[binary_index].offset + 1;
+  while (slot_count < N) {
+    uint largest = N;
+    float largest_area = -1;
+    for (uint i = 0; i < slot_count; ++i) {
+      if (binary_nodes[slots[i]].IsLeaf())
+        continue;
+      float area = node_area(slots[i]);
+      if (area > largest_area) {
+        largest_area = area;
+        largest = i;
+      }
+    }
+    if (largest == N)
+      break;
+    uint32_t opened = slots[largest];
+    slots[largest] = binary_nodes[opened].offset;
+    slots[slot_count++] = binary_nodes[opened].offset + 1;
+  }
+
+  // fill in the node, then collapse inner children
+  auto node_index = static_cast<uint32_t>(nodes_.size());
+  WideBVHNode<N> node;
+  for (uint i = 0; i < N; ++i) {
+    const bool used = i < slot_count;
+    for (int axis = 0; axis < 3; ++axis) {
+      node.bbox_min[axis][i] = used ? binary_nodes[slots[i]].bbox_min[axis] :
+        numeric_limits<float>::infinity();
+      node.bbox_max[axis][i] = used ? binary_nodes[slots[i]].bbox_max[axis] :
+        -numeric_limits<float>::infinity();
+    }
+    node.child[i] = used ? binary_nodes[slots[i]].offset : 0;
+    node.primitive_count[i] = used ? binary_nodes[slots[i]].primitive_count : 0;
+  }
+  nodes_.push_back(node);
+  for (uint i = 0; i < slot_count; ++i) {
+    if (!binary_nodes[slots[i]].IsLeaf()) {
+      uint32_t child = Collapse(binary_nodes, slots[i]);
+      nodes_[node_index].child[i] = child;
+    }
+  }
+  return node_index;
+}
+
+
+template <uint N>
+bool
+WideBVH<N>::Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record)
+{
+  if (!nodes_.size())
+    return false;
+
+  WideRay wide_ray(ray);
+  NodeIntersector<N> intersector(wide_ray);
+  float tmin_f = RoundDownToFloat(tmin);
+  float tmax_f = RoundUpToFloat(tmax);
+
+  bool hit_something = false;
+  StackEntry stack[kStackSize];
+  uint stack_size = 0;
+  stack[stack_size++] = StackEntry{0, tmin_f};
+  const WideBVHNode<N> *nodes = nodes_.data();
+  while (stack_size) {
+    const StackEntry entry = stack[--stack_size];
+    if (entry.tnear > tmax_f * kRobustScale)
+      continue;
+    const WideBVHNode<N> &node = nodes[entry.node];
+    float tnear[N];
+    uint mask = intersector.Intersect(node, tmin_f, tmax_f, tnear);
+    if (!mask)
+      continue;
+
+    // sort hit children front to back
+    uint order[N];
+    uint hit_count = 0;
+    for (uint i = 0; i < N; ++i) {
+      if (!(mask & (1u << i)))
+        continue;
+      uint j = hit_count++;
+      for (; j > 0 && tnear[order[j - 1]] > tnear[i]; --j)
+        order[j] = order[j - 1];
+      order[j] = i;
+    }
+
+    // intersect leaves now, nearest first, and queue inner children
+    // so that the nearest one is visited next
+    for (uint k = 0; k < hit_count; ++k) {
+      uint i = order[k];
+      if (!node.IsLeaf(i) || tnear[i] > tmax_f * kRobustScale)
+        continue;
+      for (uint32_t p = 0; p < node.primitive_count[i]; ++p) {
+        if (primitives_[node.child[i] + p]->Hit(ray, tmin, tmax, hit_record)) {
+          hit_something = true;
+          tmax = hit_record.GetRayT();
+          tmax_f = RoundUpToFloat(tmax);
+        }
+      }
+    }
+    for (uint k = hit_count; k-- > 0;) {
+      uint i = order[k];
+      if (node.IsLeaf(i))
+        continue;
+      OLIO_PREFETCH(&nodes[node.child[i]]);
+      stack[stack_size++] = StackEntry{node.child[i], tnear[i]};
+    }
+  }
+  return hit_something;
+}
+
+
+template <uint N>
+bool
+WideBVH<N>::Occluded(const Ray &ray, Real tmin, Real tmax)
+{
+  if (!nodes_.size())
+    return false;
+
+  WideRay wide_ray(ray);
+  NodeIntersector<N> intersector(wide_ray);
+  float tmin_f = RoundDownToFloat(tmin);
+  float tmax_f = RoundUpToFloat(tmax);
+
+  // any hit will do: children are neither sorted nor culled by distance
+  uint32_t stack[kStackSize];
+  uint stack_size = 0;
+  stack[stack_size++] = 0;
+  const WideBVHNode<N> *nodes = nodes_.data();
+  while (stack_size) {
+    const WideBVHNode<N> &node = nodes[stack[--stack_size]];
+    float tnear[N];
+    uint mask = intersector.Intersect(node, tmin_f, tmax_f, tnear);
+    for (uint i = 0; i < N; ++i) {
+      if (!(mask & (1u << i)))
+        continue;
+      if (!node.IsLeaf(i)) {
+        OLIO_PREFETCH(&nodes[node.child[i]]);
+        stack[stack_size++] = node.child[i];
+        continue;
+      }
+      for (uint32_t p = 0; p < node.primitive_count[i]; ++p)
+        if (primitives_[node.child[i] + p]->Occluded(ray, tmin, tmax))
+          return true;
+    }
+  }
+  return false;
+}
+
+
+template <uint N>
+bool
+WideBVH<N>::GetBoundingBox(AABB &bbox) const
+{
+  bbox = bbox_;
+  return nodes_.size() > 0;
+}
+
+
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,132 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       wide_bvh.h
+//! \brief      WideBVH class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <tbb/cache_aligned_allocator.h>
+#include "core/geometry/surface.h"
+#include "core/geometry/aabb.h"
+#include "core/geometry/bvh.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+class Ray;
+class HitRecord;
+
+//! \struct WideBVHNode
+//! \brief Node of an N-wide BVH. Child bounds are stored as structure
+//! of arrays so that one SIMD instruction processes one slab of all N
+//! children. Unused child slots have empty (inverted) bounds.
+template <uint N>
+struct alignas(64) WideBVHNode {
+  float bbox_min[3][N];          //!< per-axis minimum corners of children
+  float bbox_max[3][N];          //!< per-axis maximum corners of children
+  uint32_t child[N];             //!< inner child: node index; leaf: first primitive
+  uint16_t primitive_count[N];   //!< leaf: number of primitives; 0 otherwise
+
+  //! \brief Whether child slot i is a leaf
+  //! \param[in] i Child slot
+  //! \return True if the slot references primitives
+  inline bool IsLeaf(uint i) const {return primitive_count[i] > 0;}
+};
+
+
+//! \class WideBVH
+//! \brief Bounding volume hierarchy with N children per node, built by
+//! collapsing a binary BVH. Each traversal step tests the ray against
+//! all N child boxes at once: with SSE for N = 4 and with AVX (or two
+//! SSE halves) for N = 8.
+template <uint N>
+class WideBVH : public Surface {
+public:
+  OLIO_NODE(WideBVH)
+
+  //! \brief Constructor; builds a binary BVH over the input surfaces
+  //!        and collapses it into an N-wide hierarchy
+  //! \param[in] surfaces Surfaces to build the hierarchy over
+  //! \param[in] name Node name
+  WideBVH(const std::vector<Surface::Ptr> &surfaces,
+          const std::string &name=std::string());
+
+  //! \brief Constructor; collapses an existing binary BVH
+  //! \param[in] bvh Binary BVH to collapse
+  //! \param[in] name Node name
+  WideBVH(const BVH &bvh, const std::string &name=std::string());
+
+  //! \brief Check if ray intersects with surface
+  //! \details If the ray intersections the surface, the function
+  //!          should fill in the 'hit_record' (i.e., information
+  //!          about the hit point, normal, etc.)
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \param[out] hit_record Resulting hit record if ray intersected with surface
+  //! \return True if ray intersected with surface
+  bool Hit(const Ray &ray, Real tmin, Real tmax, HitRecord &hit_record) override;
+
+  //! \brief Check if anything blocks the ray between tmin and tmax
+  //! \details Stops at the first primitive hit; hit children are not
+  //!          sorted by distance
+  //! \param[in] ray Ray to check intersection against
+  //! \param[in] tmin Minimum value for acceptable t (ray fractional distance)
+  //! \param[in] tmax Maximum value for acceptable t (ray fractional distance)
+  //! \return True if ray intersected with surface
+  bool Occluded(const Ray &ray, Real tmin, Real tmax) override;
+
+  //! \brief Get surface's axis-aligned bounding box
+  //! \param[out] bbox Bounding box of the surface
+  //! \return True if the hierarchy contains at least one surface
+  bool GetBoundingBox(AABB &bbox) const override;
+
+  //! \brief Contiguous node storage aligned to cache lines
+  using NodeArray = std::vector<WideBVHNode<N>,
+                                tbb::cache_aligned_allocator<WideBVHNode<N>>>;
+
+  //! \brief Get the nodes; node 0 is the root
+  //! \return Hierarchy nodes
+  const NodeArray& GetNodes() const {return nodes_;}
+
+  //! \brief Max number of pending nodes during traversal; the wide
+  //! tree is never deeper than the binary one
+  static constexpr uint kStackSize = BVH::kMaxDepth * (N - 1);
+protected:
+  //! \brief Collapse the binary subtree rooted at 'binary_index' into
+  //!        a wide node and, recursively, its descendants
+  //! \param[in] binary_nodes Binary BVH nodes
+  //! \param[in] binary_index Root of the binary subtree; must be an
+  //!            inner node
+  //! \return Index of the created wide node in 'nodes_'
+  uint32_t Collapse(const BVH::NodeArray &binary_nodes, uint32_t binary_index);
+
+  //! \brief Initialize from a binary BVH
+  //! \param[in] bvh Binary BVH to collapse
+  void Init(const BVH &bvh);
+
+  NodeArray nodes_;                       //!< wide nodes; node 0 is the root
+  std::vector<Surface::Ptr> primitives_;  //!< surfaces in leaf order
+  AABB bbox_;                             //!< bounding box of all surfaces
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
+
+extern template class WideBVH<4>;
+extern template class WideBVH<8>;
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,218 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       wide_bvh_intersector.h
+//! \brief      Ray/child box tests shared by the wide BVHs
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#if defined(__SSE2__) || defined(_M_X64)
+#define OLIO_WIDE_BVH_SSE
+#include <immintrin.h>
+#endif
+#if defined(__AVX__)
+#define OLIO_WIDE_BVH_AVX
+#endif
+#include "core/ray.h"
+#include "core/geometry/wide_bvh.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+namespace detail {
+
+// Slab distances are computed in single precision. The ray origin is
+// rounded to float and nudged by its rounding error towards/away from
+// each slab, and the exit distance is scaled up to absorb the
+// rounding of the subtraction, reciprocal and product, so the test
+// never rejects a box the ray overlaps.
+const float kRobustScale = 1 + 4 * std::numeric_limits<float>::epsilon();
+
+// ray data shared by the node intersectors
+struct WideRay {
+  float org_near[3];  //!< origin used against each axis' near slab
+  float org_far[3];   //!< origin used against each axis' far slab
+  float inv_dir[3];   //!< reciprocal direction
+  int dir_is_neg[3];  //!< whether the direction is negative on each axis
+
+  WideRay(const Ray &ray) {
+    const Vec3r origin = ray.GetOrigin();
+    const Vec3r dir = ray.GetDirection();
+    for (int axis = 0; axis < 3; ++axis) {
+      auto o = static_cast<float>(origin[axis]);
+      auto error = 2 * std::numeric_limits<float>::epsilon() * std::fabs(o);
+      inv_dir[axis] = 1 / static_cast<float>(dir[axis]);
+      dir_is_neg[axis] = inv_dir[axis] < 0;
+      // moving the origin against the direction lowers the entry
+      // distance; moving it along the direction raises the exit distance
+      float sign = dir_is_neg[axis] ? -1.0f : 1.0f;
+      org_near[axis] = o + sign * error;
+      org_far[axis] = o - sign * error;
+    }
+  }
+};
+
+
+// portable fallback: one child at a time
+template <uint N>
+struct NodeIntersector {
+  explicit NodeIntersector(const WideRay &ray) : ray_(ray) {}
+
+  // returns a bit mask of hit children and their entry distances
+  inline uint Intersect(const WideBVHNode<N> &node, float tmin, float tmax,
+                        float tnear_out[N]) const {
+    uint mask = 0;
+    for (uint i = 0; i < N; ++i) {
+      float tnear = tmin, tfar = tmax;
+      for (int axis = 0; axis < 3; ++axis) {
+        const float *near = ray_.dir_is_neg[axis] ? node.bbox_max[axis] :
+          node.bbox_min[axis];
+        const float *far = ray_.dir_is_neg[axis] ? node.bbox_min[axis] :
+          node.bbox_max[axis];
+        float t0 = (near[i] - ray_.org_near[axis]) * ray_.inv_dir[axis];
+        float t1 = (far[i] - ray_.org_far[axis]) * ray_.inv_dir[axis];
+        tnear = t0 > tnear ? t0 : tnear;
+        tfar = t1 < tfar ? t1 : tfar;
+      }
+      tnear_out[i] = tnear;
+      if (tnear <= tfar * kRobustScale)
+        mask |= 1u << i;
+    }
+    return mask;
+  }
+
+  const WideRay &ray_;
+};
+
+#if defined(OLIO_WIDE_BVH_SSE)
+// four children per SSE instruction; NodeIntersector<8> uses two halves
+struct SSEIntersector {
+  explicit SSEIntersector(const WideRay &ray) {
+    for (int axis = 0; axis < 3; ++axis) {
+      org_near[axis] = _mm_set1_ps(ray.org_near[axis]);
+      org_far[axis] = _mm_set1_ps(ray.org_far[axis]);
+      inv_dir[axis] = _mm_set1_ps(ray.inv_dir[axis]);
+      dir_is_neg[axis] = ray.dir_is_neg[axis];
+    }
+  }
+
+  // test the four children starting at 'offset'
+  template <uint N>
+  inline uint Intersect(const WideBVHNode<N> &node, uint offset, __m128 tmin,
+                        __m128 tmax, float *tnear_out) const {
+    __m128 tnear = tmin, tfar = tmax;
+    for (int axis = 0; axis < 3; ++axis) {
+      const float *near = dir_is_neg[axis] ? node.bbox_max[axis] :
+        node.bbox_min[axis];
+      const float *far = dir_is_neg[axis] ? node.bbox_min[axis] :
+        node.bbox_max[axis];
+      __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(near + offset),
+                                        org_near[axis]), inv_dir[axis]);
+      __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(far + offset),
+                                        org_far[axis]), inv_dir[axis]);
+      // max/min return the second operand for NaNs (0 * inf)
+      tnear = _mm_max_ps(t0, tnear);
+      tfar = _mm_min_ps(t1, tfar);
+    }
+    _mm_storeu_ps(tnear_out, tnear);
+    tfar = _mm_mul_ps(tfar, _mm_set1_ps(kRobustScale));
+    return static_cast<uint>(_mm_movemask_ps(_mm_cmple_ps(tnear, tfar)));
+  }
+
+  __m128 org_near[3];
+  __m128 org_far[3];
+  __m128 inv_dir[3];
+  int dir_is_neg[3];
+};
+
+
+template <>
+struct NodeIntersector<4> {
+  explicit NodeIntersector(const WideRay &ray) : sse_(ray) {}
+
+  inline uint Intersect(const WideBVHNode<4> &node, float tmin, float tmax,
+                        float tnear_out[4]) const {
+    return sse_.Intersect(node, 0, _mm_set1_ps(tmin), _mm_set1_ps(tmax),
+                          tnear_out);
+  }
+
+  SSEIntersector sse_;
+};
+
+#if defined(OLIO_WIDE_BVH_AVX)
+template <>
+struct NodeIntersector<8> {
+  explicit NodeIntersector(const WideRay &ray) {
+    for (int axis = 0; axis < 3; ++axis) {
+      org_near[axis] = _mm256_set1_ps(ray.org_near[axis]);
+      org_far[axis] = _mm256_set1_ps(ray.org_far[axis]);
+      inv_dir[axis] = _mm256_set1_ps(ray.inv_dir[axis]);
+      dir_is_neg[axis] = ray.dir_is_neg[axis];
+    }
+  }
+
+  inline uint Intersect(const WideBVHNode<8> &node, float tmin, float tmax,
+                        float tnear_out[8]) const {
+    __m256 tnear = _mm256_set1_ps(tmin);
+    __m256 tfar = _mm256_set1_ps(tmax);
+    for (int axis = 0; axis < 3; ++axis) {
+      const float *near = dir_is_neg[axis] ? node.bbox_max[axis] :
+        node.bbox_min[axis];
+      const float *far = dir_is_neg[axis] ? node.bbox_min[axis] :
+        node.bbox_max[axis];
+      __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(near),
+                                              org_near[axis]), inv_dir[axis]);
+      __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(far),
+                                              org_far[axis]), inv_dir[axis]);
+      tnear = _mm256_max_ps(t0, tnear);
+      tfar = _mm256_min_ps(t1, tfar);
+    }
+    _mm256_storeu_ps(tnear_out, tnear);
+    tfar = _mm256_mul_ps(tfar, _mm256_set1_ps(kRobustScale));
+    return static_cast<uint>(_mm256_movemask_ps(
+      _mm256_cmp_ps(tnear, tfar, _CMP_LE_OQ)));
+  }
+
+  __m256 org_near[3];
+  __m256 org_far[3];
+  __m256 inv_dir[3];
+  int dir_is_neg[3];
+};
+#else
+template <>
+struct NodeIntersector<8> {
+  explicit NodeIntersector(const WideRay &ray) : sse_(ray) {}
+
+  inline uint Intersect(const WideBVHNode<8> &node, float tmin, float tmax,
+                        float tnear_out[8]) const {
+    __m128 tmin4 = _mm_set1_ps(tmin);
+    __m128 tmax4 = _mm_set1_ps(tmax);
+    uint low = sse_.Intersect(node, 0, tmin4, tmax4, tnear_out);
+    uint high = sse_.Intersect(node, 4, tmin4, tmax4, tnear_out + 4);
+    return low | (high << 4);
+  }
+
+  SSEIntersector sse_;
+};
+#endif  // OLIO_WIDE_BVH_AVX
+#endif  // OLIO_WIDE_BVH_SSE
+
+
+// pending node on the traversal stack
+struct StackEntry {
+  uint32_t node;  //!< wide node index
+  float tnear;    //!< distance at which the ray enters the node
+};
+
+}  // namespace detail
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
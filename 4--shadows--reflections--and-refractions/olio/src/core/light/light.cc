@@ -16,6 +16,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 
@@ -27,7 +28,8 @@ Light::Light(const std::string &name) :
 
 
 Vec3r
-Light::Illuminate(const HitRecord &hit_record, const Vec3r &view_vec, Surface::Ptr scene) const
+Light::Illuminate(const HitRecord &hit_record,
+                  const MaterialParams &/*material*/, const Vec3r &view_vec, const Surface::Ptr &scene) const
 {
   return Vec3r{0, 0, 0};
 }
@@ -49,17 +51,14 @@ AmbientLight::AmbientLight(const Vec3r &ambient, const std::string &name) :
 
 
 Vec3r
-AmbientLight::Illuminate(const HitRecord &hit_record, const Vec3r &view_vec, Surface::Ptr scene) const
+AmbientLight::Illuminate(const HitRecord &/*hit_record*/,
+                         const MaterialParams &material, const Vec3r &view_vec,
+                         const Surface::Ptr &scene) const
 {
-  // only process phong materials
-  auto surface = hit_record.GetSurface();
-  if (!surface)
-    return Vec3r{0, 0, 0};
-  auto phong_material = dynamic_pointer_cast<PhongMaterial>(surface->
-                                                            GetMaterial());
-  if (!phong_material)
+  // skip surfaces without a material
+  if (material.type == MaterialType::kNone)
     return Vec3r{0, 0, 0};
-  return ambient_.cwiseProduct(phong_material->GetAmbient());
+  return ambient_.cwiseProduct(material.ambient);
 }
 
 
@@ -112,29 +111,25 @@ PointLight::Illuminate_orig(const HitRecord &hit_record, const Vec3r &view_vec)
 */
 
 Vec3r 
-PointLight::Illuminate(const HitRecord &hit_record, const Vec3r &view_vec, Surface::Ptr scene) const{
+PointLight::Illuminate(const HitRecord &hit_record,
+                       const MaterialParams &material, const Vec3r &view_vec,
+                       const Surface::Ptr &scene) const{
 
     Vec3r light_dir = position_ - hit_record.GetPoint(); // Vector from hit point to light
     Ray shadow_ray(hit_record.GetPoint(), light_dir); // Shadow ray from hit point towards light source
 
-    // Normalize the direction of the light vector
-    light_dir.normalize();
-
     // evaluate hit points material
     Vec3r black{0, 0, 0};
 
-    HitRecord temp_hit_record;
-    if (scene->Hit(shadow_ray, kEpsilon, light_dir.norm(), temp_hit_record)){
-        return black;
-    }
     // only process phong materials
-    auto surface = hit_record.GetSurface();
-    if (!surface)
+    if (material.type == MaterialType::kNone)
         return black;
-    auto phong_material = dynamic_pointer_cast<PhongMaterial>(surface->
-                                                                    GetMaterial());
-    if (!phong_material)
+
+    // the unnormalized direction reaches the light at t = 1, so only the
+    // segment up to the light can hold occluders
+    if (scene->Occluded(shadow_ray, kEpsilon, 1)){
         return black;
+    }
 
     // compute irradiance at hit point
     const Vec3r &hit_position = hit_record.GetPoint();
@@ -146,11 +141,12 @@ PointLight::Illuminate(const HitRecord &hit_record, const Vec3r &view_vec, Surfa
     Vec3r irradiance = intensity_ * fmax(0.0f, normal.dot(light_vec))/denominator;
 
     // compute how much the material absorts light
-    const Vec3r &attenuation = phong_material->Evaluate(hit_record, light_vec,
-                                                            view_vec);
+    const Vec3r &attenuation = PhongMaterial::Evaluate(material, hit_record,
+                                                       light_vec, view_vec);
     return irradiance.cwiseProduct(attenuation);
     
 }
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
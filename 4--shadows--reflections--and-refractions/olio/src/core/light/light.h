@@ -15,10 +15,12 @@
 #include <string>
 #include "core/types.h"
 #include "core/node.h"
+#include "core/material/material.h"
 #include "core/geometry/surface.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class Ray;
 class HitRecord;
@@ -34,13 +36,18 @@ public:
   //! \param[in] name Node name
   explicit Light(const std::string &name=std::string());
 
-  //! \brief Illuminate a hit point by retrieving its Phong material
-  //! and evaluating it with a call to `Material::Eval()`
+  //! \brief Illuminate a hit point by evaluating its Phong material
+  //! with a call to `PhongMaterial::Evaluate()`
   //! \param[in] hit_record Hit record for the point
+  //! \param[in] material Hit surface's material (see MaterialTable)
   //! \param[in] view_vec View vector (points away from the surface)
+  //! \param[in] scene Scene, for shadow rays
   //! \return Total radiance leaving the point in the direction of
   //!         view_vec
-  virtual Vec3r Illuminate(const HitRecord &hit_record, const Vec3r &view_vec, Surface::Ptr scene) const;
+  virtual Vec3r Illuminate(const HitRecord &hit_record,
+                           const MaterialParams &material,
+                           const Vec3r &view_vec,
+                           const Surface::Ptr &scene) const;
 protected:
 };
 
@@ -60,13 +67,18 @@ public:
   //! \param[in] name Node name
   AmbientLight(const Vec3r &ambient, const std::string &name=std::string());
 
-  //! \brief Illuminate a hit point by retrieving its Phong material
-  //! and evaluating it with a call to `Material::Eval()`
+  //! \brief Illuminate a hit point by evaluating its Phong material
+  //! with a call to `PhongMaterial::Evaluate()`
   //! \param[in] hit_record Hit record for the point
+  //! \param[in] material Hit surface's material (see MaterialTable)
   //! \param[in] view_vec View vector (points away from the surface)
+  //! \param[in] scene Scene, for shadow rays
   //! \return Total radiance leaving the point in the direction of
   //!         view_vec
-  Vec3r Illuminate(const HitRecord &hit_record, const Vec3r &view_vec, Surface::Ptr scene) const override;
+  Vec3r Illuminate(const HitRecord &hit_record,
+                   const MaterialParams &material,
+                   const Vec3r &view_vec,
+                   const Surface::Ptr &scene) const override;
 
   //! \brief Set ambient intensity
   //! \param[in] ambient Ambient intensity
@@ -97,17 +109,22 @@ public:
   PointLight(const Vec3r &position, const Vec3r &intensity,
              const std::string &name=std::string());
 
-  //! \brief Illuminate a hit point by retrieving its Phong material
-  //! and evaluating it with a call to `Material::Eval()`
+  //! \brief Illuminate a hit point by evaluating its Phong material
+  //! with a call to `PhongMaterial::Evaluate()`
   //! \param[in] hit_record Hit record for the point
+  //! \param[in] material Hit surface's material (see MaterialTable)
   //! \param[in] view_vec View vector (points away from the surface)
+  //! \param[in] scene Scene, for shadow rays
   //! \return Total radiance leaving the point in the direction of
   //!         view_vec
   /*
   Vec3r Illuminate_orig(const HitRecord &hit_record, const Vec3r &view_vec) const override;
   */
 
-  Vec3r Illuminate(const HitRecord &hit_record, const Vec3r &view_vec, Surface::Ptr scene) const override;
+  Vec3r Illuminate(const HitRecord &hit_record,
+                   const MaterialParams &material,
+                   const Vec3r &view_vec,
+                   const Surface::Ptr &scene) const override;
 
   //! \brief Set light's position
   //! \param[in] position Light position
@@ -129,5 +146,6 @@ protected:
   Vec3r intensity_{0, 0, 0};  //!< light intensity
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -14,6 +14,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 Material::Material(const std::string &name) :
   Node{}
@@ -21,5 +22,14 @@ Material::Material(const std::string &name) :
   name_ = name.size() ? name : "Material";
 }
 
+
+bool
+Material::GetParams(MaterialParams &params) const
+{
+  params = MaterialParams{};
+  return false;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include "core/types.h"
@@ -18,18 +19,47 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class Ray;
 class HitRecord;
 
+//! \brief Kind of material described by MaterialParams
+enum class MaterialType : uint8_t {
+  kNone,        //!< no material; shades black
+  kPhong,       //!< PhongMaterial
+  kDielectric   //!< PhongDielectric
+};
+
+
+//! \struct MaterialParams
+//! \brief Plain copy of a material's parameters, dispatched on its
+//! type, so that shading needs no RTTI or reference counting (see
+//! MaterialTable)
+struct MaterialParams {
+  MaterialType type{MaterialType::kNone};  //!< material kind
+  Vec3r ambient{0, 0, 0};   //!< Phong ambient coefficients
+  Vec3r diffuse{0, 0, 0};   //!< Phong diffuse coefficients; dielectric attenuation
+  Vec3r specular{0, 0, 0};  //!< Phong specular coefficients
+  Vec3r mirror{0, 0, 0};    //!< Phong mirror coefficients
+  Real shininess{1};        //!< Phong exponent
+  Real ior{1};              //!< dielectric index of refraction
+};
+
 //! \class Material
 //! \brief Material class
 class Material : public Node {
 public:
   OLIO_NODE(Material)
   explicit Material(const std::string &name=std::string());
+
+  //! \brief Get the material's parameters for shading
+  //! \param[out] params Material parameters
+  //! \return False if the material cannot be shaded
+  virtual bool GetParams(MaterialParams &params) const;
 protected:
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -0,0 +1,63 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       material_table.cc
+//! \brief      MaterialTable class
+//! \author     Stephanie Jung, 2025
+
+#include "core/material/material_table.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+constexpr uint32_t MaterialTable::kNoMaterial;
+
+
+MaterialTable::MaterialTable() :
+  params_(1),
+  materials_(1)
+{
+}
+
+
+uint32_t
+MaterialTable::Add(const Material::Ptr &material)
+{
+  if (!material)
+    return kNoMaterial;
+  auto it = ids_.find(material.get());
+  if (it != ids_.end())
+    return it->second;
+
+  MaterialParams params;
+  uint32_t id = kNoMaterial;
+  if (material->GetParams(params)) {
+    id = static_cast<uint32_t>(params_.size());
+    params_.push_back(params);
+    materials_.push_back(material);
+  }
+  ids_.emplace(material.get(), id);
+  return id;
+}
+
+
+void
+MaterialTable::Update()
+{
+  for (size_t id = kNoMaterial + 1; id < params_.size(); ++id) {
+    MaterialParams params;
+    if (materials_[id]->GetParams(params))
+      params_[id] = params;
+  }
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,65 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       material_table.h
+//! \brief      MaterialTable class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "core/types.h"
+#include "core/material/material.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \class MaterialTable
+//! \brief Compact array of the scene's materials as MaterialParams,
+//! indexed by the material id stored with each surface (see
+//! Surface::SetMaterialId())
+//! \details Shading looks materials up by id and dispatches on
+//! MaterialParams::type, instead of casting the surface's shared
+//! Material. Entry kNoMaterial is a kNone material.
+class MaterialTable {
+public:
+  //! \brief Constructor; creates a table holding only kNoMaterial
+  MaterialTable();
+
+  //! \brief Add a material, or find it if it was added before
+  //! \param[in] material Material to add; may be null
+  //! \return Material id; kNoMaterial for null or unshadeable materials
+  uint32_t Add(const Material::Ptr &material);
+
+  //! \brief Re-read the parameters of every added material, so that
+  //!        edits made after Add() are shaded
+  void Update();
+
+  //! \brief Get a material's parameters
+  //! \param[in] id Material id; out-of-range ids give kNoMaterial
+  //! \return Material parameters
+  inline const MaterialParams& Get(uint32_t id) const {
+    return id < params_.size() ? params_[id] : params_[kNoMaterial];
+  }
+
+  //! \brief Get the number of materials, including kNoMaterial
+  //! \return Number of materials
+  inline size_t GetSize() const {return params_.size();}
+
+  static constexpr uint32_t kNoMaterial = 0;  //!< id of surfaces without material
+protected:
+  std::vector<MaterialParams> params_;                 //!< parameters by id
+  std::vector<Material::Ptr> materials_;               //!< materials by id
+  std::unordered_map<const Material*, uint32_t> ids_;  //!< ids of added materials
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -19,6 +19,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 
@@ -40,7 +41,7 @@ Real PhongDielectric::SchlicksReflectance(Real cos_theta, Real ior_in, Real ior_
     Real r0 = (1.0f - ratio)/(1.0+ratio);
     Real r0_sq = r0*r0;*/
     Real R0 = ((ior_out - ior_in)/(ior_out+ior_in))*((ior_out - ior_in)/(ior_out+ior_in));
-    Real schlick = R0 + (1-R0)*pow(1-cos_theta, 5);
+    Real schlick = R0 + (1-R0)*static_cast<Real>(pow(1-cos_theta, 5));
     //Real schlick = r0_sq + (1.0f-r0_sq)* static_cast<Real>(pow(1-cos_theta,5));
     return schlick;
 }
@@ -50,11 +51,23 @@ Vec3r PhongDielectric::Scatter( const HitRecord &hit_record,
                                 std::shared_ptr<Ray> &reflect_ray, 
                                 std::shared_ptr<Ray> &refract_ray, 
                                 Real &schlick_reflectance) const{
-    //std::cout << "ior: " << ior_ << std::endl;
-    //std::cout << "attenuation: " << attenuation_.transpose() << std::endl;
-    
+    MaterialParams params;
+    PhongDielectric::GetParams(params);
+    Ray reflect, refract;
+    bool refracted = Scatter(params, hit_record, ray_in, reflect, refract,
+                             schlick_reflectance);
+    reflect_ray = std::make_shared<Ray>(reflect);
+    refract_ray = refracted ? std::make_shared<Ray>(refract) : nullptr;
+    return params.diffuse;
+}
+
+
+bool PhongDielectric::Scatter(const MaterialParams &params,
+                              const HitRecord &hit_record, const Ray &ray_in,
+                              Ray &reflect_ray, Ray &refract_ray,
+                              Real &schlick_reflectance){
     Real n1 = 1.0; //index of refraction of air
-    Real n2 = ior_;
+    Real n2 = params.ior;
     
     if (!hit_record.IsFrontFace()){
         std::swap(n1, n2); //if exiting surface, swap
@@ -64,8 +77,8 @@ Vec3r PhongDielectric::Scatter( const HitRecord &hit_record,
     Vec3r d = ray_in.GetDirection().normalized();
     Vec3r N = hit_record.GetNormal().normalized();
     Real d_dot_N = N.dot(d);
-    Real cos_theta_i = std::min(N.dot(-d), 1.0); //theta angle of incidence
-    Real sin_theta_i = std::sqrt(1.0 - (cos_theta_i*cos_theta_i));
+    Real cos_theta_i = std::min(N.dot(-d), static_cast<Real>(1)); //theta angle of incidence
+    Real sin_theta_i = std::sqrt(1 - (cos_theta_i*cos_theta_i));
         
     //Refract the ray
     //d is incident ray/ray in
@@ -74,23 +87,31 @@ Vec3r PhongDielectric::Scatter( const HitRecord &hit_record,
     //n2 is n_t 
     Real ratio = n1/n2;
     Real sin_phi = ratio*sin_theta_i;
-    if (sin_phi > 1){
+    bool refracted = sin_phi <= 1;
+    if (!refracted){
         //This means there is total internal reflection
-        refract_ray = nullptr;
         schlick_reflectance = 1.0; //everything is reflected
     }
     else{
-        //Real d_dot_N = d.dot(N);
         Real temp = 1 - ratio*ratio * (1-d_dot_N*d_dot_N);
         Vec3r t = ratio * (d - d_dot_N * N) - std::sqrt(temp)*N;
 
-        refract_ray = std::make_shared<Ray>(hit_record.GetPoint(), t);
+        refract_ray = Ray(hit_record.GetPoint(), t);
         schlick_reflectance = SchlicksReflectance(cos_theta_i, n1, n2); //how much of the light is reflected
     }
-    reflect_ray = std::make_shared<Ray>(hit_record.GetPoint(), (d - 2 * d_dot_N * N));
-    return GetDiffuse();
+    reflect_ray = Ray(hit_record.GetPoint(), (d - 2 * d_dot_N * N));
+    return refracted;
+}
+
+
+bool PhongDielectric::GetParams(MaterialParams &params) const{
+    PhongMaterial::GetParams(params);
+    params.type = MaterialType::kDielectric;
+    params.ior = ior_;
+    return true;
 }
 
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
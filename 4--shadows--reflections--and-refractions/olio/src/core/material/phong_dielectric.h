@@ -21,6 +21,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class Light;
 class AmbientLight;
@@ -61,13 +62,33 @@ public:
         std::shared_ptr<Ray> &refract_ray, 
         Real &schlick_reflectance) const;
 
+    //! \brief Scatter incoming ray ray_in off dielectric parameters;
+    //!        see the member Scatter()
+    //! \param[in] params Material parameters
+    //! \param[in] hit_record Hit record at hit point
+    //! \param[in] ray_in Incoming ray that hit the point
+    //! \param[out] reflect_ray Reflected ray
+    //! \param[out] refract_ray Refracted ray; unset if not refracted
+    //! \param[out] schlick_reflectance Schlick's reflectance
+    //! \return True if the ray was refracted (no total internal reflection)
+    static bool Scatter(const MaterialParams &params,
+                        const HitRecord &hit_record, const Ray &ray_in,
+                        Ray &reflect_ray, Ray &refract_ray,
+                        Real &schlick_reflectance);
+
     static Real SchlicksReflectance(Real cos_theta, Real ior_in, Real ior_out);
 
+    //! \brief Get the material's parameters for shading
+    //! \param[out] params Material parameters
+    //! \return True
+    bool GetParams(MaterialParams &params) const override;
+
 
 protected:
     Real ior_{1};
     Vec3r attenuation_{1,1,1};
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
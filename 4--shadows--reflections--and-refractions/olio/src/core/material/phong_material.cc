@@ -10,11 +10,14 @@
 //! \author     Hadi Fadaifard, 2022
 
 #include "core/material/phong_material.h"
+#include <algorithm>
+#include <cmath>
 #include <spdlog/spdlog.h>
 #include "core/light/light.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 
@@ -56,6 +59,17 @@ Vec3r Reflect(const Vec3r &v, const Vec3r &normal)
 Vec3r
 PhongMaterial::Evaluate(const HitRecord &hit_record, const Vec3r &light_vec,
                         const Vec3r &view_vec) const
+{
+  MaterialParams params;
+  PhongMaterial::GetParams(params);
+  return Evaluate(params, hit_record, light_vec, view_vec);
+}
+
+
+Vec3r
+PhongMaterial::Evaluate(const MaterialParams &params,
+                        const HitRecord &hit_record, const Vec3r &light_vec,
+                        const Vec3r &view_vec)
 {
   if (!hit_record.IsFrontFace()){
     //Then the camera is seeing the back face of the object
@@ -65,17 +79,32 @@ PhongMaterial::Evaluate(const HitRecord &hit_record, const Vec3r &light_vec,
   // Blinn-Phong halfway vector formulation
   const Vec3r &normal = hit_record.GetNormal();
   Vec3r half = (view_vec + light_vec).normalized();
-  auto half_dot = fmax(0, half.dot(normal));
-  Real specular_falloff = pow(half_dot, shininess_);
+  auto half_dot = std::max(static_cast<Real>(0), half.dot(normal));
+  Real specular_falloff = std::pow(half_dot, params.shininess);
 
   // // phong
   // Vec3r reflect = Reflect(-light_vec, normal);
   // auto reflect_dot = fmax(0, reflect.dot(view_vec));
   // specular_falloff = pow(reflect_dot, shininess_);
 
-  Vec3r specular_color = specular_falloff * specular_;
-  return specular_color + diffuse_;
+  Vec3r specular_color = specular_falloff * params.specular;
+  return specular_color + params.diffuse;
+}
+
+
+bool
+PhongMaterial::GetParams(MaterialParams &params) const
+{
+  params = MaterialParams{};
+  params.type = MaterialType::kPhong;
+  params.ambient = ambient_;
+  params.diffuse = diffuse_;
+  params.specular = specular_;
+  params.mirror = mirror_;
+  params.shininess = shininess_;
+  return true;
 }
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
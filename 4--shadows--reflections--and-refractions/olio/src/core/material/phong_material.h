@@ -20,6 +20,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class Light;
 class AmbientLight;
@@ -56,6 +57,22 @@ public:
   Vec3r Evaluate(const HitRecord &hit_record, const Vec3r &light_vec,
                  const Vec3r &view_vec) const;
 
+  //! \brief Evaluate Phong material parameters; see the member
+  //!        Evaluate()
+  //! \param[in] params Material parameters
+  //! \param[in] hit_record Hit record at hit point
+  //! \param[in] light_vec light vector (unit length)
+  //! \param[in] view_vec view vector (unit length)
+  //! \return Evaluated color at hit point
+  static Vec3r Evaluate(const MaterialParams &params,
+                        const HitRecord &hit_record, const Vec3r &light_vec,
+                        const Vec3r &view_vec);
+
+  //! \brief Get the material's parameters for shading
+  //! \param[out] params Material parameters
+  //! \return True
+  bool GetParams(MaterialParams &params) const override;
+
   //! \brief Set ambient coefficients
   //! \param[in] ambient Ambient coefficients
   void SetAmbient(const Vec3r &ambient) {ambient_ = ambient;}
@@ -103,5 +120,6 @@ protected:
   Vec3r mirror_{0, 0, 0};       //!< mirror coefficients
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -21,6 +21,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 // forward declarations
 class Node;
@@ -122,5 +123,6 @@ bool operator<(const Node::Ptr &a, const Node::Ptr &b);
 //! \return true if a < b
 bool operator<(const Node::WeakPtr &a, const Node::WeakPtr &b);
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
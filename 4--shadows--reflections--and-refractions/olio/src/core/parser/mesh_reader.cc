@@ -0,0 +1,225 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       mesh_reader.cc
+//! \brief      MeshReader class
+//! \author     Stephanie Jung, 2025
+
+#include "core/parser/mesh_reader.h"
+#include <limits>
+#include <map>
+#include <OpenMesh/Core/IO/MeshIO.hh>
+#include <OpenMesh/Core/IO/importer/BaseImporter.hh>
+#include <boost/filesystem.hpp>
+#include <spdlog/spdlog.h>
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+namespace {
+
+// OpenMesh importer that appends vertices and triangles straight to
+// flat arrays. No half-edge mesh is built, so degenerate and
+// non-manifold faces are kept as the file gives them. Polygons are
+// triangulated as fans. Attributes other than positions are ignored.
+class ArrayImporter : public OpenMesh::IO::BaseImporter {
+public:
+  using VertexHandle = OpenMesh::VertexHandle;
+  using HalfedgeHandle = OpenMesh::HalfedgeHandle;
+  using EdgeHandle = OpenMesh::EdgeHandle;
+  using FaceHandle = OpenMesh::FaceHandle;
+  using StatusInfo = OpenMesh::Attributes::StatusInfo;
+
+  ArrayImporter(vector<Vec3r> &vertices, vector<uint32_t> &indices) :
+    vertices_{vertices}, indices_{indices} {}
+
+  // vertices
+  VertexHandle add_vertex(const OpenMesh::Vec3f &point)
+  {
+    return AddVertex(point[0], point[1], point[2]);
+  }
+  VertexHandle add_vertex(const OpenMesh::Vec3d &point)
+  {
+    return AddVertex(point[0], point[1], point[2]);
+  }
+  VertexHandle add_vertex()
+  {
+    return AddVertex(0, 0, 0);
+  }
+  void set_point(VertexHandle vh, const OpenMesh::Vec3f &point)
+  {
+    SetPoint(vh, point[0], point[1], point[2]);
+  }
+  void set_point(VertexHandle vh, const OpenMesh::Vec3d &point)
+  {
+    SetPoint(vh, point[0], point[1], point[2]);
+  }
+  VertexHandle vertex_handle(unsigned int i) const
+  {
+    return i < vertices_.size() ? VertexHandle(static_cast<int>(i)) :
+      VertexHandle();
+  }
+
+  // faces; the returned handle is the face's first triangle
+  FaceHandle add_face(const VHandles &face)
+  {
+    return add_face(face.data(), face.size());
+  }
+  FaceHandle add_face(const VertexHandle *face, size_t count)
+  {
+    if (count < 3) {
+      ++skipped_faces_;
+      return FaceHandle();
+    }
+    for (size_t i = 0; i < count; ++i) {
+      if (!face[i].is_valid() ||
+          static_cast<size_t>(face[i].idx()) >= vertices_.size()) {
+        ++skipped_faces_;
+        return FaceHandle();
+      }
+    }
+    auto first = FaceHandle(static_cast<int>(n_faces()));
+    for (size_t i = 1; i + 1 < count; ++i) {
+      indices_.push_back(static_cast<uint32_t>(face[0].idx()));
+      indices_.push_back(static_cast<uint32_t>(face[i].idx()));
+      indices_.push_back(static_cast<uint32_t>(face[i + 1].idx()));
+    }
+    return first;
+  }
+
+  // ignored attributes
+  void add_face_texcoords(FaceHandle, VertexHandle,
+                          const vector<OpenMesh::Vec2f> &) {}
+  void add_face_texcoords(FaceHandle, VertexHandle,
+                          const vector<OpenMesh::Vec3f> &) {}
+  void set_face_texindex(FaceHandle, int) {}
+  void set_normal(VertexHandle, const OpenMesh::Vec3f &) {}
+  void set_normal(VertexHandle, const OpenMesh::Vec3d &) {}
+  void set_normal(FaceHandle, const OpenMesh::Vec3f &) {}
+  void set_normal(FaceHandle, const OpenMesh::Vec3d &) {}
+  void set_color(VertexHandle, const OpenMesh::Vec4uc &) {}
+  void set_color(VertexHandle, const OpenMesh::Vec3uc &) {}
+  void set_color(VertexHandle, const OpenMesh::Vec4f &) {}
+  void set_color(VertexHandle, const OpenMesh::Vec3f &) {}
+  void set_color(EdgeHandle, const OpenMesh::Vec4uc &) {}
+  void set_color(EdgeHandle, const OpenMesh::Vec3uc &) {}
+  void set_color(EdgeHandle, const OpenMesh::Vec4f &) {}
+  void set_color(EdgeHandle, const OpenMesh::Vec3f &) {}
+  void set_color(FaceHandle, const OpenMesh::Vec4uc &) {}
+  void set_color(FaceHandle, const OpenMesh::Vec3uc &) {}
+  void set_color(FaceHandle, const OpenMesh::Vec4f &) {}
+  void set_color(FaceHandle, const OpenMesh::Vec3f &) {}
+  void set_texcoord(VertexHandle, const OpenMesh::Vec2f &) {}
+  void set_texcoord(VertexHandle, const OpenMesh::Vec3f &) {}
+  void set_texcoord(HalfedgeHandle, const OpenMesh::Vec2f &) {}
+  void set_texcoord(HalfedgeHandle, const OpenMesh::Vec3f &) {}
+  void set_texcoord(const OpenMesh::Vec2f &) {}
+  void set_texcoord(const OpenMesh::Vec3f &) {}
+  void set_status(VertexHandle, const StatusInfo &) {}
+  void set_status(HalfedgeHandle, const StatusInfo &) {}
+  void set_status(EdgeHandle, const StatusInfo &) {}
+  void set_status(FaceHandle, const StatusInfo &) {}
+  void add_texture_information(map<int, string> &) {}
+
+  // sizes, in triangles for faces; readers compare n_faces() before
+  // and after add_face to find the triangles a polygon became
+  size_t n_vertices() const {return vertices_.size();}
+  size_t n_faces() const {return indices_.size() / 3;}
+  size_t n_edges() const {return 0;}
+  bool is_triangle_mesh() const {return true;}
+  void reserve(unsigned int vertex_count, unsigned int /*edge_count*/,
+               unsigned int face_count)
+  {
+    vertices_.reserve(vertex_count);
+    indices_.reserve(3 * static_cast<size_t>(face_count));
+  }
+
+  size_t GetSkippedFaces() const {return skipped_faces_;}
+private:
+  VertexHandle AddVertex(double x, double y, double z)
+  {
+    if (vertices_.size() >= numeric_limits<uint32_t>::max())
+      return VertexHandle();
+    vertices_.push_back(Vec3r{static_cast<Real>(x), static_cast<Real>(y),
+                              static_cast<Real>(z)});
+    return VertexHandle(static_cast<int>(vertices_.size() - 1));
+  }
+  void SetPoint(VertexHandle vh, double x, double y, double z)
+  {
+    if (vh.is_valid() && static_cast<size_t>(vh.idx()) < vertices_.size())
+      vertices_[static_cast<size_t>(vh.idx())] =
+        Vec3r{static_cast<Real>(x), static_cast<Real>(y),
+              static_cast<Real>(z)};
+  }
+
+  vector<Vec3r> &vertices_;
+  vector<uint32_t> &indices_;
+  size_t skipped_faces_ = 0;
+};
+
+}  // namespace
+
+
+bool
+MeshReader::ReadFile(const std::string &filename, vector<Vec3r> &vertices,
+                     vector<uint32_t> &indices)
+{
+  vertices.clear();
+  indices.clear();
+  if (!fs::exists(filename)) {
+    spdlog::error("MeshReader::ReadFile: file {} does not exist", filename);
+    return false;
+  }
+
+  ArrayImporter importer{vertices, indices};
+  OpenMesh::IO::Options options;
+  if (!OpenMesh::IO::IOManager().read(filename, importer, options)) {
+    spdlog::error("MeshReader::ReadFile: could not read mesh file {}",
+                  filename);
+    vertices.clear();
+    indices.clear();
+    return false;
+  }
+  if (vertices.size() >= numeric_limits<uint32_t>::max()) {
+    spdlog::error("MeshReader::ReadFile: {} has too many vertices",
+                  filename);
+    vertices.clear();
+    indices.clear();
+    return false;
+  }
+  if (importer.GetSkippedFaces())
+    spdlog::warn("MeshReader::ReadFile: skipped {} faces with fewer than "
+                 "three valid vertices in {}", importer.GetSkippedFaces(),
+                 filename);
+  spdlog::info("Read {} vertices and {} triangles from {}", vertices.size(),
+               indices.size() / 3, filename);
+  return true;
+}
+
+
+TriangleMesh::Ptr
+MeshReader::ReadFile(const std::string &filename)
+{
+  vector<Vec3r> vertices;
+  vector<uint32_t> indices;
+  if (!ReadFile(filename, vertices, indices))
+    return nullptr;
+  if (!indices.size()) {
+    spdlog::warn("MeshReader::ReadFile: {} has no faces", filename);
+    return nullptr;
+  }
+  return TriangleMesh::Create(vertices, indices,
+                              fs::path(filename).filename().string());
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
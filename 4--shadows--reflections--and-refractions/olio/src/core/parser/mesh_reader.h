@@ -0,0 +1,50 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       mesh_reader.h
+//! \brief      MeshReader class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "core/types.h"
+#include "core/geometry/triangle_mesh.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \class MeshReader
+//! \brief Reads OBJ, PLY, OFF and STL meshes through OpenMesh
+//! \details OpenMesh's readers parse the file into an importer that
+//! appends directly to flat vertex and index arrays; no half-edge mesh
+//! is built, so faces are kept exactly as the file gives them.
+//! Polygons are triangulated as fans. No per-triangle surfaces are
+//! created: ReadFile returns a single TriangleMesh.
+class MeshReader {
+public:
+  //! \brief Read a mesh file into vertex and index arrays
+  //! \param[in] filename Mesh file; the format is chosen by extension
+  //! \param[out] vertices Vertex positions
+  //! \param[out] indices Three vertex indices per triangle
+  //! \return True on success
+  static bool ReadFile(const std::string &filename,
+                       std::vector<Vec3r> &vertices,
+                       std::vector<uint32_t> &indices);
+
+  //! \brief Read a mesh file into a TriangleMesh
+  //! \param[in] filename Mesh file; the format is chosen by extension
+  //! \return The mesh; nullptr on failure or if the file has no triangles
+  static TriangleMesh::Ptr ReadFile(const std::string &filename);
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -1,6 +1,9 @@
 #include "raytra_parser.h"
 #include <fstream>
+#include <map>
+#include <memory>
 #include <sstream>
+#include <unordered_map>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <spdlog/spdlog.h>
@@ -8,23 +11,92 @@
 #include "core/geometry/sphere.h"
 #include "core/camera/camera.h"
 #include "core/geometry/triangle.h"
-#include "core/geometry/surface_list.h"
+#include "core/geometry/triangle_mesh.h"
+#include "core/geometry/accelerator.h"
+#include "core/geometry/accelerator_cache.h"
+#include "core/geometry/instance.h"
 #include "core/light/light.h"
 #include "core/material/phong_material.h"
 #include "core/material/phong_dielectric.h"
+#include "core/parser/mesh_reader.h"
 
 #include <iostream>
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 using boost::algorithm::trim;
 namespace fs = boost::filesystem;
 
+namespace {
+
+// triangles read since the last material or group change, when
+// merging is requested; they are merged into one TriangleMesh that
+// stores each distinct point once. Scene-level accelerators see such
+// a mesh as a single surface
+class MeshBuilder {
+public:
+  void AddTriangle(const Vec3r points[3]) {
+    for (int i = 0; i < 3; ++i) {
+      auto inserted = vertex_indices_.emplace(
+        points[i], static_cast<uint32_t>(vertices_.size()));
+      if (inserted.second)
+        vertices_.push_back(points[i]);
+      indices_.push_back(inserted.first->second);
+    }
+  }
+
+  // append the pending triangles to 'surfaces' as a mesh, or as a
+  // Triangle if there is only one, and start over; returns the number
+  // of triangles merged into a mesh
+  size_t Flush(Material::Ptr material, uint32_t material_id,
+               vector<Surface::Ptr> &surfaces) {
+    size_t triangle_count = indices_.size() / 3;
+    Surface::Ptr surface;
+    if (triangle_count == 1) {
+      surface = Triangle::Create(vertices_);
+    } else if (triangle_count > 1) {
+      surface = TriangleMesh::Create(vertices_, indices_);
+    }
+    if (surface) {
+      surface->SetMaterial(material);
+      surface->SetMaterialId(material_id);
+      surfaces.push_back(surface);
+    }
+    vector<Vec3r>().swap(vertices_);
+    vector<uint32_t>().swap(indices_);
+    PointMap().swap(vertex_indices_);
+    return triangle_count > 1 ? triangle_count : 0;
+  }
+protected:
+  struct PointHash {
+    size_t operator()(const Vec3r &point) const {
+      size_t hash = 0;
+      for (int i = 0; i < 3; ++i)
+        hash = hash * 31 + std::hash<Real>()(point[i]);
+      return hash;
+    }
+  };
+  using PointMap = unordered_map<Vec3r, uint32_t, PointHash>;
+
+  vector<Vec3r> vertices_;
+  vector<uint32_t> indices_;
+  PointMap vertex_indices_;
+};
+
+}  // namespace
+
+
 bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
                              std::vector<Light::Ptr> &lights,
-                             Camera::Ptr &camera, Vec2i &image_size)
+                             Camera::Ptr &camera, Vec2i &image_size,
+                             MaterialTable &materials,
+                             AcceleratorType accel_type,
+                             const std::string &cache_dir,
+                             bool report_cache_misses,
+                             bool merge_triangles)
 {
   // get absoulte file path
   fs::path filepath(filename);
@@ -46,14 +118,74 @@ bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
                   "for reading", filename);
     return false;
   }
+  // acceleration structures depend on everything but the camera and
+  // the lights, so the cache key skips them: cached structures are
+  // reused when only the view or the lighting changes
+  unique_ptr<AcceleratorCache> cache;
+  if (cache_dir.size()) {
+    auto accel_value = static_cast<int>(accel_type);
+    auto real_size = static_cast<int>(sizeof(Real));
+    uint64_t key = AcceleratorCache::Hash(&accel_value, sizeof(accel_value));
+    key = AcceleratorCache::Hash(&real_size, sizeof(real_size), key);
+    auto merge_value = static_cast<int>(merge_triangles);
+    key = AcceleratorCache::Hash(&merge_value, sizeof(merge_value), key);
+    ifstream key_in(filename);
+    for (string line; getline(key_in, line);) {
+      trim(line);
+      if (!line.size() || line[0] == '/' || line[0] == 'c' || line[0] == 'l')
+        continue;
+      line.push_back('\n');
+      key = AcceleratorCache::Hash(line.data(), line.size(), key);
+
+      // mesh files are identified by their size and modification time
+      if (line[0] == 'w') {
+        string mesh_name;
+        istringstream(line.substr(1)) >> mesh_name;
+        fs::path mesh_path(mesh_name);
+        if (!mesh_path.is_absolute())
+          mesh_path = path_prefix / mesh_path;
+        boost::system::error_code error;
+        int64_t stamp[2] = {
+          static_cast<int64_t>(fs::file_size(mesh_path, error)),
+          static_cast<int64_t>(fs::last_write_time(mesh_path, error))};
+        key = AcceleratorCache::Hash(stamp, sizeof(stamp), key);
+      }
+    }
+    cache.reset(new AcceleratorCache(cache_dir, key));
+  }
+
+  // the parser owns the surfaces, so hierarchies may copy them into
+  // leaf order
+  AcceleratorOptions accel_options;
+  accel_options.cache = cache.get();
+  accel_options.reorder_primitives = true;
+  accel_options.report_cache_misses = report_cache_misses;
+
   int camera_count = 0;
   int ambient_count = 0;
   int light_count = 0;
   int material_count = 0;
   vector<Surface::Ptr> surfaces;
 
-  // current material that's applied to the next read surface
+  // named groups of surfaces that can be placed many times; while a
+  // group is being defined, surfaces are added to it instead of the scene
+  map<string, Surface::Ptr> groups;
+  string group_name;
+  vector<Surface::Ptr> group_surfaces;
+  vector<Surface::Ptr> *target_surfaces = &surfaces;
+  int instance_count = 0;
+
+  // if requested, consecutive triangles with the same material form
+  // meshes; otherwise each triangle is a surface of its own
+  MeshBuilder mesh_builder;
+  size_t mesh_triangle_count = 0;
+  int mesh_file_count = 0;
+
+  // current material that's applied to the next read surface, and its
+  // id in the material table
   PhongMaterial::Ptr current_material;
+  uint32_t current_material_id = MaterialTable::kNoMaterial;
+  materials = MaterialTable();
 
   // parse file
   for (string line; getline(in, line);) {
@@ -84,7 +216,8 @@ bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
           return false;
         }
         sphere->SetMaterial(current_material);
-        surfaces.push_back(sphere);
+        sphere->SetMaterialId(current_material_id);
+        target_surfaces->push_back(sphere);
         break;
       }
     case 'c':
@@ -135,12 +268,17 @@ bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
         // phong material
         Real dr, dg, db, sr, sg, sb, shininess, ir, ig, ib;
         iss >> dr >> dg >> db >> sr >> sg >> sb >> shininess >> ir >> ig >> ib;
-        Vec3r ambient{fmax(0.01, dr), fmax(0.01, dg), fmax(0.01, db)};
+        const auto min_ambient = static_cast<Real>(0.01);
+        Vec3r ambient{fmax(min_ambient, dr), fmax(min_ambient, dg),
+                      fmax(min_ambient, db)};
         Vec3r diffuse{dr, dg, db};
         Vec3r specular{sr, sg, sb};
         Vec3r mirror{ir, ig, ib};
+        mesh_triangle_count += mesh_builder.Flush(
+          current_material, current_material_id, *target_surfaces);
         current_material = PhongMaterial::Create(ambient, diffuse, specular,
                                                  shininess, mirror);
+        current_material_id = materials.Add(current_material);
         ++material_count;
         break;
       }
@@ -151,7 +289,10 @@ bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
         iss >> ior >> dr >> dg >> db;
         Real index_of_refr{ior};
         Vec3r attenuation{dr, dg, db};
+        mesh_triangle_count += mesh_builder.Flush(
+          current_material, current_material_id, *target_surfaces);
         current_material = PhongDielectric::Create(index_of_refr, attenuation);
+        current_material_id = materials.Add(current_material);
         //std::cout << "ior: " << index_of_refr << std::endl;
         //std::cout << "attenuation: " << attenuation.transpose() << std::endl;
         ++material_count;
@@ -162,21 +303,126 @@ bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
         // triangle
         Real ax, ay, az, bx, by, bz, cx, cy, cz;
         iss >> ax >> ay >> az >> bx >> by >> bz >> cx >> cy >> cz;
-        vector<Vec3r> points;
-        points.reserve(3);
-        points.push_back(Vec3r{ax, ay, az});
-        points.push_back(Vec3r{bx, by, bz});
-        points.push_back(Vec3r{cx, cy, cz});
-        auto triangle = Triangle::Create(points);
+        Vec3r points[3] = {Vec3r{ax, ay, az}, Vec3r{bx, by, bz},
+                           Vec3r{cx, cy, cz}};
 
-        // set material
         if (!current_material) {
           spdlog::error("Invalid scene file: cannot find matching material "
                         "for surface: {}", line);
           return false;
         }
+
+        // a merged triangle's material is set when the mesh is complete
+        if (merge_triangles) {
+          mesh_builder.AddTriangle(points);
+          break;
+        }
+        auto triangle = Triangle::Create(vector<Vec3r>(points, points + 3));
         triangle->SetMaterial(current_material);
-        surfaces.push_back(triangle);
+        triangle->SetMaterialId(current_material_id);
+        target_surfaces->push_back(triangle);
+        break;
+      }
+    case 'w':
+      {
+        // mesh file: w filename, relative to the scene file
+        string mesh_name;
+        iss >> mesh_name;
+        if (!current_material) {
+          spdlog::error("Invalid scene file: cannot find matching material "
+                        "for surface: {}", line);
+          return false;
+        }
+        fs::path mesh_path(mesh_name);
+        if (!mesh_path.is_absolute())
+          mesh_path = path_prefix / mesh_path;
+        auto mesh = MeshReader::ReadFile(mesh_path.string());
+        if (!mesh) {
+          spdlog::error("Invalid scene file: cannot read mesh: {}", line);
+          return false;
+        }
+        mesh->SetMaterial(current_material);
+        mesh->SetMaterialId(current_material_id);
+        target_surfaces->push_back(mesh);
+        ++mesh_file_count;
+        break;
+      }
+    case 'g':
+      {
+        // begin group definition: g name
+        if (group_name.size()) {
+          spdlog::error("Invalid scene file: group {} is not ended before "
+                        "group definition: {}", group_name, line);
+          return false;
+        }
+        iss >> group_name;
+        if (!group_name.size() || groups.count(group_name)) {
+          spdlog::error("Invalid scene file: missing or duplicate group "
+                        "name: {}", line);
+          return false;
+        }
+        mesh_triangle_count += mesh_builder.Flush(
+          current_material, current_material_id, *target_surfaces);
+        group_surfaces.clear();
+        target_surfaces = &group_surfaces;
+        break;
+      }
+    case 'e':
+      {
+        // end group definition; the group's surfaces get their own
+        // acceleration structure, shared by all of its instances
+        if (!group_name.size()) {
+          spdlog::error("Invalid scene file: group end without group "
+                        "definition: {}", line);
+          return false;
+        }
+        mesh_triangle_count += mesh_builder.Flush(
+          current_material, current_material_id, group_surfaces);
+        groups[group_name] = CreateAccelerator(group_surfaces, accel_type,
+                                               accel_options);
+        spdlog::info("Defined group {} with {} surface(s)", group_name,
+                     group_surfaces.size());
+        group_name.clear();
+        group_surfaces.clear();
+        target_surfaces = &surfaces;
+        break;
+      }
+    case 'i':
+      {
+        // group instance: i name tx ty tz, or i name followed by the
+        // 12 entries of a row-major 3x4 affine transform
+        string name;
+        iss >> name;
+        auto group = groups.find(name);
+        if (group == groups.end()) {
+          spdlog::error("Invalid scene file: instance of undefined group: {}",
+                        line);
+          return false;
+        }
+        vector<Real> values;
+        for (Real value; iss >> value;)
+          values.push_back(value);
+        Mat4r transform = Mat4r::Identity();
+        if (values.size() == 3) {
+          transform.topRightCorner<3, 1>() = Vec3r{values[0], values[1],
+                                                   values[2]};
+        } else if (values.size() == 12) {
+          for (uint row = 0; row < 3; ++row)
+            for (uint col = 0; col < 4; ++col)
+              transform(row, col) = values[row * 4 + col];
+        } else {
+          spdlog::error("Invalid scene file: instance needs a translation "
+                        "or a 3x4 transform: {}", line);
+          return false;
+        }
+        auto instance = Instance::Create(group->second, transform);
+        if (!instance) {
+          spdlog::error("Invalid scene file: instance transform is not "
+                        "invertible: {}", line);
+          return false;
+        }
+        target_surfaces->push_back(instance);
+        ++instance_count;
         break;
       }
     case 'l':
@@ -210,6 +456,8 @@ bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
 
   // close input file
   in.close();
+  mesh_triangle_count += mesh_builder.Flush(
+    current_material, current_material_id, *target_surfaces);
 
   if (camera_count != 1) {
     spdlog::error("Parse error: scene file should contain only one camera");
@@ -222,14 +470,34 @@ bool RaytraParser::ParseFile(const std::string &filename, Surface::Ptr &scene,
     return false;
   }
 
+  if (group_name.size()) {
+    spdlog::error("Parse error: group {} is not ended", group_name);
+    return false;
+  }
+
   if (surfaces.size() < 1)
     spdlog::warn("Scene file does not contain any surfaces");
 
-  scene = SurfaceList::Create(surfaces);
+  if (mesh_triangle_count)
+    spdlog::info("Merged {} triangle(s) into meshes", mesh_triangle_count);
+  if (mesh_file_count)
+    spdlog::info("Read {} mesh file(s)", mesh_file_count);
+
+  // top-level structure over surfaces and group instances
+  scene = CreateAccelerator(surfaces, accel_type, accel_options);
+  if (cache) {
+    spdlog::info("Restored {} acceleration structure(s) from {}",
+                 cache->GetRestoredCount(), cache->GetFileName());
+    cache->Save();
+  }
   spdlog::info("Read {} surface(s), {} material(s), & {} point light(s) ",
                surfaces.size(), material_count, light_count);
+  if (groups.size())
+    spdlog::info("Placed {} instance(s) of {} group(s)", instance_count,
+                 groups.size());
   return true;
 }
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace raytra
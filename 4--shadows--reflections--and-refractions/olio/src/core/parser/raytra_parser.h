@@ -1,20 +1,29 @@
 #pragma once
 
+#include <string>
 #include <vector>
 #include "core/node.h"
 #include "core/geometry/surface.h"
+#include "core/geometry/accelerator.h"
 #include "core/camera/camera.h"
 #include "core/light/light.h"
+#include "core/material/material_table.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class RaytraParser {
 public:
   static bool ParseFile (const std::string &filename, Surface::Ptr &scene,
                          std::vector<Light::Ptr> &lights, Camera::Ptr &camera,
-                         Vec2i &image_size);
+                         Vec2i &image_size, MaterialTable &materials,
+                         AcceleratorType accel_type=AcceleratorType::kBVH,
+                         const std::string &cache_dir=std::string(),
+                         bool report_cache_misses=false,
+                         bool merge_triangles=false);
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -11,9 +11,11 @@
 
 #include "core/ray.h"
 #include <spdlog/spdlog.h>
+#include "core/geometry/surface.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 
@@ -27,10 +29,22 @@ Ray::Ray(const Vec3r &origin, const Vec3r &dir) :
 HitRecord::HitRecord(const Ray &ray, Real ray_t, const Vec3r &point,
                      const Vec3r &face_normal) :
   ray_t_{ray_t},
-  point_{point}
+  point_{point},
+  has_attributes_{true}
 {
   SetNormal(ray, face_normal);
 }
 
+
+void
+HitRecord::ComputeAttributes(const Ray &ray)
+{
+  if (has_attributes_ || !surface_)
+    return;
+  surface_->ComputeHitAttributes(ray, *this);
+  has_attributes_ = true;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -11,12 +11,14 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include "core/types.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 class Surface;
 
@@ -65,7 +67,11 @@ protected:
 //! of information about the point on a surface that was hit by a ray.
 //! \details Information such as hit poisition, surface normal at
 //! that position, whether the normal was facing towards or away
-//! from the ray, the pointer to the surface that was hit, etc.
+//! from the ray, the surface that was hit, etc.
+//! During traversal surfaces only record the hit's t, the hit surface
+//! (a plain pointer, so no reference counting), and the primitive and
+//! UV coordinates within it (SetHit()). Point and normal are computed
+//! once, for the closest hit, by ComputeAttributes().
 class HitRecord {
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -83,6 +89,29 @@ public:
   //! \brief Default constructor
   HitRecord() = default;
 
+  //! \brief Record a hit found during traversal
+  //! \details Invalidates the hit's point and normal; call
+  //!          ComputeAttributes() once the closest hit is known
+  //! \param[in] ray_t Ray's t
+  //! \param[in] surface Surface that was hit
+  //! \param[in] primitive_id Primitive of the surface that was hit
+  //!            (e.g., a mesh triangle); 0 for single primitives
+  //! \param[in] uv UV coordinates of the hit inside the primitive
+  inline void SetHit(Real ray_t, Surface *surface, uint32_t primitive_id=0,
+                     const Vec2r &uv=Vec2r{0, 0}) {
+    ray_t_ = ray_t;
+    surface_ = surface;
+    primitive_id_ = primitive_id;
+    uv_ = uv;
+    has_attributes_ = false;
+  }
+
+  //! \brief Compute point and normal of the recorded hit, if not
+  //!        already done, by calling the hit surface's
+  //!        Surface::ComputeHitAttributes()
+  //! \param[in] ray Ray that hit the surface, in the surface's space
+  void ComputeAttributes(const Ray &ray);
+
   //! \brief Set ray's t (fractional distance) at hit time
   //! \param[in] ray_t Ray's t
   inline void SetRayT(Real ray_t) {ray_t_ = ray_t;}
@@ -120,7 +149,7 @@ public:
 
   //! \brief Set surface that was hit
   //! \param[in] surface Pointer to surface that was hit
-  inline void SetSurface(std::shared_ptr<Surface> surface) {surface_ = surface;}
+  inline void SetSurface(Surface *surface) {surface_ = surface;}
 
   //! \brief Get ray's fractional distance
   //! \return Ray's fractional distance
@@ -139,15 +168,32 @@ public:
   inline bool IsFrontFace() const {return front_face_;}
 
   //! \brief Get hit surface
+  //! \details The record does not own the surface
   //! \return Hit surface
-  inline std::shared_ptr<Surface> GetSurface() const {return surface_;}
+  inline Surface* GetSurface() const {return surface_;}
+
+  //! \brief Get the primitive of the hit surface that was hit
+  //! \return Primitive id
+  inline uint32_t GetPrimitiveId() const {return primitive_id_;}
+
+  //! \brief Get the UV coordinates of the hit inside the primitive
+  //! \return UV coordinates
+  inline Vec2r GetUV() const {return uv_;}
+
+  //! \brief Return whether point and normal have been computed
+  //! \return Whether point and normal are valid
+  inline bool HasAttributes() const {return has_attributes_;}
 protected:
   Real ray_t_{0}; //!< fractional distance along ray (t) that intersects surface
   Vec3r point_{0, 0, 0};   //!< hit point
   Vec3r normal_{0, 0, 0};  //!< surface normal at hit point
+  Vec2r uv_{0, 0};         //!< UV coordinates of the hit inside the primitive
+  Surface *surface_{nullptr};  //!< hit surface; not owned
+  uint32_t primitive_id_{0};   //!< primitive of the hit surface
   bool front_face_{true};  //!< whether hit point was front or back facing
-  std::shared_ptr<Surface> surface_;  //!< pointer to the hit surface
+  bool has_attributes_{false};  //!< whether point and normal are valid
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
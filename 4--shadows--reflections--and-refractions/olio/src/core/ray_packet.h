@@ -0,0 +1,85 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       ray_packet.h
+//! \brief      RayPacket struct
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include "core/types.h"
+#include "core/ray.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \struct RayPacket
+//! \brief Up to 64 rays traced together, e.g. the primary rays of an
+//! 8x8 block of pixels
+//! \details Besides the rays themselves, origins, directions, and
+//!    reciprocal directions are stored one array per component
+//!    (structure of arrays), so per-ray tests can loop over the lanes
+//!    of the packet with SIMD instructions. Sets of lanes are passed
+//!    around as bit masks (bit i is lane i).
+struct RayPacket {
+  static constexpr uint32_t kMaxSize = 64;  //!< maximum number of rays
+
+  //! \brief Remove all rays
+  inline void Clear() {size = 0;}
+
+  //! \brief Append a ray
+  //! \param[in] ray Ray to append; the packet must not be full
+  //! \param[in] ray_tmax Maximum acceptable t of the ray
+  inline void Add(const Ray &ray, Real ray_tmax) {
+    const Vec3r ray_origin = ray.GetOrigin();
+    const Vec3r ray_dir = ray.GetDirection();
+    const Vec3r ray_inv_dir = ray_dir.cwiseInverse();
+    for (int axis = 0; axis < 3; ++axis) {
+      origin[axis][size] = ray_origin[axis];
+      dir[axis][size] = ray_dir[axis];
+      inv_dir[axis][size] = ray_inv_dir[axis];
+    }
+    tmax[size] = ray_tmax;
+    rays[size++] = ray;
+  }
+
+  //! \brief Mask of all rays in the packet
+  //! \return Bit mask with the lowest 'size' bits set
+  inline uint64_t AllMask() const {
+    return size >= 64 ? ~uint64_t(0) : (uint64_t(1) << size) - 1;
+  }
+
+  //! \brief Whether the rays of the packet are coherent enough for
+  //!        packet traversal: all directions have the same, nonzero,
+  //!        sign on each axis
+  //! \return True if the packet can be traversed as a whole
+  bool IsCoherent() const {
+    if (!size)
+      return false;
+    for (int axis = 0; axis < 3; ++axis) {
+      bool is_neg = dir[axis][0] < 0;
+      for (uint32_t lane = 0; lane < size; ++lane)
+        if (!(is_neg ? dir[axis][lane] < 0 : dir[axis][lane] > 0))
+          return false;
+    }
+    return true;
+  }
+
+  Ray rays[kMaxSize];           //!< packet rays
+  Real origin[3][kMaxSize];     //!< ray origins, per axis
+  Real dir[3][kMaxSize];        //!< ray directions, per axis
+  Real inv_dir[3][kMaxSize];    //!< reciprocal directions
+  Real tmax[kMaxSize];          //!< maximum t; closest hit so far
+  Real tmin{kEpsilon};          //!< minimum t of all rays
+  uint32_t size{0};             //!< number of rays
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -11,9 +11,12 @@
 
 #include "core/renderer/raytracer.h"
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <vector>
 #include <boost/filesystem.hpp>
 #include <spdlog/spdlog.h>
+#include "core/ray_packet.h"
 #include "core/geometry/sphere.h"
 #include "core/material/phong_material.h"
 #include "core/material/phong_dielectric.h"
@@ -22,6 +25,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 using namespace std;
 
@@ -61,10 +65,10 @@ RayTracer::RayColor(const Ray &ray, Surface::Ptr scene,
 }*/
 
 bool RayTracer::RayColor(const Ray &ray, 
-                        Surface::Ptr scene, 
+                        const Surface::Ptr &scene, 
                         const std::vector<Light::Ptr> &lights, 
                         uint ray_depth, uint max_ray_depth, 
-                        Vec3r &ray_color)
+                        Vec3r &ray_color, uint64_t &ray_count)
 {
     if (ray_depth>=max_ray_depth){
         return false;
@@ -72,56 +76,73 @@ bool RayTracer::RayColor(const Ray &ray,
 
     // check whether ray hits any scene object
     ray_color = Vec3r{0, 0, 0}; // black
+    ++ray_count;
     HitRecord hit_record;
     if (!scene->Hit(ray, kEpsilon, kInfinity, hit_record))
         return false;
+    return ShadeHit(ray, hit_record, scene, lights, ray_depth, max_ray_depth,
+                    ray_color, ray_count);
+}
+
 
+bool RayTracer::ShadeHit(const Ray &ray, HitRecord &hit_record,
+                         const Surface::Ptr &scene,
+                         const std::vector<Light::Ptr> &lights,
+                         uint ray_depth, uint max_ray_depth,
+                         Vec3r &ray_color, uint64_t &ray_count)
+{
+    ray_color = Vec3r{0, 0, 0}; // black
+    hit_record.ComputeAttributes(ray);
 
     // get surface material
     auto hit_surface = hit_record.GetSurface();
     if (!hit_surface)
         return false;
-    auto material = hit_surface->GetMaterial();
-    if (!material) {
-        spdlog::error("RayColor: surface has no material -- returning black.");
-        return true;
+    // surfaces without a material id, e.g., set up with SetMaterial()
+    // alone, are shaded from their material
+    MaterialParams surface_material;
+    auto material_id = hit_surface->GetMaterialId();
+    if (material_id == MaterialTable::kNoMaterial) {
+      auto surface_material_ptr = hit_surface->GetMaterial();
+      if (surface_material_ptr)
+        surface_material_ptr->GetParams(surface_material);
     }
+    const MaterialParams &material =
+      material_id == MaterialTable::kNoMaterial ? surface_material :
+      materials_.Get(material_id);
 
     // compute the Phong shading contribution from each light and add
     // them to get the final ray color
-    auto phong_material = dynamic_pointer_cast<PhongMaterial>(material);
-    if (phong_material) {
-      //Check if dielectric
-      auto dielectric = dynamic_pointer_cast<PhongDielectric>(phong_material);
-      if (dielectric) {  // handle dielectric materials
-        //std::cout << "Dielectric " << std::endl;
-        shared_ptr<Ray> reflect_ray;
-        shared_ptr<Ray> refract_ray;
+    switch (material.type) {
+    case MaterialType::kDielectric:
+      {
+        // handle dielectric materials
+        Ray reflect_ray, refract_ray;
         Real schlick_reflectance;
-        Vec3r attenuate = dielectric->Scatter(hit_record, ray, reflect_ray, refract_ray, schlick_reflectance);
-        if (refract_ray){
+        bool refracted = PhongDielectric::Scatter(material, hit_record, ray,
+                                                  reflect_ray, refract_ray,
+                                                  schlick_reflectance);
+        const Vec3r &attenuate = material.diffuse;
+        if (refracted){
           Vec3r refract_color;
-          if (RayColor(*refract_ray, scene, lights, ray_depth+1, max_ray_depth, refract_color)){
+          if (RayColor(refract_ray, scene, lights, ray_depth+1, max_ray_depth, refract_color, ray_count)){
             ray_color += attenuate.cwiseProduct(refract_color*(1-schlick_reflectance));
           }
         }
-        if (reflect_ray){
-          Vec3r reflect_color;
-          if (RayColor(*reflect_ray, scene, lights, ray_depth+1, max_ray_depth, reflect_color)){
-            ray_color += attenuate.cwiseProduct(reflect_color*schlick_reflectance);
-          }
+        Vec3r reflect_color;
+        if (RayColor(reflect_ray, scene, lights, ray_depth+1, max_ray_depth, reflect_color, ray_count)){
+          ray_color += attenuate.cwiseProduct(reflect_color*schlick_reflectance);
         }
-                                            
+        break;
       }
-
-      //Else, not dielectric but still regular phong material:
-      else{
+    case MaterialType::kPhong:
+      {
         // compute direct light shading
         Vec3r view_vec = -ray.GetDirection().normalized();
-        for (auto light : lights)
-          ray_color += light->Illuminate(hit_record, view_vec, scene);
+        for (const auto &light : lights)
+          ray_color += light->Illuminate(hit_record, material, view_vec, scene);
 
-        Vec3r mirror_reflection_factor = phong_material->GetMirror(); //ideal specular coeffs
+        const Vec3r &mirror_reflection_factor = material.mirror; //ideal specular coeffs
         if (!mirror_reflection_factor.isZero() && hit_record.IsFrontFace()){
             // reflection_ray = d - 2(d dot N)N where d is incident ray and N is normal to object at hit point
             //d is lightray from camera to object, arg ray
@@ -134,17 +155,17 @@ bool RayTracer::RayColor(const Ray &ray,
             // Create a variable to store the reflected color
             Vec3r reflect_color;
 
-            if (RayColor(reflect_ray, scene, lights, ray_depth+1, max_ray_depth, reflect_color)){
+            if (RayColor(reflect_ray, scene, lights, ray_depth+1, max_ray_depth, reflect_color, ray_count)){
                 ray_color += reflect_color.cwiseProduct(mirror_reflection_factor);
             }
         }
+        break;
       }
-        
+    case MaterialType::kNone:
+      spdlog::error("RayColor: surface has no material -- returning black.");
+      break;
     }
-
-    
     return true;
-    
 }
 
 
@@ -159,6 +180,9 @@ RayTracer::Render(Surface::Ptr scene, const std::vector<Light::Ptr> &lights,
   // start timer
   auto start_time = chrono::system_clock::now();
 
+  // pick up material edits made since the table was built
+  materials_.Update();
+
   // compute output image dimensions
   auto aspect = camera->GetAspectRatio();
   auto height = static_cast<int>(image_height_);
@@ -172,27 +196,160 @@ RayTracer::Render(Surface::Ptr scene, const std::vector<Light::Ptr> &lights,
   rendered_image_ = cv::Mat(cv::Size(width, height), CV_64FC3,
                             cv::Scalar(0, 0, 0, 0));
 
-  // start progress bar
+  // split the image into tiles. Each tile is traced into a buffer
+  // owned by the rendering thread and copied into the image once it
+  // is done, so threads never share cache lines of 'rendered_image_'
   spdlog::info("Rendering...");
   auto total_pixels = static_cast<size_t>(width * height);
-  RenderProgressStart(total_pixels);
-
-  // send rays
-  Real xscale = 1.0 / width;
-  Real yscale = 1.0 / height;
-  for (int y = 0; y < height; ++y) {
-    for (int x = 0; x < width; ++x) {
-      auto ray = camera->GetRay((x + .5) * xscale, (y + .5) * yscale);
-      Vec3r ray_color;
-      RayColor(ray, scene, lights, 0, max_ray_depth, ray_color); //initial depth: 0; max depth: 5
-      rendered_image_.at<cv::Vec3d>((height - y -1), x) =
-        cv::Vec3d{ray_color[0], ray_color[1], ray_color[2]};
-      RenderProgressIncDonePixels();
+  tbb::task_arena arena(thread_count_ ? static_cast<int>(thread_count_) :
+                        tbb::task_arena::automatic);
+  arena.initialize();
+  const auto slot_count = static_cast<size_t>(arena.max_concurrency());
+  const int tile_size = static_cast<int>(std::max(tile_size_, 1u));
+  const int tiles_x = (width + tile_size - 1) / tile_size;
+  const int tiles_y = (height + tile_size - 1) / tile_size;
+  const auto tile_count = static_cast<size_t>(tiles_x * tiles_y);
+  const Real xscale = static_cast<Real>(1.0 / width);
+  const Real yscale = static_cast<Real>(1.0 / height);
+  const int packet_size = static_cast<int>(std::min(packet_size_, 8u));
+  auto primary_ray = [&](int x, int y) {
+    const auto half = static_cast<Real>(.5);
+    return camera->GetRay((static_cast<Real>(x) + half) * xscale,
+                          (static_cast<Real>(y) + half) * yscale);
+  };
+  auto trace_pixel = [&](int x, int y, Vec3r &ray_color, uint64_t &ray_count) {
+    RayColor(primary_ray(x, y), scene, lights, 0, max_ray_depth, ray_color, ray_count); //initial depth: 0; max depth: 5
+  };
+
+  // estimate the cost of each tile by timing a sparse subset of its
+  // pixels, traced at one pixel per 'prepass_stride_' in x and y
+  vector<double> tile_costs;
+  if (tile_order_ == TileOrder::kCost && thread_count_ != 1) {
+    const int stride = static_cast<int>(std::max(prepass_stride_, 1u));
+    tile_costs.resize(tile_count);
+    arena.execute([&]() {
+      tbb::parallel_for(size_t(0), tile_count, [&](size_t tile_index) {
+          const int x0 = static_cast<int>(tile_index) % tiles_x * tile_size;
+          const int y0 = static_cast<int>(tile_index) / tiles_x * tile_size;
+          const int x1 = std::min(x0 + tile_size, width);
+          const int y1 = std::min(y0 + tile_size, height);
+          auto tile_start = chrono::steady_clock::now();
+          Vec3r ray_color;
+          uint64_t ray_count = 0;
+          for (int y = y0 + std::min(stride, y1 - y0) / 2; y < y1; y += stride)
+            for (int x = x0 + std::min(stride, x1 - x0) / 2; x < x1; x += stride)
+              trace_pixel(x, y, ray_color, ray_count);
+          tile_costs[tile_index] = chrono::duration<double>
+            (chrono::steady_clock::now() - tile_start).count();
+        });
+    });
+  }
+  auto tiles = OrderTiles(static_cast<uint32_t>(tiles_x),
+                          static_cast<uint32_t>(tiles_y), tile_order_,
+                          tile_costs);
+
+  // start progress reporting, with one counter per thread of the
+  // arena the tiles are rendered in
+  progress_.Start(total_pixels, slot_count);
+
+  // send rays, one tile at a time, and add up how long each thread
+  // spends rendering tiles
+  vector<double> busy_times(slot_count, 0);
+  tbb::enumerable_thread_specific<std::vector<Vec3r>> tile_buffers;
+  auto render_tile = [&](size_t tile_index) {
+    auto tile_start = chrono::steady_clock::now();
+    const int x0 = static_cast<int>(tile_index) % tiles_x * tile_size;
+    const int y0 = static_cast<int>(tile_index) / tiles_x * tile_size;
+    const int x1 = std::min(x0 + tile_size, width);
+    const int y1 = std::min(y0 + tile_size, height);
+    auto &tile_colors = tile_buffers.local();
+    tile_colors.resize(static_cast<size_t>(tile_size * tile_size));
+    uint64_t ray_count = 0;
+    if (packet_size > 1 && max_ray_depth > 0) {
+      // trace the primary rays of each block of pixels as a packet
+      RayPacket packet;
+      HitRecord hit_records[RayPacket::kMaxSize];
+      int lane_pixels[RayPacket::kMaxSize];
+      for (int by = y0; by < y1; by += packet_size) {
+        for (int bx = x0; bx < x1; bx += packet_size) {
+          packet.Clear();
+          for (int y = by; y < std::min(by + packet_size, y1); ++y) {
+            for (int x = bx; x < std::min(bx + packet_size, x1); ++x) {
+              lane_pixels[packet.size] = (y - y0) * tile_size + x - x0;
+              packet.Add(primary_ray(x, y), kInfinity);
+            }
+          }
+          uint64_t hits = scene->HitPacket(packet, packet.AllMask(), hit_records);
+          ray_count += packet.size;
+          for (uint32_t lane = 0; lane < packet.size; ++lane) {
+            Vec3r &ray_color = tile_colors[static_cast<size_t>(lane_pixels[lane])];
+            ray_color = Vec3r{0, 0, 0};
+            if (hits & (uint64_t(1) << lane))
+              ShadeHit(packet.rays[lane], hit_records[lane], scene, lights, 0,
+                       max_ray_depth, ray_color, ray_count);
+          }
+        }
+      }
+    } else {
+      for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+          trace_pixel(x, y, tile_colors[static_cast<size_t>((y - y0) * tile_size +
+                                                            x - x0)], ray_count);
+        }
+      }
     }
+    for (int y = y0; y < y1; ++y) {
+      auto row = rendered_image_.ptr<cv::Vec3d>(height - y - 1);
+      for (int x = x0; x < x1; ++x) {
+        const auto &ray_color = tile_colors[static_cast<size_t>((y - y0) * tile_size +
+                                                                x - x0)];
+        row[x] = cv::Vec3d{ray_color[0], ray_color[1], ray_color[2]};
+      }
+    }
+    auto slot = static_cast<size_t>(tbb::this_task_arena::current_thread_index());
+    progress_.Add(slot, static_cast<uint64_t>((x1 - x0) * (y1 - y0)), ray_count);
+    busy_times[slot] += chrono::duration<double>
+      (chrono::steady_clock::now() - tile_start).count();
+  };
+  auto tiles_start = chrono::steady_clock::now();
+  arena.execute([&]() {
+    if (thread_count_ == 1) {
+      for (auto tile_index : tiles)
+        render_tile(tile_index);
+    } else if (tile_order_ == TileOrder::kCost) {
+      // hand out tiles from a shared queue, most expensive first, so
+      // the cheap tiles are left to even out the threads at the end
+      std::atomic<size_t> next_tile{0};
+      tbb::parallel_for(size_t(0), slot_count, [&](size_t) {
+          for (size_t next = next_tile++; next < tile_count; next = next_tile++)
+            render_tile(tiles[next]);
+        }, tbb::simple_partitioner());
+    } else {
+      // TBB splits the ordered tiles into contiguous runs and idle
+      // threads steal the unstarted half of another thread's run
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, tile_count, 1),
+                        [&](const tbb::blocked_range<size_t> &range) {
+                          for (size_t next = range.begin(); next != range.end();
+                               ++next)
+                            render_tile(tiles[next]);
+                        });
+    }
+  });
+  auto tiles_time = chrono::duration<double>
+    (chrono::steady_clock::now() - tiles_start).count();
+
+  // stop progress reporting
+  progress_.Finish();
+
+  // report how long each thread waited for work while tiles were
+  // being rendered
+  thread_idle_times_.resize(slot_count);
+  string idle_times;
+  for (size_t slot = 0; slot < slot_count; ++slot) {
+    thread_idle_times_[slot] = std::max(tiles_time - busy_times[slot], 0.0);
+    idle_times += fmt::format(" {:.3f}", thread_idle_times_[slot]);
   }
-
-  // stop progress bar
-  RenderProgressEnd();
+  spdlog::info("Thread idle times (s):{}", idle_times);
 
   // stop timer
   auto end_time = std::chrono::system_clock::now();
@@ -289,38 +446,6 @@ RayTracer::WriteImage(const std::string &image_name, Real gamma) const
   return true;
 }
 
-
-void
-RayTracer::RenderProgressStart(size_t total_pixels)
-{
-  const std::lock_guard<std::mutex> lock(progress_bar_mutex_);
-  progress_bar_ = make_shared<tqdm>();
-  progress_bar_done_pixels_  = 0;
-  progress_bar_total_pixels_ = total_pixels;
-}
-
-
-void
-RayTracer::RenderProgressIncDonePixels()
-{
-  const std::lock_guard<std::mutex> lock(progress_bar_mutex_);
-  progress_bar_done_pixels_ = std::min(progress_bar_done_pixels_ + 1,
-                                       progress_bar_total_pixels_);
-  if (!progress_bar_)
-    return;
-  progress_bar_->progress(static_cast<int>(progress_bar_done_pixels_),
-                          static_cast<int>(progress_bar_total_pixels_));
-}
-
-
-void
-RayTracer::RenderProgressEnd()
-{
-  const std::lock_guard<std::mutex> lock(progress_bar_mutex_);
-  if (progress_bar_)
-    progress_bar_->finish();
-  progress_bar_.reset();
-}
-
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -18,15 +18,18 @@
 #include <set>
 #include <tbb/tbb.h>
 #include <opencv2/opencv.hpp>
-#include <tqdm/tqdm.h>
 #include "core/types.h"
 #include "core/node.h"
 #include "core/geometry/surface.h"
 #include "core/camera/camera.h"
 #include "core/light/light.h"
+#include "core/material/material_table.h"
+#include "core/renderer/render_progress.h"
+#include "core/renderer/tile_scheduler.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 //! \class RayTracer
 //! \brief Main rendering class responsible for generating rays, path
@@ -45,7 +48,11 @@ public:
   //!    RayColor(). The final color for each pixel will be stored in
   //!    'rendered_image_'. This function is also responsible for
   //!    allocating an initial black image for 'rendered_image_'
-  //!    before the start of the ray tracing process.
+  //!    before the start of the ray tracing process. The image is
+  //!    rendered in square tiles that are distributed over
+  //!    'thread_count_' threads; every pixel is computed the same way
+  //!    regardless of the thread count, so the result is identical to
+  //!    a single-threaded render.
   //! \param[in] scene Input scene to render
   //! \param[in] lights Scene lights
   //! \param[in] camera Camera used for generating rays and rendering
@@ -63,6 +70,83 @@ public:
   //! \return Output image height
   inline uint GetImageHeight() const {return image_height_;}
 
+  //! \brief Set the number of threads used for rendering
+  //! \param[in] thread_count Number of threads; 0 uses all cores and
+  //!            1 renders serially on the calling thread
+  inline void SetThreadCount(uint thread_count) {thread_count_ = thread_count;}
+
+  //! \brief Get the number of threads used for rendering
+  //! \return Number of threads; 0 means all cores
+  inline uint GetThreadCount() const {return thread_count_;}
+
+  //! \brief Set the width and height of the tiles the image is split
+  //! into for rendering
+  //! \param[in] tile_size Tile size in pixels; must be positive
+  inline void SetTileSize(uint tile_size) {tile_size_ = tile_size;}
+
+  //! \brief Get the tile size
+  //! \return Tile size in pixels
+  inline uint GetTileSize() const {return tile_size_;}
+
+  //! \brief Set the width and height of the blocks of pixels whose
+  //! primary rays are traced together as a packet
+  //! \details See Surface::HitPacket(); the rendered image doesn't
+  //!    depend on the packet size
+  //! \param[in] packet_size Packet size in pixels, at most 8; 1 traces
+  //!            every primary ray alone
+  inline void SetPacketSize(uint packet_size) {packet_size_ = packet_size;}
+
+  //! \brief Get the width and height of primary ray packets
+  //! \return Packet size in pixels
+  inline uint GetPacketSize() const {return packet_size_;}
+
+  //! \brief Set the order in which tiles are handed to threads
+  //! \details TileOrder::kCost first traces a sparse prepass of every
+  //!    tile (see SetPrepassStride()) to estimate its cost
+  //! \param[in] tile_order Tile order
+  inline void SetTileOrder(TileOrder tile_order) {tile_order_ = tile_order;}
+
+  //! \brief Get the order in which tiles are handed to threads
+  //! \return Tile order
+  inline TileOrder GetTileOrder() const {return tile_order_;}
+
+  //! \brief Set the spacing of the pixels traced by the cost prepass
+  //! \param[in] stride One pixel in 'stride' is traced in x and y
+  inline void SetPrepassStride(uint stride) {prepass_stride_ = stride;}
+
+  //! \brief Get the spacing of the pixels traced by the cost prepass
+  //! \return Prepass stride in pixels
+  inline uint GetPrepassStride() const {return prepass_stride_;}
+
+  //! \brief Get how long each render thread waited for work during
+  //! the last call to Render()
+  //! \return Idle time in seconds, indexed by task arena slot
+  inline const std::vector<double>& GetThreadIdleTimes() const {
+    return thread_idle_times_;
+  }
+
+  //! \brief Set the file descriptor render progress is written to
+  //! as JSON lines (see RenderProgress)
+  //! \param[in] fd File descriptor; negative disables the stream
+  inline void SetProgressFd(int fd) {progress_.SetJsonFd(fd);}
+
+  //! \brief Set the material table that surface material ids index
+  //! into during shading. Surfaces without a material id are shaded
+  //! from Surface::GetMaterial(); Render() re-reads the table's
+  //! materials, so edits made after the table was built are shaded.
+  //! \param[in] materials Material table built alongside the scene
+  inline void SetMaterialTable(const MaterialTable &materials) {
+    materials_ = materials;
+  }
+
+  //! \brief Get the material table used during shading
+  //! \return Material table
+  inline const MaterialTable& GetMaterialTable() const {return materials_;}
+
+  //! \brief Get the image produced by the last call to Render()
+  //! \return Rendered image of type CV_64FC3, in RGB order
+  inline const cv::Mat& GetRenderedImage() const {return rendered_image_;}
+
   //! \brief Write rendered image to file. If the image extension is
   //!        exr, the image won't be gamma corrected before it's saved
   //!        (gamma is ignored).
@@ -79,14 +163,37 @@ protected:
   //! \param[in] scene Input scene
   //! \param[in] lights Scene lights
   //! \param[out] ray_color Output ray color
+  //! \param[in,out] ray_count Incremented for every ray traced into
+  //!                the scene, including reflection and refraction
+  //!                rays (shadow rays are not counted)
   //! \return True if ray intersects a surface in the scene
   /*bool RayColor(const Ray &ray, Surface::Ptr scene,
                 const std::vector<Light::Ptr> &lights,
                 Vec3r &ray_color);*/
-  bool RayColor(const Ray &ray, Surface::Ptr scene, 
+  bool RayColor(const Ray &ray, const Surface::Ptr &scene, 
                 const std::vector<Light::Ptr> &lights, 
                 uint ray_depth, uint max_ray_depth, 
-                Vec3r &ray_color);
+                Vec3r &ray_color, uint64_t &ray_count);
+
+  //! \brief Determine the color of a ray from its closest hit
+  //! \details Shades a hit found by Surface::Hit() or
+  //!    Surface::HitPacket() and traces the secondary rays it spawns;
+  //!    RayColor() is scene->Hit() followed by this function.
+  //! \param[in] ray Ray that hit the scene
+  //! \param[in,out] hit_record Closest hit of the ray; its attributes
+  //!                are computed here
+  //! \param[in] scene Input scene
+  //! \param[in] lights Scene lights
+  //! \param[in] ray_depth Depth of the ray (0 for primary rays)
+  //! \param[in] max_ray_depth Maximum ray depth
+  //! \param[out] ray_color Output ray color
+  //! \param[in,out] ray_count Incremented for every secondary ray
+  //! \return True
+  bool ShadeHit(const Ray &ray, HitRecord &hit_record,
+                const Surface::Ptr &scene,
+                const std::vector<Light::Ptr> &lights,
+                uint ray_depth, uint max_ray_depth,
+                Vec3r &ray_color, uint64_t &ray_count);
 
   //! \brief Gamma correct input image
   //! \details Input image is assumed to be of type CV_64FC3
@@ -108,27 +215,21 @@ protected:
   //! \return Output image of type CV_32FC3 with BGR channel ordering
   cv::Mat RGBToBGRFloat32(const cv::Mat &in_image) const;
 
-  //! \brief Start the render progress bar
-  //! \param[in] total_pixels Total number of pixels that will be rendered
-  void RenderProgressStart(size_t total_pixels);
-
-  //! \brief Incremenet the number of rendered pixels in the progress bar
-  void RenderProgressIncDonePixels();
-
-  //! \brief Stop/end the render progress bar
-  void RenderProgressEnd();
-
   uint image_height_{180};  //!< output image height
   cv::Mat rendered_image_;  //!< output rendered image
+  MaterialTable materials_; //!< shading parameters indexed by material id
+  uint thread_count_{0};    //!< render threads; 0 uses all cores
+  uint tile_size_{16};      //!< width and height of render tiles
+  uint packet_size_{4};     //!< width and height of primary ray packets
+  TileOrder tile_order_{TileOrder::kCost};  //!< order tiles are rendered in
+  uint prepass_stride_{8};  //!< pixel spacing of the cost prepass
+  std::vector<double> thread_idle_times_;   //!< seconds each thread waited
 
-  // progress bar related data members
-  std::mutex progress_bar_mutex_;        //!< progress bar mutex
-  std::shared_ptr<tqdm> progress_bar_;   //!< render progress bar
-  size_t progress_bar_total_pixels_ = 0; //!< total number pixels to render
-  size_t progress_bar_done_pixels_ = 0;  //!< number of pixels that have been rendered
+  RenderProgress progress_; //!< render progress counters and reporter
 
   uint max_ray_depth = 5; //!< max depth for mirror reflections
 };
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -0,0 +1,76 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       render_job.cc
+//! \brief      RenderJob struct
+//! \author     Stephanie Jung, 2025
+
+#include "core/renderer/render_job.h"
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "core/camera/camera.h"
+#include "core/geometry/accelerator.h"
+#include "core/geometry/surface.h"
+#include "core/light/light.h"
+#include "core/parser/raytra_parser.h"
+#include "core/renderer/raytracer.h"
+#include "core/renderer/tile_scheduler.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+bool
+RunRenderJob(const RenderJob &job)
+{
+  AcceleratorType accel_type;
+  if (!ParseAcceleratorType(job.accel, accel_type)) {
+    spdlog::error("Unknown acceleration structure: {}", job.accel);
+    return false;
+  }
+  TileOrder tile_order;
+  if (!ParseTileOrder(job.tile_order, tile_order)) {
+    spdlog::error("Unknown tile order: {}", job.tile_order);
+    return false;
+  }
+  spdlog::info("Rendering in {} precision",
+               sizeof(Real) == sizeof(float) ? "single" : "double");
+
+  // parse raytra scene
+  Vec2i image_size;
+  Surface::Ptr scene;
+  vector<Light::Ptr> lights;
+  Camera::Ptr camera;
+  MaterialTable materials;
+  if (!RaytraParser::ParseFile(job.scene_file, scene, lights, camera,
+                               image_size, materials, accel_type, job.cache_dir,
+                               job.cache_report, job.merge_triangles) ||
+      !scene || !camera || image_size[0] <= 0 || image_size[1] <= 0) {
+    spdlog::error("Failed to parse scene file.");
+    return false;
+  }
+
+  // render scene
+  RayTracer rt;
+  rt.SetImageHeight(static_cast<uint>(image_size[1]));
+  rt.SetMaterialTable(materials);
+  rt.SetThreadCount(job.threads);
+  rt.SetTileOrder(tile_order);
+  rt.SetPacketSize(job.packet_size);
+  rt.SetProgressFd(job.progress_fd);
+  rt.Render(scene, lights, camera);
+
+  // save rendered image to file
+  rt.WriteImage(job.output_file, 2);
+  return true;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
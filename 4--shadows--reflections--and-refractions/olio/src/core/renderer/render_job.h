@@ -0,0 +1,56 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       render_job.h
+//! \brief      RenderJob struct
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <string>
+#include "core/types.h"
+
+namespace olio {
+namespace core {
+
+//! \struct RenderJob
+//! \brief Settings for rendering a scene file to an image. A job holds
+//! no Real values, so the same job can be run by the single or the
+//! double precision build of olio_core.
+struct RenderJob {
+  std::string scene_file;      //!< input raytra scene file
+  std::string output_file;     //!< output image name
+  std::string accel{"bvh"};    //!< acceleration structure name
+  std::string cache_dir;       //!< accelerator cache directory; empty disables caching
+  bool cache_report{false};    //!< log cache misses before and after reordering BVHs
+  bool merge_triangles{false}; //!< merge runs of same-material triangles into meshes
+  unsigned int threads{0};     //!< render threads; 0 uses all cores
+  std::string tile_order{"cost"};  //!< order tiles are rendered in
+  unsigned int packet_size{4}; //!< width and height of primary ray packets
+  int progress_fd{-1};         //!< fd for JSON lines progress; -1 disables it
+};
+
+// Each precision build of olio_core defines RunRenderJob in its own
+// namespace (see OLIO_PRECISION_NAMESPACE); an unqualified call runs
+// the precision the caller was compiled with.
+namespace double_precision {
+//! \brief Parse, render, and save a scene in double precision
+//! \param[in] job Render settings
+//! \return True on success
+bool RunRenderJob(const RenderJob &job);
+}  // namespace double_precision
+
+namespace single_precision {
+//! \brief Parse, render, and save a scene in single precision
+//! \details Only available if olio_core_float is linked in
+//! \param[in] job Render settings
+//! \return True on success
+bool RunRenderJob(const RenderJob &job);
+}  // namespace single_precision
+
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,166 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       render_progress.cc
+//! \brief      RenderProgress class
+//! \author     Stephanie Jung, 2025
+
+#include "core/renderer/render_progress.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#ifndef WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+namespace {
+
+//! \brief Write a whole buffer to a file descriptor
+//! \param[in] fd File descriptor
+//! \param[in] data Buffer
+//! \param[in] size Buffer size in bytes
+void
+WriteAll(int fd, const char *data, size_t size)
+{
+  while (size) {
+#ifndef WIN32
+    auto written = write(fd, data, size);
+#else
+    auto written = _write(fd, data, static_cast<unsigned int>(size));
+#endif
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+}  // namespace
+
+
+RenderProgress::~RenderProgress()
+{
+  Finish();
+}
+
+
+void
+RenderProgress::Start(size_t total_pixels, size_t slot_count)
+{
+  Finish();
+  slot_count_ = std::max<size_t>(slot_count, 1);
+  counters_.reset(new Counter[slot_count_]);
+  total_pixels_ = total_pixels;
+  start_time_ = chrono::steady_clock::now();
+#ifndef WIN32
+  draw_bar_ = isatty(1);
+#else
+  draw_bar_ = _isatty(1);
+#endif
+  stop_ = false;
+  reporter_ = thread(&RenderProgress::Run, this);
+}
+
+
+void
+RenderProgress::Finish()
+{
+  if (!reporter_.joinable())
+    return;
+  {
+    const lock_guard<mutex> lock(reporter_mutex_);
+    stop_ = true;
+  }
+  reporter_cv_.notify_all();
+  reporter_.join();
+  Report(true);
+}
+
+
+void
+RenderProgress::Run()
+{
+  unique_lock<mutex> lock(reporter_mutex_);
+  while (!reporter_cv_.wait_for(lock, interval_, [this]() {return stop_;}))
+    Report(false);
+}
+
+
+void
+RenderProgress::Report(bool final)
+{
+  // sum the per-thread counters
+  uint64_t done_pixels = 0, rays = 0;
+  for (size_t slot = 0; slot < slot_count_; ++slot) {
+    done_pixels += counters_[slot].pixels.load(memory_order_relaxed);
+    rays += counters_[slot].rays.load(memory_order_relaxed);
+  }
+  done_pixels = std::min<uint64_t>(done_pixels, total_pixels_);
+  auto elapsed = chrono::duration_cast<chrono::duration<double>>
+    (chrono::steady_clock::now() - start_time_).count();
+  double rays_per_sec = elapsed > 0 ? static_cast<double>(rays) / elapsed : 0;
+  double eta = -1;  // unknown until the first pixel is done
+  if (done_pixels)
+    eta = elapsed * static_cast<double>(total_pixels_ - done_pixels) /
+      static_cast<double>(done_pixels);
+  double fraction = total_pixels_ ?
+    static_cast<double>(done_pixels) / static_cast<double>(total_pixels_) : 1;
+
+  // redraw the progress line
+  if (draw_bar_) {
+    const int width = 40;
+    auto fills = static_cast<int>(fraction * width);
+    char bar[width + 1];
+    for (int i = 0; i < width; ++i)
+      bar[i] = i < fills ? '#' : ' ';
+    bar[width] = '\0';
+    if (eta >= 0)
+      printf("\r [%s] %5.1f%%  %.2f Mrays/s  ETA %.1fs   ", bar,
+             100 * fraction, rays_per_sec * 1e-6, eta);
+    else
+      printf("\r [%s] %5.1f%%  %.2f Mrays/s  ETA -   ", bar,
+             100 * fraction, rays_per_sec * 1e-6);
+    if (final)
+      printf("\n");
+    fflush(stdout);
+  }
+
+  // write the JSON line; an unknown ETA is null
+  if (json_fd_ >= 0) {
+    char eta_str[32] = "null";
+    if (eta >= 0)
+      snprintf(eta_str, sizeof(eta_str), "%.3f", eta);
+    char line[256];
+    int size = snprintf(line, sizeof(line),
+                        "{\"event\":\"%s\",\"done_pixels\":%llu,"
+                        "\"total_pixels\":%llu,\"rays\":%llu,"
+                        "\"elapsed\":%.3f,\"eta\":%s,\"rays_per_sec\":%.1f}\n",
+                        final ? "finish" : "progress",
+                        static_cast<unsigned long long>(done_pixels),
+                        static_cast<unsigned long long>(total_pixels_),
+                        static_cast<unsigned long long>(rays),
+                        elapsed, eta_str, rays_per_sec);
+    if (size > 0)
+      WriteAll(json_fd_, line, std::min(static_cast<size_t>(size),
+                                         sizeof(line) - 1));
+  }
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,124 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       render_progress.h
+//! \brief      RenderProgress class
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "core/types.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \class RenderProgress
+//! \brief Render progress counters and the thread that reports them
+//! \details Render threads add finished pixels and traced rays to
+//!    their own padded counter slot, indexed by the thread's
+//!    slot in the render task arena, so counting takes no lock and
+//!    shares no cache line. A reporter thread sums the slots at a
+//!    fixed rate and redraws a progress line with ETA and rays/sec on
+//!    stdout (if it is a terminal). It can also write the same numbers
+//!    as JSON lines to a file descriptor, e.g. for a job orchestrator:
+//!
+//!    {"event":"progress","done_pixels":1024,"total_pixels":65536,
+//!     "rays":2048,"elapsed":0.1,"eta":6.3,"rays_per_sec":20480}
+//!
+//!    The last line written by Finish() has "event":"finish".
+class RenderProgress {
+public:
+  //! \brief Constructor
+  RenderProgress() = default;
+
+  //! \brief Destructor; stops the reporter thread
+  ~RenderProgress();
+
+  RenderProgress(const RenderProgress&) = delete;
+  RenderProgress& operator=(const RenderProgress&) = delete;
+
+  //! \brief Reset the counters and start the reporter thread
+  //! \param[in] total_pixels Total number of pixels that will be rendered
+  //! \param[in] slot_count Number of counter slots; one per thread
+  //!            slot of the render task arena
+  void Start(size_t total_pixels, size_t slot_count);
+
+  //! \brief Add finished pixels and traced rays to a counter slot
+  //! \details Lock free; a slot must only be used by one thread at a
+  //!    time (see tbb::this_task_arena::current_thread_index())
+  //! \param[in] slot Counter slot; must be less than the slot count
+  //!            passed to Start()
+  //! \param[in] pixels Number of finished pixels
+  //! \param[in] rays Number of traced rays
+  inline void Add(size_t slot, uint64_t pixels, uint64_t rays) {
+    auto &counter = counters_[slot];
+    counter.pixels.fetch_add(pixels, std::memory_order_relaxed);
+    counter.rays.fetch_add(rays, std::memory_order_relaxed);
+  }
+
+  //! \brief Stop the reporter thread and report the final counts
+  void Finish();
+
+  //! \brief Set how often the reporter thread refreshes the progress
+  //! \param[in] interval Time between two reports
+  inline void SetInterval(std::chrono::milliseconds interval) {
+    interval_ = interval;
+  }
+
+  //! \brief Set the file descriptor progress is written to as JSON
+  //! lines; the descriptor is not closed
+  //! \param[in] fd File descriptor; negative disables the stream
+  inline void SetJsonFd(int fd) {json_fd_ = fd;}
+
+  //! \brief Get the JSON lines file descriptor
+  //! \return File descriptor; negative if disabled
+  inline int GetJsonFd() const {return json_fd_;}
+protected:
+  //! \brief Per-thread counters
+  //! \details Padded to two cache lines, so the counters of
+  //!    neighbouring slots never share a line whatever the alignment
+  //!    of the array (over-aligned new needs C++17)
+  struct Counter {
+    std::atomic<uint64_t> pixels{0};  //!< finished pixels
+    std::atomic<uint64_t> rays{0};    //!< traced rays
+    char padding[128 - 2 * sizeof(std::atomic<uint64_t>)];  //!< unused
+  };
+
+  //! \brief Reporter thread main loop
+  void Run();
+
+  //! \brief Sum the counters and report them
+  //! \param[in] final Whether this is the last report of the render
+  void Report(bool final);
+
+  std::unique_ptr<Counter[]> counters_;  //!< one counter per thread slot
+  size_t slot_count_{0};                 //!< number of counters
+  size_t total_pixels_{0};               //!< number of pixels to render
+  std::chrono::steady_clock::time_point start_time_;  //!< render start
+  std::chrono::milliseconds interval_{100};  //!< time between reports
+  int json_fd_{-1};                      //!< JSON lines stream; -1 if disabled
+  bool draw_bar_{false};                 //!< whether stdout is a terminal
+
+  // reporter thread related data members
+  std::thread reporter_;                 //!< reporter thread
+  std::mutex reporter_mutex_;            //!< guards 'stop_'
+  std::condition_variable reporter_cv_;  //!< wakes the reporter to stop
+  bool stop_{false};                     //!< whether the reporter should stop
+};
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
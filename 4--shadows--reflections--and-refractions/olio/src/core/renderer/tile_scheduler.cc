@@ -0,0 +1,96 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       tile_scheduler.cc
+//! \brief      Render tile ordering
+//! \author     Stephanie Jung, 2025
+
+#include "core/renderer/tile_scheduler.h"
+#include <algorithm>
+#include <cctype>
+#include <numeric>
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+using namespace std;
+
+bool
+ParseTileOrder(const string &name, TileOrder &order)
+{
+  string lower = name;
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) {
+      return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));});
+  if (lower == "scanline")
+    order = TileOrder::kScanline;
+  else if (lower == "cost")
+    order = TileOrder::kCost;
+  else if (lower == "hilbert")
+    order = TileOrder::kHilbert;
+  else
+    return false;
+  return true;
+}
+
+
+uint64_t
+HilbertIndex(uint32_t x, uint32_t y, uint32_t bits)
+{
+  // walk the quadrants from the coarsest level down, rotating the
+  // remaining coordinates into each quadrant's frame
+  uint64_t index = 0;
+  for (uint32_t s = bits ? 1u << (bits - 1) : 0; s > 0; s >>= 1) {
+    uint32_t rx = (x & s) ? 1 : 0;
+    uint32_t ry = (y & s) ? 1 : 0;
+    index += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - (x & (s - 1));
+        y = s - 1 - (y & (s - 1));
+      }
+      std::swap(x, y);
+    }
+  }
+  return index;
+}
+
+
+vector<uint32_t>
+OrderTiles(uint32_t tiles_x, uint32_t tiles_y, TileOrder order,
+           const vector<double> &costs)
+{
+  vector<uint32_t> tiles(static_cast<size_t>(tiles_x) * tiles_y);
+  std::iota(tiles.begin(), tiles.end(), 0u);
+  switch (order) {
+  case TileOrder::kScanline:
+    break;
+  case TileOrder::kCost:
+    // stable, so tiles of equal cost stay in scanline order
+    if (costs.size() == tiles.size())
+      std::stable_sort(tiles.begin(), tiles.end(), [&](uint32_t a, uint32_t b) {
+          return costs[a] > costs[b];});
+    break;
+  case TileOrder::kHilbert:
+    {
+      uint32_t bits = 0;
+      while ((1u << bits) < std::max(tiles_x, tiles_y))
+        ++bits;
+      vector<uint64_t> keys(tiles.size());
+      for (uint32_t tile = 0; tile < tiles.size(); ++tile)
+        keys[tile] = HilbertIndex(tile % tiles_x, tile / tiles_x, bits);
+      std::sort(tiles.begin(), tiles.end(), [&](uint32_t a, uint32_t b) {
+          return keys[a] < keys[b];});
+      break;
+    }
+  }
+  return tiles;
+}
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -0,0 +1,62 @@
+// ======================================================================
+// Olio: Simple renderer
+// Copyright (C) 2022 by Hadi Fadaifard
+//
+// Author: Stephanie Jung, 2025
+// ======================================================================
+
+//! \file       tile_scheduler.h
+//! \brief      Render tile ordering
+//! \author     Stephanie Jung, 2025
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "core/types.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+
+//! \brief Order in which render tiles are handed to threads
+enum class TileOrder {
+  kScanline,  //!< row by row; tiles are split between threads by TBB
+  kCost,      //!< most expensive tiles first, by estimated cost, from a
+              //!< shared queue
+  kHilbert    //!< along a Hilbert curve; threads take contiguous runs
+              //!< of nearby tiles and steal from each other at the end
+};
+
+//! \brief Parse a tile order name as given on the command line
+//! \details Accepted names are "scanline", "cost", and "hilbert"
+//!          (case-insensitive)
+//! \param[in] name Tile order name
+//! \param[out] order Parsed tile order
+//! \return True if the name is known
+bool ParseTileOrder(const std::string &name, TileOrder &order);
+
+//! \brief Position of a cell along the Hilbert curve that covers a
+//!        2^bits x 2^bits grid
+//! \param[in] x Cell column; must be less than 2^bits
+//! \param[in] y Cell row; must be less than 2^bits
+//! \param[in] bits Number of bits per coordinate; at most 31
+//! \return Distance of the cell from the start of the curve
+uint64_t HilbertIndex(uint32_t x, uint32_t y, uint32_t bits);
+
+//! \brief Compute the order in which tiles are rendered
+//! \param[in] tiles_x Number of tile columns
+//! \param[in] tiles_y Number of tile rows
+//! \param[in] order Tile order
+//! \param[in] costs Estimated cost of each tile, row by row; only
+//!            used by TileOrder::kCost
+//! \return Tile indices (row * tiles_x + column) in render order
+std::vector<uint32_t> OrderTiles(uint32_t tiles_x, uint32_t tiles_y,
+                                 TileOrder order,
+                                 const std::vector<double> &costs=
+                                 std::vector<double>());
+
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -16,6 +16,9 @@
 #include <limits>
 #include <eigen3/Eigen/Dense>
 #include <eigen3/Eigen/Sparse>
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
 
 // define uchar, uint, etc
 using uchar = unsigned char;
@@ -23,8 +26,17 @@ using ushort = unsigned short;
 using uint = unsigned int;
 using ulong = unsigned long;
 
+// olio_core may be built in both precisions and linked into one
+// program; each build's symbols live in their own inline namespace
+#if defined(OLIO_USE_SINGLE_PRECISION)
+#define OLIO_PRECISION_NAMESPACE single_precision
+#else
+#define OLIO_PRECISION_NAMESPACE double_precision
+#endif
+
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 
 // define our floating point precision: float or double
 #if defined(OLIO_USE_SINGLE_PRECISION)
@@ -55,6 +67,14 @@ static constexpr Real kInfinity = std::numeric_limits<Real>::max();
 // misc macros
 #define CLAMP(A, L, H) (A > H ? H : (A < L ? L : A))
 
+// hint the cpu to fetch the cache line holding ADDR
+#if defined(_MSC_VER)
+#define OLIO_PREFETCH(ADDR) \
+  _mm_prefetch(reinterpret_cast<const char*>(ADDR), _MM_HINT_T0)
+#else
+#define OLIO_PREFETCH(ADDR) __builtin_prefetch(ADDR)
+#endif
+
 // vector types
 using VecXr = Eigen::Matrix<Real, Eigen::Dynamic, 1>;
 using Vec4r = Eigen::Matrix<Real, 4, 1>;
@@ -93,5 +113,6 @@ using Mat4i = Eigen::Matrix4i;
 using Mat3i = Eigen::Matrix3i;
 using Mat2i = Eigen::Matrix2i;
 
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
@@ -0,0 +1,116 @@
+//! \file       cache_counters.cc
+//! \brief      Hardware counters for data cache misses
+
+#include "core/utils/cache_counters.h"
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+namespace utils {
+
+#ifdef __linux__
+
+namespace {
+
+// open a disabled counter of read misses in the input cache for the
+// calling thread; returns -1 on failure
+int
+OpenCacheCounter(uint64_t cache)
+{
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.size = sizeof(attr);
+  attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+
+void
+StartCounter(int fd)
+{
+  if (fd < 0)
+    return;
+  ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+
+int64_t
+StopCounter(int fd)
+{
+  if (fd < 0)
+    return -1;
+  ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  uint64_t count = 0;
+  if (read(fd, &count, sizeof(count)) != sizeof(count))
+    return -1;
+  return static_cast<int64_t>(count);
+}
+
+}  // namespace
+
+
+CacheMissCounter::CacheMissCounter() :
+  l1_fd_{OpenCacheCounter(PERF_COUNT_HW_CACHE_L1D)},
+  last_level_fd_{OpenCacheCounter(PERF_COUNT_HW_CACHE_LL)}
+{
+}
+
+
+CacheMissCounter::~CacheMissCounter()
+{
+  if (l1_fd_ >= 0)
+    close(l1_fd_);
+  if (last_level_fd_ >= 0)
+    close(last_level_fd_);
+}
+
+
+void
+CacheMissCounter::Start()
+{
+  StartCounter(l1_fd_);
+  StartCounter(last_level_fd_);
+}
+
+
+bool
+CacheMissCounter::Stop(CacheMisses &misses)
+{
+  misses.l1 = StopCounter(l1_fd_);
+  misses.last_level = StopCounter(last_level_fd_);
+  return misses.l1 >= 0 || misses.last_level >= 0;
+}
+
+#else
+
+CacheMissCounter::CacheMissCounter() = default;
+CacheMissCounter::~CacheMissCounter() = default;
+void CacheMissCounter::Start() {}
+
+
+bool
+CacheMissCounter::Stop(CacheMisses &misses)
+{
+  misses = CacheMisses();
+  return false;
+}
+
+#endif  // __linux__
+
+}  // namespace utils
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
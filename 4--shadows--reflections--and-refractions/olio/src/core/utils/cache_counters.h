@@ -0,0 +1,59 @@
+//! \file       cache_counters.h
+//! \brief      Hardware counters for data cache misses
+
+#pragma once
+
+#include <cstdint>
+#include "core/types.h"
+
+namespace olio {
+namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
+namespace utils {
+
+//! \brief Data cache misses counted between CacheMissCounter::Start()
+//!        and CacheMissCounter::Stop(); -1 if a counter is unavailable
+struct CacheMisses {
+  int64_t l1{-1};          //!< L1 data cache read misses
+  int64_t last_level{-1};  //!< last-level cache read misses
+};
+
+
+//! \class CacheMissCounter
+//! \brief Counts the calling thread's data cache read misses with
+//! hardware performance counters (Linux perf events; user space only)
+//! \details perf has no generic L2 event, so the last-level cache
+//! stands in for the levels below L1. Counters are unavailable on
+//! other platforms, on hardware without them, or when perf access is
+//! restricted (see /proc/sys/kernel/perf_event_paranoid).
+class CacheMissCounter {
+public:
+  //! \brief Constructor; opens the counters
+  CacheMissCounter();
+
+  //! \brief Destructor; closes the counters
+  ~CacheMissCounter();
+
+  CacheMissCounter(const CacheMissCounter&) = delete;
+  CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+  //! \brief Whether at least one counter could be opened
+  //! \return True if Start() counts anything
+  bool IsAvailable() const {return l1_fd_ >= 0 || last_level_fd_ >= 0;}
+
+  //! \brief Reset the counters and start counting
+  void Start();
+
+  //! \brief Stop counting and read the counters
+  //! \param[out] misses Misses since Start()
+  //! \return True if at least one counter was read
+  bool Stop(CacheMisses &misses);
+protected:
+  int l1_fd_{-1};          //!< L1 data cache counter
+  int last_level_fd_{-1};  //!< last-level cache counter
+};
+
+}  // namespace utils
+}  // namespace OLIO_PRECISION_NAMESPACE
+}  // namespace core
+}  // namespace olio
@@ -16,6 +16,7 @@
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 namespace utils {
 
 using namespace std;
@@ -106,5 +107,6 @@ InstallSegfaultHandler()
 #endif
 
 }  // namespace utils
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
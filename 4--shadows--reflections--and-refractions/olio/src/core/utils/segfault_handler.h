@@ -5,14 +5,17 @@
 
 #include <memory>
 #include <string>
+#include "core/types.h"
 
 namespace olio {
 namespace core {
+inline namespace OLIO_PRECISION_NAMESPACE {
 namespace utils {
 
 void InstallSegfaultHandler();
 std::string Backtrace(int skip);
 
 }  // namespace utils
+}  // namespace OLIO_PRECISION_NAMESPACE
 }  // namespace core
 }  // namespace olio
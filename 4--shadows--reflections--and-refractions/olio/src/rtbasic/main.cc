@@ -15,30 +15,63 @@
 #include <spdlog/spdlog.h>
 
 #include "core/types.h"
-#include "core/node.h"
-#include "core/camera/camera.h"
-#include "core/geometry/surface.h"
-#include "core/parser/raytra_parser.h"
-#include "core/renderer/raytracer.h"
+#include "core/geometry/accelerator.h"
+#include "core/renderer/render_job.h"
+#include "core/renderer/tile_scheduler.h"
 #include "core/utils/segfault_handler.h"
-#include "core/light/light.h"
 
 using namespace olio::core;
 using namespace std;
 namespace po = boost::program_options;
 
-bool ParseArguments(int argc, char **argv, std::string *input_scene_name,
-                    std::string *output_name) {
+bool ParseArguments(int argc, char **argv, RenderJob *job,
+                    bool *use_float) {
+  std::string precision;
   po::options_description desc("options");
   try {
     desc.add_options()
       ("help,h", "print usage")
       ("input_scene,s",
-       po::value             (input_scene_name)->required(),
+       po::value             (&job->scene_file)->required(),
        "Input scene file")
       ("output,o",
-       po::value             (output_name)->required(),
-       "Output name");
+       po::value             (&job->output_file)->required(),
+       "Output name")
+      ("accel,a",
+       po::value             (&job->accel)->default_value("bvh"),
+       "Acceleration structure: list, bvh, lbvh, sbvh, bvh4, bvh8, cbvh, "
+       "grid, grid2, or kdtree")
+      ("accel_cache",
+       po::value             (&job->cache_dir)->default_value(""),
+       "Directory caching built BVHs across runs; empty disables caching")
+      ("cache_report",
+       po::bool_switch       (&job->cache_report),
+       "Log data cache misses of a test ray batch before and after "
+       "reordering BVHs")
+      ("merge_triangles",
+       po::bool_switch       (&job->merge_triangles),
+       "Merge consecutive triangles that share a material into indexed "
+       "meshes; each mesh has its own BVH, which the acceleration "
+       "structure and the accelerator cache treat as one surface")
+      ("threads,t",
+       po::value             (&job->threads)->default_value(0),
+       "Number of render threads; 0 uses all cores")
+      ("tile_order",
+       po::value             (&job->tile_order)->default_value("cost"),
+       "Order render tiles are handed to threads: scanline, cost "
+       "(most expensive first, from a low-res prepass), or hilbert")
+      ("packet",
+       po::value             (&job->packet_size)->default_value(4),
+       "Width and height of the pixel blocks whose primary rays are "
+       "traced as packets: 1 (no packets), 2, 4, or 8. 2x2 packets are "
+       "usually slower than single rays; 4 or 8 pay off")
+      ("progress_fd",
+       po::value             (&job->progress_fd)->default_value(-1),
+       "File descriptor render progress is written to as JSON lines; "
+       "-1 disables it")
+      ("precision,p",
+       po::value             (&precision)->default_value("double"),
+       "Floating point precision of the render: float or double");
 
     // parse arguments
     po::variables_map vm;
@@ -48,6 +81,36 @@ bool ParseArguments(int argc, char **argv, std::string *input_scene_name,
       return false;
     }
     po::notify(vm);
+    AcceleratorType accel_type;
+    if (!ParseAcceleratorType(job->accel, accel_type)) {
+      cout << desc << endl;
+      spdlog::error("Unknown acceleration structure: {}", job->accel);
+      return false;
+    }
+    TileOrder tile_order;
+    if (!ParseTileOrder(job->tile_order, tile_order)) {
+      cout << desc << endl;
+      spdlog::error("Unknown tile order: {}", job->tile_order);
+      return false;
+    }
+    if (job->packet_size != 1 && job->packet_size != 2 &&
+        job->packet_size != 4 && job->packet_size != 8) {
+      cout << desc << endl;
+      spdlog::error("Invalid packet size: {}", job->packet_size);
+      return false;
+    }
+    if (precision != "float" && precision != "double") {
+      cout << desc << endl;
+      spdlog::error("Unknown precision: {}", precision);
+      return false;
+    }
+    *use_float = precision == "float";
+#if !defined(OLIO_HAS_FLOAT_CORE)
+    if (*use_float) {
+      spdlog::error("rtbasic was built without the single precision core");
+      return false;
+    }
+#endif
   } catch(std::exception &e) {
     cout << desc << endl;
     spdlog::error("{}", e.what());
@@ -68,28 +131,15 @@ main(int argc, char **argv)
   srand(123543);
 
   // parse command line arguments
-  string input_scene_name, output_name;
-  if (!ParseArguments(argc, argv, &input_scene_name, &output_name))
+  RenderJob job;
+  bool use_float = false;
+  if (!ParseArguments(argc, argv, &job, &use_float))
     return -1;
 
-  // parse and render raytra scene
-  Vec2i image_size;
-  Surface::Ptr scene;
-  vector<Light::Ptr> lights;
-  Camera::Ptr camera;
-  if (!RaytraParser::ParseFile(input_scene_name, scene, lights, camera,
-      image_size) || !scene || !camera || image_size[0] <= 0 ||
-      image_size[1] <= 0) {
-    spdlog::error("Failed to parse scene file.");
-    return -1;
-  }
-
-  // render scene
-  RayTracer rt;
-  rt.SetImageHeight(static_cast<uint>(image_size[1]));
-  rt.Render(scene, lights, camera);
-
-  // save rendered image to file
-  rt.WriteImage(output_name, 2);
-  return 0;
+  // parse, render, and save the scene in the requested precision
+#if defined(OLIO_HAS_FLOAT_CORE)
+  if (use_float)
+    return single_precision::RunRenderJob(job) ? 0 : -1;
+#endif
+  return double_precision::RunRenderJob(job) ? 0 : -1;
 }
@@ -9,15 +9,974 @@
 //! \brief      main tests file
 //! \author     Hadi Fadaifard, 2022
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <random>
+#include <unordered_set>
+#include <vector>
 
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
+#include <boost/filesystem.hpp>
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+#include <tbb/parallel_for.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 #include "core/types.h"
+#include "core/ray.h"
+#include "core/ray_packet.h"
+#include "core/geometry/sphere.h"
+#include "core/geometry/triangle.h"
+#include "core/geometry/triangle_mesh.h"
+#include "core/geometry/triangle_packet.h"
+#include "core/geometry/surface_list.h"
+#include "core/geometry/bvh.h"
+#include "core/geometry/wide_bvh.h"
+#include "core/geometry/compressed_bvh.h"
+#include "core/geometry/grid_accelerator.h"
+#include "core/geometry/kd_tree.h"
+#include "core/geometry/instance.h"
+#include "core/geometry/accelerator_cache.h"
+#include "core/material/material_table.h"
+#include "core/material/phong_material.h"
+#include "core/material/phong_dielectric.h"
+#include "core/camera/camera.h"
+#include "core/light/light.h"
+#include "core/renderer/raytracer.h"
+#include "core/renderer/render_progress.h"
+#include "core/renderer/tile_scheduler.h"
+#include "core/parser/raytra_parser.h"
 
 using namespace std;
 using namespace olio::core;
 
 TEST_CASE("DoNothing") {
 }
+
+
+// random spheres and triangles shared by the accelerator tests
+static std::vector<Surface::Ptr> RandomSurfaces(size_t count, uint seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<Real> pos(-10, 10);
+  std::uniform_real_distribution<Real> size(static_cast<Real>(0.05),
+                                            static_cast<Real>(1.5));
+  std::vector<Surface::Ptr> surfaces;
+  for (size_t i = 0; i < count; ++i) {
+    Vec3r center{pos(rng), pos(rng), pos(rng)};
+    if (i % 3 == 0) {
+      surfaces.push_back(Sphere::Create(center, size(rng)));
+    } else {
+      std::vector<Vec3r> points;
+      for (int j = 0; j < 3; ++j)
+        points.push_back(center + size(rng) * Vec3r{pos(rng), pos(rng), pos(rng)} / 10);
+      surfaces.push_back(Triangle::Create(points));
+    }
+  }
+  return surfaces;
+}
+
+
+// check that an accelerator finds the same closest hits (and hit
+// normals) as SurfaceList, and that its occlusion query agrees on
+// segments ending at the target
+static void CheckAgainstSurfaceList(const std::vector<Surface::Ptr> &surfaces,
+                                    Surface::Ptr accelerator, uint seed) {
+  auto reference = SurfaceList::Create(surfaces);
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<Real> pos(-12, 12);
+  for (int i = 0; i < 2000; ++i) {
+    Vec3r origin{pos(rng), pos(rng), pos(rng)};
+    Vec3r target{pos(rng), pos(rng), pos(rng)};
+    Ray ray(origin, target - origin);
+    HitRecord expected, actual;
+    bool expected_hit = reference->Hit(ray, kEpsilon, kInfinity, expected);
+    bool actual_hit = accelerator->Hit(ray, kEpsilon, kInfinity, actual);
+    REQUIRE(expected_hit == actual_hit);
+    if (expected_hit) {
+      REQUIRE(actual.GetRayT() == Approx(expected.GetRayT()));
+      expected.ComputeAttributes(ray);
+      actual.ComputeAttributes(ray);
+      REQUIRE((actual.GetNormal() - expected.GetNormal()).norm() <
+              static_cast<Real>(1e-3));
+    }
+    REQUIRE(accelerator->Occluded(ray, kEpsilon, 1) ==
+            reference->Hit(ray, kEpsilon, 1, expected));
+  }
+}
+
+
+TEST_CASE("BVHMatchesSurfaceList") {
+  auto surfaces = RandomSurfaces(500, 7);
+  CheckAgainstSurfaceList(surfaces, BVH::Create(surfaces), 11);
+}
+
+
+TEST_CASE("BVHRefitTracksMovedSurfaces") {
+  auto surfaces = RandomSurfaces(500, 59);
+  auto bvh = BVH::Create(surfaces);
+
+  // move every surface a little: refitting keeps the hierarchy usable
+  std::mt19937 rng(61);
+  std::uniform_real_distribution<Real> offset(-0.5, 0.5);
+  auto move_all = [&](Real scale) {
+    for (auto &surface : surfaces) {
+      Vec3r delta = scale * Vec3r{offset(rng), offset(rng), offset(rng)};
+      if (auto sphere = std::dynamic_pointer_cast<Sphere>(surface)) {
+        sphere->SetCenter(sphere->GetCenter() + delta);
+        sphere->SetRadius(sphere->GetRadius() * Real(1.1));
+      } else if (auto triangle = std::dynamic_pointer_cast<Triangle>(surface)) {
+        std::vector<Vec3r> points;
+        triangle->GetPoints(points);
+        for (auto &point : points)
+          point += delta;
+        triangle->SetPoints(points);
+      }
+    }
+  };
+  // a ray along the normal of a triangle, hitting it at t = 5
+  auto triangle = std::dynamic_pointer_cast<Triangle>(surfaces[1]);
+  REQUIRE(triangle);
+  AABB old_bbox;
+  REQUIRE(triangle->GetBoundingBox(old_bbox));
+  std::vector<Vec3r> old_points;
+  triangle->GetPoints(old_points);
+  Vec3r centroid = (old_points[0] + old_points[1] + old_points[2]) / 3;
+  Ray probe{centroid - 5 * triangle->GetNormal(), triangle->GetNormal()};
+  HitRecord old_hit;
+  REQUIRE(triangle->Hit(probe, kEpsilon, kInfinity, old_hit));
+
+  move_all(1);
+  REQUIRE_FALSE(bvh->Update());
+  CheckAgainstSurfaceList(surfaces, bvh, 67);
+
+  // the triangle itself moved, not just the spheres
+  AABB new_bbox;
+  REQUIRE(triangle->GetBoundingBox(new_bbox));
+  REQUIRE(new_bbox.GetMin() != old_bbox.GetMin());
+  REQUIRE(new_bbox.GetMax() != old_bbox.GetMax());
+  HitRecord new_hit;
+  if (triangle->Hit(probe, kEpsilon, kInfinity, new_hit))
+    REQUIRE(new_hit.GetRayT() != old_hit.GetRayT());
+
+  // scattering the surfaces degrades the refitted tree: rebuild
+  move_all(40);
+  REQUIRE(bvh->Update());
+  CheckAgainstSurfaceList(surfaces, bvh, 71);
+}
+
+
+TEST_CASE("ParallelBVHBuildIsDeterministic") {
+  // enough surfaces for parallel binning, partitioning, and subtrees
+  auto surfaces = RandomSurfaces(20000, 83);
+  BVH::Ptr serial, parallel;
+  tbb::task_arena(1).execute([&]() {serial = BVH::Create(surfaces);});
+  tbb::task_arena(4).execute([&]() {parallel = BVH::Create(surfaces);});
+  const auto &serial_nodes = serial->GetNodes();
+  const auto &parallel_nodes = parallel->GetNodes();
+  REQUIRE(serial_nodes.size() == parallel_nodes.size());
+  CHECK(std::equal(serial_nodes.begin(), serial_nodes.end(), parallel_nodes.begin(),
+                   [](const LinearBVHNode &a, const LinearBVHNode &b) {
+                     return std::memcmp(&a, &b, sizeof(LinearBVHNode)) == 0;}));
+  CHECK(serial->GetPrimitives() == parallel->GetPrimitives());
+  CheckAgainstSurfaceList(surfaces, parallel, 89);
+}
+
+
+TEST_CASE("LinearBVHMatchesSurfaceList") {
+  // enough surfaces for the parallel build and emit paths
+  auto surfaces = RandomSurfaces(20000, 47);
+  CheckAgainstSurfaceList(surfaces, BVH::Create(surfaces,
+                                                BVH::BuildMethod::kLinear), 53);
+}
+
+
+TEST_CASE("SpatialSplitBVHMatchesSurfaceList") {
+  // long, thin triangles crossing the scene make spatial splits pay off
+  auto surfaces = RandomSurfaces(500, 67);
+  std::mt19937 rng(71);
+  std::uniform_real_distribution<Real> pos(-10, 10);
+  for (int i = 0; i < 200; ++i) {
+    Vec3r start{pos(rng), pos(rng), pos(rng)};
+    Vec3r end{pos(rng), pos(rng), pos(rng)};
+    Vec3r width{pos(rng) / 50, pos(rng) / 50, pos(rng) / 50};
+    surfaces.push_back(Triangle::Create(std::vector<Vec3r>{start, end,
+                                                            start + width}));
+  }
+  auto sbvh = BVH::Create(surfaces, BVH::BuildMethod::kSpatialSplit);
+  CHECK(sbvh->GetPrimitives().size() > surfaces.size());
+  CHECK(sbvh->GetSAHCost() < BVH::Create(surfaces)->GetSAHCost());
+  CheckAgainstSurfaceList(surfaces, sbvh, 73);
+
+  // rebuilding drops the duplicated references first
+  sbvh->Rebuild();
+  CheckAgainstSurfaceList(surfaces, sbvh, 79);
+}
+
+
+// a sphere subclass that is never hit, to tell it apart from a
+// sliced Sphere copy
+class HiddenSphere : public Sphere {
+public:
+  HiddenSphere(const Vec3r &center, Real radius) : Sphere(center, radius) {}
+  bool Hit(const Ray &, Real, Real, HitRecord &) override {return false;}
+  bool Occluded(const Ray &, Real, Real) override {return false;}
+};
+
+
+TEST_CASE("ReorderedBVHKeepsSurfaceSubclasses") {
+  auto surfaces = RandomSurfaces(600, 149);
+  std::unordered_set<const Surface*> hidden;
+  for (size_t i = 0; i < surfaces.size(); i += 6) {
+    auto sphere = std::static_pointer_cast<Sphere>(surfaces[i]);
+    surfaces[i] = std::make_shared<HiddenSphere>(sphere->GetCenter(),
+                                                 sphere->GetRadius());
+    hidden.insert(surfaces[i].get());
+  }
+  auto bvh = BVH::Create(surfaces);
+  bvh->ReorderPrimitives();
+  size_t kept = 0;
+  for (const auto &primitive : bvh->GetPrimitives())
+    kept += hidden.count(primitive.get());
+  CHECK(kept == hidden.size());
+  CheckAgainstSurfaceList(surfaces, bvh, 151);
+}
+
+
+TEST_CASE("ReorderedBVHMatchesSurfaceList") {
+  auto surfaces = RandomSurfaces(3000, 103);
+  std::unordered_set<const Surface*> inputs;
+  for (const auto &surface : surfaces)
+    inputs.insert(surface.get());
+  for (auto method : {BVH::BuildMethod::kBinnedSAH,
+                      BVH::BuildMethod::kSpatialSplit}) {
+    auto bvh = BVH::Create(surfaces, method);
+    Real cost = bvh->GetSAHCost();
+    bvh->ReorderNodes();
+    CHECK(bvh->GetSAHCost() == Approx(cost));
+    CheckAgainstSurfaceList(surfaces, bvh, 107);
+
+    // leaves reference copies of the input surfaces
+    bvh->ReorderPrimitives();
+    for (const auto &primitive : bvh->GetPrimitives())
+      REQUIRE_FALSE(inputs.count(primitive.get()));
+
+    // first references of the copies follow each other in memory, in
+    // leaf order
+    std::unordered_set<const Surface*> seen;
+    const char *previous = nullptr;
+    for (const auto &primitive : bvh->GetPrimitives()) {
+      if (!seen.insert(primitive.get()).second)
+        continue;
+      auto address = reinterpret_cast<const char*>(primitive.get());
+      if (previous) {
+        REQUIRE(address > previous);
+        REQUIRE(address - previous <= static_cast<std::ptrdiff_t>(
+                  std::max(sizeof(Sphere), sizeof(Triangle)) + 32));
+      }
+      previous = address;
+    }
+    CheckAgainstSurfaceList(surfaces, bvh, 109);
+    bvh->Refit();
+    CheckAgainstSurfaceList(surfaces, bvh, 113);
+  }
+}
+
+
+TEST_CASE("AcceleratorCacheRestoresBVHs") {
+  auto surfaces = RandomSurfaces(3000, 97);
+  auto directory = boost::filesystem::temp_directory_path() /
+    boost::filesystem::unique_path();
+  const uint64_t key = AcceleratorCache::Hash("test", 4);
+  BVH::Ptr built, built_spatial;
+  {
+    AcceleratorCache cache(directory.string(), key);
+    built = cache.GetBVH(surfaces, BVH::BuildMethod::kBinnedSAH);
+    built_spatial = cache.GetBVH(surfaces, BVH::BuildMethod::kSpatialSplit);
+    CHECK(cache.GetRestoredCount() == 0);
+    REQUIRE(cache.Save());
+  }
+  {
+    AcceleratorCache cache(directory.string(), key);
+    auto restored = cache.GetBVH(surfaces, BVH::BuildMethod::kBinnedSAH);
+    auto restored_spatial = cache.GetBVH(surfaces,
+                                         BVH::BuildMethod::kSpatialSplit);
+    CHECK(cache.GetRestoredCount() == 2);
+    REQUIRE(restored->GetNodes().size() == built->GetNodes().size());
+    CHECK(std::memcmp(restored->GetNodes().data(), built->GetNodes().data(),
+                      built->GetNodes().size() * sizeof(LinearBVHNode)) == 0);
+    CHECK(restored->GetPrimitives() == built->GetPrimitives());
+    CHECK(restored_spatial->GetPrimitives() == built_spatial->GetPrimitives());
+    CheckAgainstSurfaceList(surfaces, restored_spatial, 101);
+  }
+  {
+    // a root whose child offset wraps around in 32 bits is rejected
+    // and the BVH is rebuilt
+    std::string filename = AcceleratorCache(directory.string(), key).
+      GetFileName();
+    std::string contents;
+    {
+      std::ifstream in(filename, std::ios::binary);
+      contents.assign(std::istreambuf_iterator<char>(in),
+                      std::istreambuf_iterator<char>());
+    }
+    const auto &nodes = built->GetNodes();
+    auto position = contents.find(std::string(
+      reinterpret_cast<const char*>(nodes.data()),
+      nodes.size() * sizeof(LinearBVHNode)));
+    REQUIRE(position != std::string::npos);
+    REQUIRE(!nodes[0].IsLeaf());
+    const uint32_t bad_offset = 0xFFFFFFFF;
+    contents.replace(position + offsetof(LinearBVHNode, offset),
+                     sizeof(bad_offset),
+                     reinterpret_cast<const char*>(&bad_offset),
+                     sizeof(bad_offset));
+    {
+      std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+      out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    }
+    AcceleratorCache cache(directory.string(), key);
+    auto rebuilt = cache.GetBVH(surfaces, BVH::BuildMethod::kBinnedSAH);
+    CHECK(cache.GetRestoredCount() == 0);
+    CheckAgainstSurfaceList(surfaces, rebuilt, 103);
+  }
+  {
+    // a different surface list makes the cached BVH stale
+    AcceleratorCache cache(directory.string(), key);
+    surfaces.pop_back();
+    cache.GetBVH(surfaces, BVH::BuildMethod::kBinnedSAH);
+    CHECK(cache.GetRestoredCount() == 0);
+  }
+  boost::filesystem::remove_all(directory);
+}
+
+
+TEST_CASE("WideBVHMatchesSurfaceList") {
+  auto surfaces = RandomSurfaces(500, 13);
+  CheckAgainstSurfaceList(surfaces, BVH4::Create(surfaces), 17);
+  CheckAgainstSurfaceList(surfaces, BVH8::Create(surfaces), 19);
+}
+
+
+TEST_CASE("CompressedBVHMatchesSurfaceList") {
+  // surfaces far from the origin stress the quantization grid's rounding
+  auto surfaces = RandomSurfaces(3000, 29);
+  surfaces.push_back(Sphere::Create(Vec3r{1e4, -3e3, 7e2},
+                                    static_cast<Real>(0.01)));
+  auto bvh = BVH::Create(surfaces);
+  auto compressed = CompressedBVH::Create(*bvh);
+  CHECK(compressed->GetNodes().size() * sizeof(CompressedBVHNode) * 3 <
+        BVH8::Create(*bvh)->GetNodes().size() * sizeof(WideBVHNode<8>));
+  CheckAgainstSurfaceList(surfaces, compressed, 31);
+
+  // a single leaf is wrapped in a root node
+  std::vector<Surface::Ptr> single{surfaces[0]};
+  CheckAgainstSurfaceList(single, CompressedBVH::Create(single), 37);
+}
+
+
+// ray-triangle test as it was before triangle records: the edges are
+// computed from the points on every call
+static bool PerCallRayTriangleHit(const Vec3r &p0, const Vec3r &p1,
+                                  const Vec3r &p2, const Ray &ray, Real tmin,
+                                  Real tmax, Real &ray_t, Vec2r &uv) {
+  const Vec3r &ray_dir = ray.GetDirection();
+  const Vec3r &ray_origin = ray.GetOrigin();
+  Real a = p0[0] - p1[0];
+  Real b = p0[1] - p1[1];
+  Real c = p0[2] - p1[2];
+  Real d = p0[0] - p2[0];
+  Real e = p0[1] - p2[1];
+  Real f = p0[2] - p2[2];
+  Real g = ray_dir[0];
+  Real h = ray_dir[1];
+  Real i = ray_dir[2];
+  Real j = p0[0] - ray_origin[0];
+  Real k = p0[1] - ray_origin[1];
+  Real l = p0[2] - ray_origin[2];
+  Real ei_minus_hf = e * i - h * f;
+  Real gf_minus_di = g * f - d * i;
+  Real dh_minus_eg = d * h - e * g;
+  Real ak_minus_jb = a * k - j * b;
+  Real jc_minus_al = j * c - a * l;
+  Real bl_minus_kc = b * l - k * c;
+  Real M = a * ei_minus_hf + b * gf_minus_di + c * dh_minus_eg;
+  if (std::fabs(M) < kEpsilon)
+    return false;
+  ray_t = -(f * ak_minus_jb + e * jc_minus_al + d * bl_minus_kc) / M;
+  if (ray_t < tmin || ray_t > tmax)
+    return false;
+  Real gamma = (i * ak_minus_jb + h * jc_minus_al + g * bl_minus_kc) / M;
+  if (gamma < 0 || gamma > 1)
+    return false;
+  Real beta = (j * ei_minus_hf + k * gf_minus_di + l * dh_minus_eg) / M;
+  if (beta < 0 || beta > 1 - gamma)
+    return false;
+  uv[0] = beta;
+  uv[1] = gamma;
+  return true;
+}
+
+
+TEST_CASE("TriangleRecordsMatchPerCallEdges") {
+  // random rays, and rays aimed at points on the edges and corners,
+  // where rounding decides between hit and miss
+  std::mt19937 rng(127);
+  std::uniform_real_distribution<Real> pos(-10, 10);
+  std::uniform_real_distribution<Real> unit(0, 1);
+  uint hit_count = 0, edge_hit_count = 0;
+  for (int n = 0; n < 20000; ++n) {
+    Vec3r p0{pos(rng), pos(rng), pos(rng)};
+    Vec3r p1{pos(rng), pos(rng), pos(rng)};
+    Vec3r p2{pos(rng), pos(rng), pos(rng)};
+    TriangleRecord record{p0, p1, p2};
+    Vec3r origin{pos(rng), pos(rng), pos(rng)};
+    Vec3r target;
+    bool on_edge = n % 2;
+    if (on_edge) {
+      const Vec3r *corners[3] = {&p0, &p1, &p2};
+      uint edge = static_cast<uint>(n % 6) / 2;
+      Real s = n % 8 < 2 ? Real(n % 8) : unit(rng);
+      target = *corners[edge] + s * (*corners[(edge + 1) % 3] -
+                                     *corners[edge]);
+    } else {
+      target = Vec3r{pos(rng), pos(rng), pos(rng)};
+    }
+    Ray ray(origin, target - origin);
+
+    Real expected_t = -1, record_t = -1, points_t = -1;
+    Vec2r expected_uv{-1, -1}, record_uv{-1, -1}, points_uv{-1, -1};
+    bool expected = PerCallRayTriangleHit(p0, p1, p2, ray, kEpsilon,
+                                          kInfinity, expected_t, expected_uv);
+    REQUIRE(Triangle::RayTriangleHit(record, ray, kEpsilon, kInfinity,
+                                     record_t, record_uv) == expected);
+    REQUIRE(Triangle::RayTriangleHit(p0, p1, p2, ray, kEpsilon, kInfinity,
+                                     points_t, points_uv) == expected);
+    if (!expected)
+      continue;
+    REQUIRE(record_t == expected_t);
+    REQUIRE(record_uv == expected_uv);
+    REQUIRE(points_t == expected_t);
+    REQUIRE(points_uv == expected_uv);
+    ++hit_count;
+    if (on_edge)
+      ++edge_hit_count;
+  }
+  // half of the rays aim at edges; both outcomes must be covered
+  CHECK(hit_count > 100);
+  CHECK(edge_hit_count > 100);
+  CHECK(edge_hit_count < 9900);
+}
+
+
+TEST_CASE("TrianglePacketsMatchScalarTriangles") {
+  // stacks of 1 to 4 overlapping triangles, so that rays hit several
+  // lanes and the packet has to pick the nearest; some stacks repeat
+  // a triangle to produce ties
+  std::mt19937 rng(131);
+  std::uniform_real_distribution<Real> pos(-1, 1);
+  uint multi_hit_count = 0;
+  for (int n = 0; n < 20000; ++n) {
+    uint count = static_cast<uint>(n % 4) + 1;
+    TrianglePacket packet(7);
+    std::vector<TriangleRecord> records;
+    for (uint lane = 0; lane < count; ++lane) {
+      Real z = 2 * pos(rng);
+      TriangleRecord record{Vec3r{-2 + pos(rng), -2 + pos(rng), z + pos(rng)},
+                            Vec3r{2 + pos(rng), -1 + pos(rng), z + pos(rng)},
+                            Vec3r{pos(rng), 2 + pos(rng), z + pos(rng)}};
+      if (lane && n % 5 == 0)
+        record = records.back();
+      records.push_back(record);
+      packet.Set(lane, record);
+    }
+    REQUIRE(packet.count == count);
+    Vec3r origin{3 * pos(rng), 3 * pos(rng), -10 + pos(rng)};
+    Vec3r target{2 * pos(rng), 2 * pos(rng), pos(rng)};
+    Ray ray(origin, target - origin);
+    Real tmax = n % 3 ? kInfinity : 1 + pos(rng) / 10;
+
+    // sequential scalar tests, lowering tmax after each hit
+    int expected_lane = -1;
+    Real expected_t = 0, closest = tmax;
+    Vec2r expected_uv{0, 0};
+    uint hits = 0;
+    for (uint lane = 0; lane < count; ++lane) {
+      Real t;
+      Vec2r uv;
+      if (Triangle::RayTriangleHit(records[lane], ray, kEpsilon, closest, t,
+                                   uv)) {
+        expected_lane = static_cast<int>(lane);
+        expected_t = t;
+        expected_uv = uv;
+        closest = t;
+        ++hits;
+      }
+    }
+    if (hits > 1)
+      ++multi_hit_count;
+
+    Real t = -1;
+    Vec2r uv{-1, -1};
+    REQUIRE(packet.Intersect(ray, kEpsilon, tmax, t, uv) == expected_lane);
+    if (expected_lane < 0)
+      continue;
+    REQUIRE(t == expected_t);
+    REQUIRE(uv == expected_uv);
+  }
+  CHECK(multi_hit_count > 1000);
+}
+
+
+TEST_CASE("TriangleMeshMatchesTriangles") {
+  // a strip of triangles sharing vertices, plus an invalid index
+  std::mt19937 rng(47);
+  std::uniform_real_distribution<Real> pos(-10, 10);
+  std::vector<Vec3r> vertices;
+  for (int i = 0; i < 2002; ++i)
+    vertices.push_back(Vec3r{pos(rng), pos(rng), pos(rng)} / (i % 7 ? 3 : 1));
+  std::vector<uint32_t> indices;
+  std::vector<Surface::Ptr> triangles;
+  for (uint32_t i = 0; i + 2 < vertices.size(); ++i) {
+    indices.insert(indices.end(), {i, i + 1, i + 2});
+    triangles.push_back(Triangle::Create(std::vector<Vec3r>{
+          vertices[i], vertices[i + 1], vertices[i + 2]}));
+  }
+  indices.insert(indices.end(), {0, 1, 5000});
+  auto mesh = TriangleMesh::Create(vertices, indices);
+  REQUIRE(mesh->GetTriangleCount() == triangles.size());
+  CheckAgainstSurfaceList(triangles, mesh, 53);
+}
+
+
+TEST_CASE("MeshFilesAreReadRelativeToTheScene") {
+  // one quad and one triangle, in a directory next to the scene file
+  auto directory = boost::filesystem::temp_directory_path() /
+    boost::filesystem::unique_path();
+  boost::filesystem::create_directories(directory / "meshes");
+  {
+    std::ofstream obj((directory / "meshes" / "shapes.obj").string());
+    obj << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\n"
+        << "f 1 2 3 4\nf 2 5 3\n";
+  }
+  auto write_scene = [&](const std::string &mesh_name) {
+    auto scene_path = directory / "scene.txt";
+    std::ofstream scene(scene_path.string());
+    scene << "c 0 0 5 0 0 -1 1 1 1 8 8\n"
+          << "m .5 .5 .5 0 0 0 1 0 0 0\n"
+          << "w " << mesh_name << "\n";
+    return scene_path.string();
+  };
+
+  Surface::Ptr scene;
+  std::vector<Light::Ptr> lights;
+  Camera::Ptr camera;
+  Vec2i image_size;
+  MaterialTable materials;
+  REQUIRE(RaytraParser::ParseFile(write_scene("meshes/shapes.obj"), scene,
+                                  lights, camera, image_size, materials,
+                                  AcceleratorType::kSurfaceList));
+  auto list = std::dynamic_pointer_cast<SurfaceList>(scene);
+  REQUIRE(list);
+  REQUIRE(list->GetSurfaces().size() == 1);
+  auto mesh = std::dynamic_pointer_cast<TriangleMesh>(list->GetSurfaces()[0]);
+  REQUIRE(mesh);
+  CHECK(mesh->GetVertices().size() == 5);
+  CHECK(mesh->GetTriangleCount() == 3);
+  CHECK(mesh->GetIndices() == std::vector<uint32_t>{0, 1, 2, 0, 2, 3,
+                                                     1, 4, 2});
+
+  // a missing mesh file fails the parse
+  lights.clear();
+  CHECK_FALSE(RaytraParser::ParseFile(write_scene("meshes/missing.obj"),
+                                      scene, lights, camera, image_size,
+                                      materials,
+                                      AcceleratorType::kSurfaceList));
+  boost::filesystem::remove_all(directory);
+}
+
+
+TEST_CASE("GridMatchesSurfaceList") {
+  auto surfaces = RandomSurfaces(500, 23);
+
+  // a dense cluster of small spheres, so the two-level grid refines cells
+  std::mt19937 rng(29);
+  std::uniform_real_distribution<Real> pos(0, 1);
+  for (int i = 0; i < 300; ++i)
+    surfaces.push_back(Sphere::Create(Vec3r{pos(rng), pos(rng), pos(rng)},
+                                      Real(0.03)));
+  CheckAgainstSurfaceList(surfaces, GridAccelerator::Create(surfaces, false), 31);
+  CheckAgainstSurfaceList(surfaces, GridAccelerator::Create(surfaces, true), 37);
+}
+
+
+TEST_CASE("KdTreeMatchesSurfaceList") {
+  auto surfaces = RandomSurfaces(500, 41);
+  CheckAgainstSurfaceList(surfaces, KdTree::Create(surfaces), 43);
+}
+
+
+TEST_CASE("InstancesMatchTransformedCopies") {
+  // place one group three times, scaled by 2 and translated, and
+  // compare against explicitly transformed copies of its surfaces
+  auto group = RandomSurfaces(60, 73);
+  auto group_bvh = BVH::Create(group);
+  std::vector<Vec3r> offsets{{-6, 0, 0}, {5, 3, -2}, {0, -7, 6}};
+  std::vector<Surface::Ptr> instances, copies;
+  for (const auto &offset : offsets) {
+    Mat4r transform = Mat4r::Identity() * 2;
+    transform(3, 3) = 1;
+    transform.topRightCorner<3, 1>() = offset;
+    instances.push_back(Instance::Create(group_bvh, transform));
+    for (auto &surface : group) {
+      if (auto sphere = std::dynamic_pointer_cast<Sphere>(surface)) {
+        copies.push_back(Sphere::Create(2 * sphere->GetCenter() + offset,
+                                        2 * sphere->GetRadius()));
+      } else if (auto triangle = std::dynamic_pointer_cast<Triangle>(surface)) {
+        std::vector<Vec3r> points;
+        triangle->GetPoints(points);
+        for (auto &point : points)
+          point = 2 * point + offset;
+        copies.push_back(Triangle::Create(points));
+      }
+    }
+  }
+  CheckAgainstSurfaceList(copies, BVH::Create(instances), 79);
+
+  // rotated and non-uniformly scaled placement of the group's
+  // triangles: hit normals go through the instance's normal matrix
+  std::vector<Surface::Ptr> triangles, triangle_copies;
+  Mat3r linear = Eigen::AngleAxis<Real>(Real(0.7),
+                                        Vec3r{1, 2, 3}.normalized()).toRotationMatrix()
+    * Vec3r{3, Real(0.5), Real(1.5)}.asDiagonal();
+  Mat4r transform = Mat4r::Identity();
+  transform.topLeftCorner<3, 3>() = linear;
+  transform.topRightCorner<3, 1>() = Vec3r{1, -2, 4};
+  for (auto &surface : group) {
+    if (auto triangle = std::dynamic_pointer_cast<Triangle>(surface)) {
+      triangles.push_back(triangle);
+      std::vector<Vec3r> points;
+      triangle->GetPoints(points);
+      for (auto &point : points)
+        point = linear * point + transform.topRightCorner<3, 1>();
+      triangle_copies.push_back(Triangle::Create(points));
+    }
+  }
+  std::vector<Surface::Ptr> placed{Instance::Create(BVH::Create(triangles),
+                                                    transform)};
+  CheckAgainstSurfaceList(triangle_copies, BVH::Create(placed), 89);
+
+  // singular transforms are rejected, whatever their scale
+  Mat4r flat = Mat4r::Identity();
+  flat.topLeftCorner<3, 3>() = 1000 * linear;
+  flat.block<3, 1>(0, 2) = flat.col(0).head<3>() - 2 * flat.col(1).head<3>();
+  REQUIRE_FALSE(Instance::Create(group_bvh, flat));
+  Mat4r small = Mat4r::Identity() * static_cast<Real>(1e-3);
+  small(3, 3) = 1;
+  REQUIRE(Instance::Create(group_bvh, small));
+}
+
+
+TEST_CASE("MaterialTableAssignsIdsByMaterial") {
+  MaterialTable materials;
+  auto phong = PhongMaterial::Create(
+    Vec3r::Constant(static_cast<Real>(.1)),
+    Vec3r{static_cast<Real>(.5), static_cast<Real>(.2), static_cast<Real>(.1)},
+    Vec3r{1, 1, 1}, static_cast<Real>(20),
+    Vec3r::Constant(static_cast<Real>(.3)));
+  auto glass = PhongDielectric::Create(static_cast<Real>(1.5));
+  auto phong_id = materials.Add(phong);
+  auto glass_id = materials.Add(glass);
+  REQUIRE(materials.Add(nullptr) == MaterialTable::kNoMaterial);
+  REQUIRE(materials.Add(phong) == phong_id);
+  REQUIRE(phong_id != glass_id);
+  REQUIRE(materials.GetSize() == 3);
+
+  const auto &phong_params = materials.Get(phong_id);
+  REQUIRE(phong_params.type == MaterialType::kPhong);
+  REQUIRE(phong_params.diffuse == phong->GetDiffuse());
+  REQUIRE(phong_params.mirror == phong->GetMirror());
+  REQUIRE(phong_params.shininess == phong->GetShininess());
+  const auto &glass_params = materials.Get(glass_id);
+  REQUIRE(glass_params.type == MaterialType::kDielectric);
+  REQUIRE(glass_params.ior == static_cast<Real>(1.5));
+  REQUIRE(materials.Get(1000).type == MaterialType::kNone);
+}
+
+
+#ifndef WIN32
+// reads the JSON stream back through a POSIX pipe
+TEST_CASE("RenderProgressSumsThreadCounters") {
+  // count from all arena threads and read the final JSON line back
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  tbb::task_arena arena(4);
+  arena.initialize();
+  RenderProgress progress;
+  progress.SetJsonFd(fds[1]);
+  progress.SetInterval(std::chrono::milliseconds(1));
+  progress.Start(1000, static_cast<size_t>(arena.max_concurrency()));
+  arena.execute([&]() {
+    tbb::parallel_for(0, 1000, [&](int) {
+      auto slot = tbb::this_task_arena::current_thread_index();
+      progress.Add(static_cast<size_t>(slot), 1, 3);
+    });
+  });
+  progress.Finish();
+  close(fds[1]);
+  std::string output;
+  char buffer[4096];
+  ssize_t size;
+  while ((size = read(fds[0], buffer, sizeof(buffer))) > 0)
+    output.append(buffer, static_cast<size_t>(size));
+  close(fds[0]);
+  auto last_line = output.substr(output.rfind("{\"event\""));
+  REQUIRE(last_line.find("\"event\":\"finish\"") != std::string::npos);
+  REQUIRE(last_line.find("\"done_pixels\":1000,") != std::string::npos);
+  REQUIRE(last_line.find("\"rays\":3000,") != std::string::npos);
+  REQUIRE(last_line.find("\"eta\":0.000") != std::string::npos);
+}
+#endif
+
+
+TEST_CASE("TileOrdersArePermutations") {
+  // every order visits each tile once; Hilbert steps between
+  // neighbouring tiles on a square power-of-two grid and cost order
+  // is most expensive first
+  std::vector<double> costs(12 * 7);
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> distribution(0, 1);
+  for (auto &cost : costs)
+    cost = distribution(generator);
+  for (auto order : {TileOrder::kScanline, TileOrder::kCost,
+                     TileOrder::kHilbert}) {
+    auto tiles = OrderTiles(12, 7, order, costs);
+    auto sorted = tiles;
+    std::sort(sorted.begin(), sorted.end());
+    REQUIRE(sorted.size() == costs.size());
+    for (uint32_t tile = 0; tile < sorted.size(); ++tile)
+      REQUIRE(sorted[tile] == tile);
+    if (order == TileOrder::kCost)
+      for (size_t i = 1; i < tiles.size(); ++i)
+        REQUIRE(costs[tiles[i - 1]] >= costs[tiles[i]]);
+  }
+  auto tiles = OrderTiles(16, 16, TileOrder::kHilbert);
+  for (size_t i = 1; i < tiles.size(); ++i) {
+    int dx = static_cast<int>(tiles[i] % 16) - static_cast<int>(tiles[i - 1] % 16);
+    int dy = static_cast<int>(tiles[i] / 16) - static_cast<int>(tiles[i - 1] / 16);
+    REQUIRE(std::abs(dx) + std::abs(dy) == 1);
+  }
+}
+
+
+TEST_CASE("BVHPacketsMatchSingleRays") {
+  // 8x8 pinhole packets looking at the scene from several directions
+  // (coherent), plus packets of random rays (incoherent, traced one by
+  // one), must find the same hits as tracing every ray alone. Checked
+  // for a BVH over surfaces, a triangle mesh, and instances of both
+  auto check_packets = [](Surface::Ptr scene, uint seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<Real> pos(-12, 12);
+    std::uniform_real_distribution<Real> offset(static_cast<Real>(-.5),
+                                                static_cast<Real>(.5));
+    for (int i = 0; i < 200; ++i) {
+      Vec3r eye{pos(rng), pos(rng), pos(rng)};
+      Vec3r target{pos(rng) / 4, pos(rng) / 4, pos(rng) / 4};
+      bool coherent = i % 4 != 0;
+      RayPacket packet;
+      for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+          Vec3r dir = target - eye + Vec3r{static_cast<Real>(x) * static_cast<Real>(.05),
+                                           static_cast<Real>(y) * static_cast<Real>(.05), 0};
+          if (!coherent)
+            dir = Vec3r{offset(rng), offset(rng), offset(rng)};
+          packet.Add(Ray(eye, dir), kInfinity);
+        }
+      }
+      HitRecord hit_records[RayPacket::kMaxSize];
+      uint64_t active = packet.AllMask() & ~uint64_t(0x10);  // skip lane 4
+      uint64_t hits = scene->HitPacket(packet, active, hit_records);
+      REQUIRE((hits & ~active) == 0);
+      for (uint32_t lane = 0; lane < packet.size; ++lane) {
+        if (!(active & (uint64_t(1) << lane)))
+          continue;
+        HitRecord expected;
+        bool expected_hit = scene->Hit(packet.rays[lane], kEpsilon, kInfinity,
+                                       expected);
+        REQUIRE(expected_hit == static_cast<bool>(hits & (uint64_t(1) << lane)));
+        if (!expected_hit)
+          continue;
+        const HitRecord &actual = hit_records[lane];
+        REQUIRE(actual.GetRayT() == expected.GetRayT());
+        REQUIRE(actual.GetSurface() == expected.GetSurface());
+        REQUIRE(actual.GetPrimitiveId() == expected.GetPrimitiveId());
+        REQUIRE(packet.tmax[lane] == expected.GetRayT());
+        REQUIRE(actual.HasAttributes() == expected.HasAttributes());
+        if (expected.HasAttributes()) {
+          REQUIRE(actual.GetPoint() == expected.GetPoint());
+          REQUIRE(actual.GetNormal() == expected.GetNormal());
+        }
+      }
+    }
+  };
+
+  auto bvh = BVH::Create(RandomSurfaces(800, 97));
+  check_packets(bvh, 101);
+
+  std::mt19937 rng(103);
+  std::uniform_real_distribution<Real> pos(-10, 10);
+  std::vector<Vec3r> vertices;
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < 1500; ++i) {
+    Vec3r center{pos(rng), pos(rng), pos(rng)};
+    for (int j = 0; j < 3; ++j)
+      vertices.push_back(center + Vec3r{pos(rng), pos(rng), pos(rng)} / 8);
+    indices.insert(indices.end(), {3 * i, 3 * i + 1, 3 * i + 2});
+  }
+  auto mesh = TriangleMesh::Create(vertices, indices);
+  check_packets(mesh, 107);
+
+  // rotated and scaled placements of the BVH and the mesh
+  Mat4r transform = Mat4r::Identity();
+  transform.topLeftCorner<3, 3>() =
+    Eigen::AngleAxis<Real>(Real(0.4), Vec3r{3, 1, 2}.normalized()).toRotationMatrix()
+    * Vec3r{Real(0.5), Real(0.8), Real(0.6)}.asDiagonal();
+  std::vector<Surface::Ptr> instances;
+  for (const auto &object : std::vector<Surface::Ptr>{bvh, mesh}) {
+    for (const auto &offset : {Vec3r{-4, 2, 1}, Vec3r{3, -3, -2}}) {
+      transform.topRightCorner<3, 1>() = offset;
+      instances.push_back(Instance::Create(object, transform));
+    }
+  }
+  check_packets(BVH::Create(instances), 109);
+}
+
+
+TEST_CASE("RenderIsIndependentOfThreadsPacketsAndTileOrder") {
+  // a small scene with mirror and glass surfaces, rendered at a size
+  // that leaves partial tiles and packets at the image borders
+  auto surfaces = RandomSurfaces(300, 137);
+  MaterialTable materials;
+  auto phong = PhongMaterial::Create(
+    Vec3r::Constant(static_cast<Real>(.1)),
+    Vec3r{static_cast<Real>(.5), static_cast<Real>(.2), static_cast<Real>(.1)},
+    Vec3r{1, 1, 1}, static_cast<Real>(20),
+    Vec3r::Constant(static_cast<Real>(.3)));
+  auto glass = PhongDielectric::Create(static_cast<Real>(1.5));
+  auto phong_id = materials.Add(phong);
+  auto glass_id = materials.Add(glass);
+  for (size_t i = 0; i < surfaces.size(); ++i) {
+    bool is_glass = i % 5 == 0;
+    surfaces[i]->SetMaterial(is_glass ? Material::Ptr(glass) : Material::Ptr(phong));
+    surfaces[i]->SetMaterialId(is_glass ? glass_id : phong_id);
+  }
+  Surface::Ptr scene = BVH::Create(surfaces);
+  std::vector<Light::Ptr> lights{
+    PointLight::Create(Vec3r{5, 12, 20}, Vec3r{200, 200, 200}),
+    AmbientLight::Create(Vec3r::Constant(static_cast<Real>(.2)))};
+  auto camera = Camera::Create(Vec3r{0, 0, 30}, Vec3r{0, 0, 0},
+                               Vec3r{0, 1, 0}, Real(40), Real(1.5));
+
+  auto render = [&](uint threads, uint packet_size, TileOrder order) {
+    RayTracer rt;
+    rt.SetMaterialTable(materials);
+    rt.SetImageHeight(121);
+    rt.SetTileSize(8);
+    rt.SetThreadCount(threads);
+    rt.SetPacketSize(packet_size);
+    rt.SetTileOrder(order);
+    REQUIRE(rt.Render(scene, lights, camera));
+    return rt.GetRenderedImage();
+  };
+  // allow four threads even on machines with fewer cores
+  tbb::global_control parallelism(
+    tbb::global_control::max_allowed_parallelism, 4);
+  auto reference = render(1, 1, TileOrder::kScanline);
+  REQUIRE(reference.isContinuous());
+  const size_t size = reference.total() * reference.elemSize();
+
+  // the scene is visible, with more than one color
+  const auto *pixels = reference.ptr<cv::Vec3d>(0);
+  bool has_color = false, has_variation = false;
+  for (size_t i = 0; i < reference.total(); ++i) {
+    has_color = has_color || pixels[i][0] > 0;
+    has_variation = has_variation || pixels[i][0] != pixels[0][0];
+  }
+  REQUIRE(has_color);
+  REQUIRE(has_variation);
+
+  for (auto order : {TileOrder::kScanline, TileOrder::kCost,
+                     TileOrder::kHilbert}) {
+    for (uint threads : {1u, 4u}) {
+      for (uint packet_size : {1u, 4u}) {
+        auto image = render(threads, packet_size, order);
+        REQUIRE(image.rows == reference.rows);
+        REQUIRE(image.cols == reference.cols);
+        REQUIRE(image.isContinuous());
+        REQUIRE(std::memcmp(image.ptr<cv::Vec3d>(0),
+                            reference.ptr<cv::Vec3d>(0), size) == 0);
+      }
+    }
+  }
+}
+
+
+TEST_CASE("RenderShadesSurfacesSetUpWithSetMaterial") {
+  // the same scene shaded from surface materials, with no material
+  // ids or table, and from a material table
+  auto surfaces = RandomSurfaces(200, 139);
+  auto phong = PhongMaterial::Create(
+    Vec3r::Constant(static_cast<Real>(.1)),
+    Vec3r{static_cast<Real>(.5), static_cast<Real>(.2), static_cast<Real>(.1)},
+    Vec3r{1, 1, 1}, static_cast<Real>(20),
+    Vec3r::Constant(static_cast<Real>(.3)));
+  auto glass = PhongDielectric::Create(static_cast<Real>(1.5));
+  for (size_t i = 0; i < surfaces.size(); ++i)
+    surfaces[i]->SetMaterial(i % 5 == 0 ? Material::Ptr(glass) :
+                             Material::Ptr(phong));
+  Surface::Ptr scene = BVH::Create(surfaces);
+  std::vector<Light::Ptr> lights{
+    PointLight::Create(Vec3r{5, 12, 20}, Vec3r{200, 200, 200}),
+    AmbientLight::Create(Vec3r::Constant(static_cast<Real>(.2)))};
+  auto camera = Camera::Create(Vec3r{0, 0, 30}, Vec3r{0, 0, 0},
+                               Vec3r{0, 1, 0}, Real(40), Real(1.5));
+  auto render = [&](const MaterialTable &materials) {
+    RayTracer rt;
+    rt.SetMaterialTable(materials);
+    rt.SetImageHeight(41);
+    REQUIRE(rt.Render(scene, lights, camera));
+    return rt.GetRenderedImage();
+  };
+  auto same_image = [](const cv::Mat &a, const cv::Mat &b) {
+    return a.rows == b.rows && a.cols == b.cols && a.isContinuous() &&
+      b.isContinuous() && std::memcmp(a.ptr<cv::Vec3d>(0), b.ptr<cv::Vec3d>(0),
+                                      a.total() * a.elemSize()) == 0;
+  };
+
+  auto unlisted = render(MaterialTable());
+  const auto *pixels = unlisted.ptr<cv::Vec3d>(0);
+  bool has_color = false;
+  for (size_t i = 0; i < unlisted.total(); ++i)
+    has_color = has_color || pixels[i][0] > 0;
+  REQUIRE(has_color);
+
+  MaterialTable materials;
+  for (auto &surface : surfaces)
+    surface->SetMaterialId(materials.Add(surface->GetMaterial()));
+  REQUIRE(same_image(render(materials), unlisted));
+
+  // material edits after the table is built are shaded
+  phong->SetDiffuse(Vec3r{static_cast<Real>(.1), static_cast<Real>(.6),
+                          static_cast<Real>(.2)});
+  auto edited = render(materials);
+  CHECK_FALSE(same_image(edited, unlisted));
+  for (auto &surface : surfaces)
+    surface->SetMaterial(surface->GetMaterial());
+  CHECK(same_image(render(MaterialTable()), edited));
+}